@@ -0,0 +1,90 @@
+-- Base tables as used by the application (see "Tables Connectivity.png").
+-- IF NOT EXISTS lets this run against an installation created by hand.
+
+CREATE TABLE IF NOT EXISTS students (
+    student_id   VARCHAR(20)  NOT NULL,
+    first_name   VARCHAR(50)  NOT NULL,
+    last_name    VARCHAR(50)  NOT NULL,
+    email        VARCHAR(100) NOT NULL,
+    password     VARCHAR(255) NOT NULL,
+    degree       VARCHAR(50)  NOT NULL,
+    semester     INT          NOT NULL,
+    PRIMARY KEY (student_id)
+);
+
+CREATE TABLE IF NOT EXISTS faculty (
+    faculty_id    INT          NOT NULL,
+    first_name    VARCHAR(50)  NOT NULL,
+    last_name     VARCHAR(50)  NOT NULL,
+    email         VARCHAR(100) NOT NULL,
+    password      VARCHAR(255) NOT NULL,
+    degree        VARCHAR(100),
+    qualification VARCHAR(100),
+    expertise_sub VARCHAR(100),
+    designation   VARCHAR(100),
+    PRIMARY KEY (faculty_id),
+    UNIQUE KEY uq_faculty_email (email)
+);
+
+CREATE TABLE IF NOT EXISTS courses (
+    course_code   VARCHAR(20)  NOT NULL,
+    course_name   VARCHAR(100) NOT NULL,
+    credits       INT          NOT NULL,
+    semester      INT          NOT NULL,
+    department    VARCHAR(50)  NOT NULL,
+    max_students  INT          NOT NULL,
+    prerequisites TEXT,
+    PRIMARY KEY (course_code)
+);
+
+CREATE TABLE IF NOT EXISTS classrooms (
+    room_id     VARCHAR(20) NOT NULL,
+    building    VARCHAR(50) NOT NULL,
+    room_number VARCHAR(20) NOT NULL,
+    capacity    INT         NOT NULL,
+    room_type   VARCHAR(15),
+    PRIMARY KEY (room_id)
+);
+
+CREATE TABLE IF NOT EXISTS timeslots (
+    timeslot_id INT NOT NULL AUTO_INCREMENT,
+    day_of_week ENUM('Monday','Tuesday','Wednesday','Thursday','Friday','Saturday','Sunday') NOT NULL,
+    start_time  TIME NOT NULL,
+    end_time    TIME NOT NULL,
+    PRIMARY KEY (timeslot_id)
+);
+
+CREATE TABLE IF NOT EXISTS course_schedule (
+    schedule_id INT         NOT NULL AUTO_INCREMENT,
+    course_code VARCHAR(20) NOT NULL,
+    timeslot_id INT         NOT NULL,
+    room_id     VARCHAR(20) NOT NULL,
+    faculty_id  INT         NOT NULL,
+    PRIMARY KEY (schedule_id),
+    CONSTRAINT fk_schedule_course FOREIGN KEY (course_code) REFERENCES courses (course_code) ON DELETE CASCADE,
+    CONSTRAINT fk_schedule_timeslot FOREIGN KEY (timeslot_id) REFERENCES timeslots (timeslot_id),
+    CONSTRAINT fk_schedule_room FOREIGN KEY (room_id) REFERENCES classrooms (room_id),
+    CONSTRAINT fk_schedule_faculty FOREIGN KEY (faculty_id) REFERENCES faculty (faculty_id)
+);
+
+CREATE TABLE IF NOT EXISTS enrollments (
+    enrollment_id INT         NOT NULL AUTO_INCREMENT,
+    student_id    VARCHAR(20) NOT NULL,
+    schedule_id   INT         NOT NULL,
+    PRIMARY KEY (enrollment_id),
+    CONSTRAINT fk_enrollment_student FOREIGN KEY (student_id) REFERENCES students (student_id) ON DELETE CASCADE,
+    CONSTRAINT fk_enrollment_schedule FOREIGN KEY (schedule_id) REFERENCES course_schedule (schedule_id) ON DELETE CASCADE
+);
+
+CREATE TABLE IF NOT EXISTS marks (
+    id              INT         NOT NULL AUTO_INCREMENT,
+    course_code     VARCHAR(20) NOT NULL,
+    student_id      VARCHAR(20) NOT NULL,
+    assignment_name VARCHAR(50) NOT NULL,
+    total_marks     INT         NOT NULL,
+    obtained_marks  INT         NOT NULL,
+    PRIMARY KEY (id),
+    UNIQUE KEY uq_marks_entry (course_code, student_id, assignment_name),
+    CONSTRAINT fk_marks_course FOREIGN KEY (course_code) REFERENCES courses (course_code) ON DELETE CASCADE,
+    CONSTRAINT fk_marks_student FOREIGN KEY (student_id) REFERENCES students (student_id) ON DELETE CASCADE
+);
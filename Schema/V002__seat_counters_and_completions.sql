@@ -0,0 +1,16 @@
+-- Seat counter maintained by addEnrollment/dropEnrollment, backfilled from
+-- the current enrollments.
+ALTER TABLE course_schedule ADD COLUMN seats_taken INT NOT NULL DEFAULT 0;
+
+UPDATE course_schedule cs
+SET cs.seats_taken = (SELECT COUNT(*) FROM enrollments e WHERE e.schedule_id = cs.schedule_id);
+
+-- Courses a student has passed in earlier terms; read by the prerequisite check.
+-- course_code is not a foreign key: prerequisites may name courses that are no
+-- longer offered.
+CREATE TABLE IF NOT EXISTS completed_courses (
+    student_id  VARCHAR(20) NOT NULL,
+    course_code VARCHAR(20) NOT NULL,
+    PRIMARY KEY (student_id, course_code),
+    CONSTRAINT fk_completed_student FOREIGN KEY (student_id) REFERENCES students (student_id) ON DELETE CASCADE
+);
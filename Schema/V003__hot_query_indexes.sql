@@ -0,0 +1,22 @@
+-- Indexes behind the Database read paths. Run "MySQLXTest --check-plans" to
+-- confirm none of those queries falls back to a full table scan.
+
+-- isAlreadyEnrolled, hasClash, getEnrolledCourses, getStudentCourses
+CREATE INDEX idx_enrollments_student ON enrollments (student_id, schedule_id);
+-- seat reconciliation, getEnrolledStudentsInCourse, removeCourseSchedule
+CREATE INDEX idx_enrollments_schedule ON enrollments (schedule_id, student_id);
+
+-- hasClash, getAvailableRooms, getAvailableFaculty
+CREATE INDEX idx_schedule_timeslot ON course_schedule (timeslot_id, room_id, faculty_id);
+-- getFacultyCourses, getFacultyTimetable
+CREATE INDEX idx_schedule_faculty ON course_schedule (faculty_id, timeslot_id);
+-- getEnrolledStudentsInCourse, getTotalEnrolledStudents, getUnscheduledCourses
+CREATE INDEX idx_schedule_course ON course_schedule (course_code, seats_taken);
+
+-- getAvailableScheduledCourses
+CREATE INDEX idx_courses_cohort ON courses (semester, department);
+
+-- getAssignmentsForCourse, getStudentMarksForAssignment (covering)
+CREATE INDEX idx_marks_assignment ON marks (course_code, assignment_name, student_id, total_marks, obtained_marks);
+-- getStudentMarks, getTranscript
+CREATE INDEX idx_marks_student ON marks (student_id, course_code);
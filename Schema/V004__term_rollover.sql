@@ -0,0 +1,37 @@
+-- Closed-term data moved out of the hot tables by the end-of-semester rollover.
+
+CREATE TABLE IF NOT EXISTS enrollment_history (
+    id          INT         NOT NULL AUTO_INCREMENT,
+    term        VARCHAR(20) NOT NULL,
+    student_id  VARCHAR(20) NOT NULL,
+    course_code VARCHAR(20) NOT NULL,
+    faculty_id  INT         NOT NULL,
+    timeslot_id INT         NOT NULL,
+    room_id     VARCHAR(20) NOT NULL,
+    PRIMARY KEY (id),
+    KEY idx_enrollment_history_term (term),
+    KEY idx_enrollment_history_student (student_id)
+);
+
+CREATE TABLE IF NOT EXISTS marks_history (
+    id              INT         NOT NULL AUTO_INCREMENT,
+    term            VARCHAR(20) NOT NULL,
+    course_code     VARCHAR(20) NOT NULL,
+    student_id      VARCHAR(20) NOT NULL,
+    assignment_name VARCHAR(50) NOT NULL,
+    total_marks     INT         NOT NULL,
+    obtained_marks  INT         NOT NULL,
+    PRIMARY KEY (id),
+    KEY idx_marks_history_term (term),
+    KEY idx_marks_history_student (student_id, course_code)
+);
+
+CREATE TABLE IF NOT EXISTS alumni (
+    student_id   VARCHAR(20)  NOT NULL,
+    first_name   VARCHAR(50)  NOT NULL,
+    last_name    VARCHAR(50)  NOT NULL,
+    email        VARCHAR(100) NOT NULL,
+    degree       VARCHAR(50)  NOT NULL,
+    graduated_at TIMESTAMP    DEFAULT CURRENT_TIMESTAMP,
+    PRIMARY KEY (student_id)
+);
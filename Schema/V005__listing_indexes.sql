@@ -0,0 +1,8 @@
+-- Indexes for the keyset-paginated listings (Database::get*Page). Each page
+-- seeks past the previous page's last key, so the filter column leads and the
+-- paging key follows.
+
+-- getUnscheduledCoursesPage filtered by department
+CREATE INDEX idx_courses_department ON courses (department, course_code);
+-- getAvailableRoomsPage / getCourseSchedulesPage filtered by building
+CREATE INDEX idx_classrooms_building ON classrooms (building, room_id);
@@ -0,0 +1,15 @@
+-- Exam timetable written by Database::saveExamSchedule. A course sits in one
+-- exam slot but may be spread over several rooms, one row per room.
+
+CREATE TABLE IF NOT EXISTS exam_schedule (
+    exam_id     INT         NOT NULL AUTO_INCREMENT,
+    course_code VARCHAR(20) NOT NULL,
+    exam_slot   INT         NOT NULL,
+    room_id     VARCHAR(20) NOT NULL,
+    seats       INT         NOT NULL,
+    PRIMARY KEY (exam_id),
+    UNIQUE KEY uq_exam_course_room (course_code, room_id),
+    KEY idx_exam_slot (exam_slot, room_id),
+    FOREIGN KEY (course_code) REFERENCES courses (course_code) ON DELETE CASCADE,
+    FOREIGN KEY (room_id) REFERENCES classrooms (room_id) ON DELETE CASCADE
+);
@@ -0,0 +1,10 @@
+-- Request keys claimed by Database::transact. A key is inserted in the same
+-- transaction as the change it guards, so a retried enroll or mark upsert
+-- that already committed finds its key and is not applied twice.
+
+CREATE TABLE IF NOT EXISTS idempotency_keys (
+    request_key VARCHAR(64) NOT NULL,
+    created_at  TIMESTAMP   NOT NULL DEFAULT CURRENT_TIMESTAMP,
+    PRIMARY KEY (request_key),
+    KEY idx_idempotency_created (created_at)
+);
@@ -0,0 +1,23 @@
+-- Backfill for completed_courses, which V002 created empty. V002 itself is not
+-- edited: applied scripts are checksummed and --migrate refuses changed ones.
+--
+-- Standing: a student has completed the prerequisites of their degree's courses
+-- up to their semester, unless the catalogue places the prerequisite in their
+-- semester or later.
+INSERT IGNORE INTO completed_courses (student_id, course_code)
+SELECT DISTINCT s.student_id, UPPER(p.code)
+FROM students s
+JOIN courses c ON c.department = s.degree AND c.semester <= s.semester
+JOIN JSON_TABLE(
+    CONCAT('["', REPLACE(REPLACE(REPLACE(REPLACE(TRIM(COALESCE(c.prerequisites, '')), ';', ','), '/', ','), ' ', ','), ',', '","'), '"]'),
+    '$[*]' COLUMNS (code VARCHAR(20) PATH '$')) p
+WHERE p.code <> ''
+  AND NOT EXISTS (SELECT 1 FROM courses later WHERE later.course_code = p.code AND later.semester >= s.semester);
+
+-- History: courses passed in archived terms.
+INSERT IGNORE INTO completed_courses (student_id, course_code)
+SELECT mh.student_id, mh.course_code
+FROM marks_history mh
+JOIN students s ON s.student_id = mh.student_id
+GROUP BY mh.student_id, mh.course_code
+HAVING SUM(mh.obtained_marks) * 2 >= SUM(mh.total_marks);
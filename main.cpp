@@ -2,14 +2,56 @@
 #include <string>
 #include <vector>
 #include <iomanip>
+#include <limits>
 #include <fstream>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <queue>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 #define RESET "\033[0m"
 #define CYAN "\033[36m"
 #define GREEN "\033[32m"
 #define YELLOW "\033[33m"
 #define RED "\033[31m"
 
+static const char* const SNAPSHOT_PATH = "scit.snapshot";
+static const char* const TRACE_PATH = "scit.trace.json"; // Admin > Tracing export
+static const std::time_t SNAPSHOT_MAX_AGE = 60 * 60; // seconds; older snapshots are rewritten on exit
+static const char* const SEAT_JOURNAL_PATH = "seats.journal"; // fast registration write-behind log
+
 #include <mysqlx/xdevapi.h>
 
 class Person
@@ -32,674 +74,6828 @@ public:
     std::string getEmail() const { return email; }
 };
 
-class Database {
-    mysqlx::Session session;
-    mysqlx::Schema db;
+// Growable bit set; set algebra works a 64-bit word at a time.
+class Bitset
+{
+    std::vector<uint64_t> words;
 
 public:
-    Database(const std::string& host, const std::string& user, const std::string& pass, const std::string& dbname)
-        try : session(mysqlx::SessionOption::HOST, host,
-                     mysqlx::SessionOption::PORT, 33060,
-                     mysqlx::SessionOption::USER, user,
-                     mysqlx::SessionOption::PWD, pass,
-                     mysqlx::SessionOption::DB, dbname),
-              db(session.getSchema(dbname))
-    {
-        try {
-            db = session.getSchema(dbname);
-            if (!db.existsInDatabase()) {
-                throw std::runtime_error("Database " + dbname + " does not exist");
-            }
-        }
-        catch (const mysqlx::Error& err) {
-            throw std::runtime_error("Failed to get schema: " + std::string(err.what()));
-        }
-    }
-    catch (const mysqlx::Error& err) {
-        throw std::runtime_error("Connection failed: " + std::string(err.what()));
-    }
+    Bitset() {}
+    explicit Bitset(size_t bits) : words((bits + 63) / 64, 0) {}
 
-    ~Database() {
-        try {
-            session.close();
-        } catch (...) {}
-    }
-
-    bool studentExists(const std::string& studentId)
+    size_t size() const { return words.size() * 64; }
+    const std::vector<uint64_t>& data() const { return words; }
+    void set(size_t i)
     {
-        auto students = db.getTable("students");
-        auto res = students.select("COUNT(*)").where("student_id = :sid").bind("sid", studentId).execute();
-        auto row = res.fetchOne();
-        return row && row[0].get<int>() > 0;
+        if (i / 64 >= words.size())
+            words.resize(i / 64 + 1, 0);
+        words[i / 64] |= uint64_t(1) << (i % 64);
     }
-    bool validateStudentPassword(const std::string& studentId, const std::string& password)
+    void reset(size_t i)
     {
-        auto students = db.getTable("students");
-        auto res = students.select("password").where("student_id = :sid").bind("sid", studentId).execute();
-        auto row = res.fetchOne();
-        return row && row[0].get<std::string>() == password;
+        if (i / 64 < words.size())
+            words[i / 64] &= ~(uint64_t(1) << (i % 64));
     }
-    bool changeStudentPassword(const std::string& studentId, const std::string& newPassword)
+    bool test(size_t i) const
     {
-        auto students = db.getTable("students");
-        auto res = students.update().set("password", newPassword).where("student_id = :sid").bind("sid", studentId).execute();
-        return res.getAffectedItemsCount() > 0;
+        return i / 64 < words.size() && (words[i / 64] >> (i % 64)) & 1;
     }
-    bool resetStudentPassword(const std::string& studentId)
+    void clear() { std::fill(words.begin(), words.end(), 0); }
+    bool any() const
     {
-        return changeStudentPassword(studentId, "bnu");
+        for (uint64_t w : words)
+            if (w) return true;
+        return false;
     }
-    int getStudentSemester(const std::string& studentId)
+    size_t count() const
     {
-        auto students = db.getTable("students");
-        auto res = students.select("semester").where("student_id = :sid").bind("sid", studentId).execute();
-        auto row = res.fetchOne();
-        return row ? row[0].get<int>() : -1;
+        size_t n = 0;
+        for (uint64_t w : words)
+            n += __builtin_popcountll(w);
+        return n;
     }
-    std::string getStudentDegree(const std::string& studentId)
+    Bitset& operator|=(const Bitset& other)
     {
-        auto students = db.getTable("students");
-        auto res = students.select("degree").where("student_id = :sid").bind("sid", studentId).execute();
-        auto row = res.fetchOne();
-        return row ? std::string(row[0].get<std::string>()) : "";
+        if (other.words.size() > words.size())
+            words.resize(other.words.size(), 0);
+        for (size_t i = 0; i < other.words.size(); ++i)
+            words[i] |= other.words[i];
+        return *this;
     }
-
-    // Faculty related methods
-    bool facultyExists(const std::string& email)
+    Bitset& operator&=(const Bitset& other)
     {
-        auto faculty = db.getTable("faculty");
-        auto res = faculty.select("COUNT(*)").where("email = :email").bind("email", email).execute();
-        auto row = res.fetchOne();
-        return row && row[0].get<int>() > 0;
+        for (size_t i = 0; i < words.size(); ++i)
+            words[i] &= i < other.words.size() ? other.words[i] : 0;
+        return *this;
     }
-
-    bool validateFacultyPassword(const std::string& email, const std::string& password)
+    // Bits set here but not in other.
+    Bitset without(const Bitset& other) const
     {
-        auto faculty = db.getTable("faculty");
-        auto res = faculty.select("password").where("email = :email").bind("email", email).execute();
-        auto row = res.fetchOne();
-        return row && row[0].get<std::string>() == password;
+        Bitset result(*this);
+        for (size_t i = 0; i < result.words.size() && i < other.words.size(); ++i)
+            result.words[i] &= ~other.words[i];
+        return result;
     }
-
-    std::string getFacultyId(const std::string& email)
+    bool isSubsetOf(const Bitset& other) const
     {
-        auto faculty = db.getTable("faculty");
-        auto res = faculty.select("faculty_id").where("email = :email").bind("email", email).execute();
-        auto row = res.fetchOne();
-        return row ? std::to_string(row[0].get<int>()) : "";
+        for (size_t i = 0; i < words.size(); ++i)
+            if (words[i] & ~(i < other.words.size() ? other.words[i] : 0))
+                return false;
+        return true;
     }
-
-    std::string getFacultyName(const std::string& email)
+    bool intersects(const Bitset& other) const
     {
-        auto faculty = db.getTable("faculty");
-        auto res = faculty.select("first_name", "last_name").where("email = :email").bind("email", email).execute();
-        auto row = res.fetchOne();
-        return row ? (row[0].get<std::string>() + " " + row[1].get<std::string>()) : "";
+        for (size_t i = 0; i < words.size() && i < other.words.size(); ++i)
+            if (words[i] & other.words[i])
+                return true;
+        return false;
     }
-
-    bool changeFacultyPassword(const std::string& email, const std::string& newPassword)
+    template <typename F>
+    void forEach(F f) const
     {
-        auto faculty = db.getTable("faculty");
-        auto res = faculty.update().set("password", newPassword).where("email = :email").bind("email", email).execute();
-        return res.getAffectedItemsCount() > 0;
+        for (size_t i = 0; i < words.size(); ++i)
+            for (uint64_t w = words[i]; w; w &= w - 1)
+                f(i * 64 + __builtin_ctzll(w));
     }
+};
 
-    bool resetFacultyPassword(const std::string& email)
-    {
-        return changeFacultyPassword(email, "faculty_scit");
-    }
+// Course prerequisite DAG. Every course keeps the bitset of all of its transitive
+// prerequisites, so an enrollment check is a subset test against the student's
+// completed courses. Nodes are never deleted, only unlinked, so bit positions stay
+// stable for cached student sets.
+class PrerequisiteEngine
+{
+    std::unordered_map<std::string, size_t> index;
+    std::vector<std::string> codes;
+    std::vector<std::vector<size_t>> direct;     // course -> direct prerequisites
+    std::vector<std::vector<size_t>> dependents; // course -> courses requiring it
+    std::vector<Bitset> closure;                 // course -> all transitive prerequisites
+    uint64_t version = 0;
 
-    struct ScheduledCourse
+    struct Completed
     {
-        int schedule_id;
-        std::string course_code, course_name, department;
-        int semester, faculty_id, timeslot_id;
-        std::string faculty_name, day, start_time, end_time;
-        std::string room_id, room_number, building;
+        Bitset courses;   // as recorded
+        Bitset effective; // recorded plus everything they imply
+        uint64_t version = 0;
     };
+    std::unordered_map<std::string, Completed> students;
 
-    std::vector<ScheduledCourse> getAvailableScheduledCourses(int semester, const std::string& degree)
+    size_t node(const std::string& code)
     {
-        std::vector<ScheduledCourse> result;
-        std::string query =
-            "SELECT cs.schedule_id, cs.course_code, c.course_name, f.first_name, f.last_name, "
-            "t.day_of_week, CAST(t.start_time AS CHAR), CAST(t.end_time AS CHAR), "
-            "cl.room_number, cl.building, cs.timeslot_id "
-            "FROM course_schedule cs "
-            "JOIN courses c ON cs.course_code = c.course_code "
-            "JOIN faculty f ON cs.faculty_id = f.faculty_id "
-            "JOIN timeslots t ON cs.timeslot_id = t.timeslot_id "
-            "JOIN classrooms cl ON cs.room_id = cl.room_id "
-            "WHERE c.semester = ? AND c.department = ?";
-
-        auto res = session.sql(query).bind(semester, degree).execute();
-        mysqlx::Row row;
-
-        while ((row = res.fetchOne())) {
-            ScheduledCourse sc;
-            sc.schedule_id   = row[0].get<int>();
-            sc.course_code   = row[1].get<std::string>();
-            sc.course_name   = row[2].get<std::string>();
-            sc.faculty_name  = row[3].get<std::string>() + " " + row[4].get<std::string>();
-            sc.day           = row[5].get<std::string>();
-            sc.start_time    = row[6].get<std::string>();
-            sc.end_time      = row[7].get<std::string>();
-            sc.room_number   = row[8].get<std::string>();
-            sc.building      = row[9].get<std::string>();
-            sc.timeslot_id   = row[10].get<int>();
-
-            result.push_back(sc);
-        }
-        return result;
+        auto it = index.find(code);
+        if (it != index.end())
+            return it->second;
+        index.emplace(code, codes.size());
+        codes.push_back(code);
+        direct.emplace_back();
+        dependents.emplace_back();
+        closure.emplace_back();
+        return codes.size() - 1;
     }
 
-    bool isAlreadyEnrolled(const std::string& studentId, int schedule_id)
-    {
-        auto enrollments = db.getTable("enrollments");
-        auto res = enrollments.select("COUNT(*)")
-            .where("student_id = :sid AND schedule_id = :scid")
-            .bind("sid", studentId)
-            .bind("scid", schedule_id)
-            .execute();
-        auto row = res.fetchOne();
-        return row && row[0].get<int>() > 0;
-    }
-    bool hasClash(const std::string& studentId, int timeslot_id)
+    void unlink(size_t v)
     {
-        std::string query =
-            "SELECT COUNT(*) FROM enrollments e "
-            "JOIN course_schedule cs ON e.schedule_id = cs.schedule_id "
-            "WHERE e.student_id = ? AND cs.timeslot_id = ?";
-        auto res = session.sql(query).bind(studentId, timeslot_id).execute();
-        auto row = res.fetchOne();
-        return row && row[0].get<int>() > 0;
-    }
-    bool addEnrollment(const std::string& studentId, int schedule_id)
-    {
-        std::string course_code;
+        for (size_t p : direct[v])
         {
-            std::string query = "SELECT course_code FROM course_schedule WHERE schedule_id = ?";
-            auto res = session.sql(query).bind(schedule_id).execute();
-            auto row = res.fetchOne();
-            if (!row) return false;
-            course_code = row[0].get<std::string>();
+            auto& d = dependents[p];
+            d.erase(std::remove(d.begin(), d.end(), v), d.end());
         }
-        int max_students = 0;
+        direct[v].clear();
+    }
+
+    // Recompute the closure of v and of every course that depends on it, in
+    // topological order so each course is visited after its prerequisites.
+    void propagate(size_t v)
+    {
+        std::vector<size_t> order;
+        std::vector<char> seen(codes.size(), 0);
+        std::vector<std::pair<size_t, size_t>> stack{{v, 0}};
+        seen[v] = 1;
+        while (!stack.empty())
         {
-            std::string query = "SELECT max_students FROM courses WHERE course_code = ?";
-            auto res = session.sql(query).bind(course_code).execute();
-            auto row = res.fetchOne();
-            if (!row) return false;
-            max_students = row[0].get<int>();
+            auto& top = stack.back();
+            if (top.second < dependents[top.first].size())
+            {
+                size_t next = dependents[top.first][top.second++];
+                if (!seen[next])
+                {
+                    seen[next] = 1;
+                    stack.push_back({next, 0});
+                }
+            }
+            else
+            {
+                order.push_back(top.first);
+                stack.pop_back();
+            }
         }
-        int enrolled = 0;
+        for (auto it = order.rbegin(); it != order.rend(); ++it)
         {
-            std::string query = "SELECT COUNT(*) FROM enrollments WHERE schedule_id = ?";
-            auto res = session.sql(query).bind(schedule_id).execute();
-            auto row = res.fetchOne();
-            if (!row) return false;
-            enrolled = row[0].get<int>();
+            Bitset c(codes.size());
+            for (size_t p : direct[*it])
+            {
+                c.set(p);
+                c |= closure[p];
+            }
+            closure[*it] = c;
         }
-        if (enrolled >= max_students)
-            return false;
-        auto enrollments = db.getTable("enrollments");
-        enrollments.insert("student_id", "schedule_id").values(studentId, schedule_id).execute();
-        return true;
-    }
-    bool dropEnrollment(const std::string& studentId, int schedule_id)
-    {
-        auto enrollments = db.getTable("enrollments");
-        auto res = enrollments.remove()
-            .where("student_id = :sid AND schedule_id = :scid")
-            .bind("sid", studentId)
-            .bind("scid", schedule_id)
-            .execute();
-        return res.getAffectedItemsCount() > 0;
+        ++version;
     }
-    std::vector<ScheduledCourse> getEnrolledCourses(const std::string& studentId)
-    {
-        std::vector<ScheduledCourse> result;
-        std::string query =
-            "SELECT cs.schedule_id, c.course_code, c.course_name, c.department, c.semester, "
-            "f.faculty_id, CONCAT(f.first_name,' ',f.last_name) AS faculty_name, "
-            "t.timeslot_id, t.day_of_week, CAST(t.start_time AS CHAR), CAST(t.end_time AS CHAR), "
-            "cl.room_id, cl.room_number, cl.building "
-            "FROM enrollments e "
-            "JOIN course_schedule cs ON e.schedule_id = cs.schedule_id "
-            "JOIN courses c ON cs.course_code = c.course_code "
-            "JOIN faculty f ON cs.faculty_id = f.faculty_id "
-            "JOIN timeslots t ON cs.timeslot_id = t.timeslot_id "
-            "JOIN classrooms cl ON cs.room_id = cl.room_id "
-            "WHERE e.student_id = ?";
 
-        auto res = session.sql(query).bind(studentId).execute();
-        mysqlx::Row row;
-        while ((row = res.fetchOne()))
+    // Path v -> ... -> v that would close a cycle if v required p.
+    std::string cyclePath(size_t v, size_t p) const
+    {
+        std::string path = codes[v];
+        size_t at = p;
+        while (true)
         {
-            result.push_back({
-                row[0].get<int>(),
-                row[1].get<std::string>(),
-                row[2].get<std::string>(),
-                row[3].get<std::string>(),
-                row[4].get<int>(),
-                row[5].get<int>(),
-                row[7].get<int>(),
-                row[6].get<std::string>(),
-                row[8].get<std::string>(),
-                row[9].get<std::string>(),
-                row[10].get<std::string>(),
-                row[11].get<std::string>(),
-                row[12].get<std::string>(),
-                row[13].get<std::string>()
-            });
+            path += " -> " + codes[at];
+            if (at == v)
+                return path;
+            for (size_t next : direct[at])
+            {
+                if (next == v || closure[next].test(v))
+                {
+                    at = next;
+                    break;
+                }
+            }
         }
-        return result;
     }
 
-    typedef ScheduledCourse TimetableEntry;
-    std::vector<TimetableEntry> getStudentTimetable(const std::string& studentId)
+    const Bitset& effective(Completed& c)
     {
-        return getEnrolledCourses(studentId);
+        if (c.version != version)
+        {
+            c.effective = c.courses;
+            c.courses.forEach([&](size_t i) { c.effective |= closure[i]; });
+            c.version = version;
+        }
+        return c.effective;
     }
 
-    // Faculty specific methods
-    std::vector<std::string> getFacultyCourses(int facultyId)
+public:
+    // "CS102, CS103L" / "CS102 CS103" / "CS102;CS103" -> {"CS102", "CS103L"}
+    static std::vector<std::string> parse(const std::string& prerequisites)
     {
         std::vector<std::string> result;
-        std::string query =
-            "SELECT DISTINCT cs.course_code, c.course_name FROM course_schedule cs "
-            "JOIN courses c ON cs.course_code = c.course_code "
-            "WHERE cs.faculty_id = ?";
-        auto res = session.sql(query).bind(facultyId).execute();
-        mysqlx::Row row;
-        while ((row = res.fetchOne()))
+        std::string current;
+        for (char ch : prerequisites + " ")
         {
-            result.push_back(row[0].get<std::string>() + " - " + row[1].get<std::string>());
+            if (ch == ',' || ch == ';' || ch == '/' || std::isspace(static_cast<unsigned char>(ch)))
+            {
+                if (!current.empty() && std::find(result.begin(), result.end(), current) == result.end())
+                    result.push_back(current);
+                current.clear();
+            }
+            else
+            {
+                current += static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+            }
         }
         return result;
     }
 
-    struct StudentInfo
-    {
-        std::string student_id;
-        std::string first_name;
-        std::string last_name;
-        std::string email;
-        int semester;
-        std::string degree;
-    };
-
-    std::vector<StudentInfo> getEnrolledStudentsInCourse(const std::string& course_code)
+    // Returns the cycle that setting these prerequisites would create, or "" if none.
+    std::string findCycle(const std::string& code, const std::string& prerequisites)
     {
-        std::vector<StudentInfo> result;
-        std::string query =
-            "SELECT DISTINCT s.student_id, s.first_name, s.last_name, s.email, s.semester, s.degree "
-            "FROM enrollments e "
-            "JOIN students s ON e.student_id = s.student_id "
-            "JOIN course_schedule cs ON e.schedule_id = cs.schedule_id "
-            "WHERE cs.course_code = ?";
-        auto res = session.sql(query).bind(course_code).execute();
-        mysqlx::Row row;
-        while ((row = res.fetchOne()))
+        auto it = index.find(code);
+        if (it == index.end())
+            return "";
+        size_t v = it->second;
+        for (const auto& pcode : parse(prerequisites))
         {
-            StudentInfo si;
-            si.student_id = row[0].get<std::string>();
-            si.first_name = row[1].get<std::string>();
-            si.last_name = row[2].get<std::string>();
-            si.email = row[3].get<std::string>();
-            si.semester = row[4].get<int>();
-            si.degree = row[5].get<std::string>();
-            result.push_back(si);
+            auto pit = index.find(pcode);
+            if (pit == index.end())
+                continue;
+            if (pit->second == v || closure[pit->second].test(v))
+                return cyclePath(v, pit->second);
         }
-        return result;
+        return "";
     }
 
-    std::vector<ScheduledCourse> getFacultyTimetable(int facultyId)
+    // Sets a course's prerequisites. Returns the offending cycle and leaves the
+    // graph untouched if the new edges would close one.
+    std::string setCourse(const std::string& code, const std::string& prerequisites)
     {
-        std::vector<ScheduledCourse> result;
-        std::string query =
-            "SELECT cs.schedule_id, cs.course_code, c.course_name, c.department, c.semester, "
-            "cs.faculty_id, cs.timeslot_id, CONCAT(f.first_name, ' ', f.last_name) AS faculty_name, "
-            "t.day_of_week, CAST(t.start_time AS CHAR), CAST(t.end_time AS CHAR), "
-            "cs.room_id, cl.room_number, cl.building "
-            "FROM course_schedule cs "
-            "JOIN courses c ON cs.course_code = c.course_code "
-            "JOIN faculty f ON cs.faculty_id = f.faculty_id "
-            "JOIN timeslots t ON cs.timeslot_id = t.timeslot_id "
-            "JOIN classrooms cl ON cs.room_id = cl.room_id "
-            "WHERE cs.faculty_id = ?";
-        auto res = session.sql(query).bind(facultyId).execute();
-        mysqlx::Row row;
-        while ((row = res.fetchOne()))
+        std::string cycle = findCycle(code, prerequisites);
+        if (!cycle.empty())
+            return cycle;
+        size_t v = node(code);
+        unlink(v);
+        for (const auto& pcode : parse(prerequisites))
         {
-            ScheduledCourse sc;
-            sc.schedule_id = row[0].get<int>();
-            sc.course_code = row[1].get<std::string>();
-            sc.course_name = row[2].get<std::string>();
-            sc.department = row[3].get<std::string>();
-            sc.semester = row[4].get<int>();
-            sc.faculty_id = row[5].get<int>();
-            sc.timeslot_id = row[6].get<int>();
-            sc.faculty_name = row[7].get<std::string>();
-            sc.day = row[8].get<std::string>();
-            sc.start_time = row[9].get<std::string>();
-            sc.end_time = row[10].get<std::string>();
-            sc.room_id = row[11].get<std::string>();
-            sc.room_number = row[12].get<std::string>();
-            sc.building = row[13].get<std::string>();
-            result.push_back(sc);
+            size_t p = node(pcode);
+            direct[v].push_back(p);
+            dependents[p].push_back(v);
         }
-        return result;
+        propagate(v);
+        return "";
     }
 
-    void addMarks(const std::string& course_code, const std::string& student_id, const std::string& assignment_name, int total_marks, int obtained_marks)
+    void removeCourse(const std::string& code)
     {
-        try {
-            std::string query = "INSERT INTO marks (course_code, student_id, assignment_name, total_marks, obtained_marks) VALUES (?, ?, ?, ?, ?) "
-                                "ON DUPLICATE KEY UPDATE total_marks = VALUES(total_marks), obtained_marks = VALUES(obtained_marks)";
-            session.sql(query).bind(course_code, student_id, assignment_name, total_marks, obtained_marks).execute();
-        }
-        catch (const mysqlx::Error& err) {
-            std::cout << "Error adding marks: " << err.what() << std::endl;
-        }
+        auto it = index.find(code);
+        if (it == index.end())
+            return;
+        unlink(it->second);
+        propagate(it->second);
     }
 
-    void updateMarks(const std::string& course_code, const std::string& student_id, const std::string& assignment_name, int obtained_marks)
+    // Full rebuild from (course_code, prerequisites) rows. Edges that would close a
+    // cycle are dropped and reported.
+    std::vector<std::string> rebuild(const std::vector<std::pair<std::string, std::string>>& courses)
     {
-        try {
-            std::string query = "UPDATE marks SET obtained_marks = ? WHERE course_code = ? AND student_id = ? AND assignment_name = ?";
-            session.sql(query).bind(obtained_marks, course_code, student_id, assignment_name).execute();
-        }
-        catch (const mysqlx::Error& err) {
-            std::cout << "Error updating marks: " << err.what() << std::endl;
+        index.clear();
+        codes.clear();
+        direct.clear();
+        dependents.clear();
+        closure.clear();
+        students.clear();
+        std::vector<std::string> cycles;
+        for (const auto& c : courses)
+        {
+            std::string cycle = setCourse(c.first, c.second);
+            if (!cycle.empty())
+                cycles.push_back(cycle);
         }
+        return cycles;
     }
 
-    std::vector<std::string> getAssignmentsForCourse(const std::string& course_code) {
-        std::vector<std::string> assignments;
-        std::string query = "SELECT DISTINCT assignment_name FROM marks WHERE course_code = ?";
-        auto res = session.sql(query).bind(course_code).execute();
-        mysqlx::Row row;
-        while ((row = res.fetchOne())) {
-            assignments.push_back(row[0].get<std::string>());
-        }
-        return assignments;
+    bool hasStudent(const std::string& studentId) const { return students.count(studentId) > 0; }
+    void setCompleted(const std::string& studentId, const std::vector<std::string>& completed)
+    {
+        Completed c;
+        for (const auto& code : completed)
+            c.courses.set(node(code));
+        c.version = version - 1;
+        students[studentId] = c;
     }
+    void forgetStudent(const std::string& studentId) { students.erase(studentId); }
+    void forgetStudents() { students.clear(); }
 
-    std::vector<std::pair<std::string, std::pair<int, int>>> getStudentMarksForAssignment(const std::string& course_code, const std::string& assignment_name) {
-        std::vector<std::pair<std::string, std::pair<int, int>>> marks;
-        std::string query = "SELECT student_id, total_marks, obtained_marks FROM marks WHERE course_code = ? AND assignment_name = ?";
-        auto res = session.sql(query).bind(course_code, assignment_name).execute();
-        mysqlx::Row row;
-        while ((row = res.fetchOne())) {
-            marks.emplace_back(row[0].get<std::string>(), std::make_pair(row[1].get<int>(), row[2].get<int>()));
+    // Prerequisites of course_code (direct or transitive) the student has not covered.
+    std::vector<std::string> missing(const std::string& studentId, const std::string& course_code)
+    {
+        std::vector<std::string> result;
+        auto it = index.find(course_code);
+        if (it == index.end())
+            return result;
+        const Bitset& need = closure[it->second];
+        auto sit = students.find(studentId);
+        if (sit == students.end())
+        {
+            need.forEach([&](size_t i) { result.push_back(codes[i]); });
+            return result;
         }
-        return marks;
+        const Bitset& have = effective(sit->second);
+        if (need.isSubsetOf(have))
+            return result;
+        need.without(have).forEach([&](size_t i) { result.push_back(codes[i]); });
+        return result;
     }
+};
 
-    int getTotalEnrolledStudents(const std::string& course_code)
-    {
-        std::string query =
-            "SELECT COUNT(DISTINCT e.student_id) FROM enrollments e "
-            "JOIN course_schedule cs ON e.schedule_id = cs.schedule_id "
-            "WHERE cs.course_code = ?";
-        auto res = session.sql(query).bind(course_code).execute();
-        auto row = res.fetchOne();
-        return row ? row[0].get<int>() : 0;
-    }
+struct GradePoint
+{
+    double min_percentage;
+    const char* letter;
+    double points;
+};
 
-    int getNextFacultyId()
+// Four-point scale; first entry whose threshold the percentage reaches wins.
+static const GradePoint GRADE_SCALE[] = {
+    {85, "A", 4.0}, {80, "A-", 3.67}, {75, "B+", 3.33}, {71, "B", 3.0},
+    {68, "B-", 2.67}, {64, "C+", 2.33}, {61, "C", 2.0}, {58, "C-", 1.67},
+    {54, "D+", 1.33}, {50, "D", 1.0}, {0, "F", 0.0}};
+
+inline const GradePoint& gradeFor(double percentage)
+{
+    for (const auto& g : GRADE_SCALE)
+        if (percentage >= g.min_percentage)
+            return g;
+    return GRADE_SCALE[sizeof(GRADE_SCALE) / sizeof(GRADE_SCALE[0]) - 1];
+}
+
+// Per-student course grades and GPAs. Aggregates are kept as running sums and
+// patched on every mark upsert, so a transcript never rescans the marks table.
+class GradingEngine
+{
+public:
+    struct CourseInfo
     {
-        std::string query = "SELECT MAX(faculty_id) FROM faculty";
-        auto res = session.sql(query).execute();
-        auto row = res.fetchOne();
-        int nextId = 1;
-        if (row && !row[0].isNull())
-        {
-            nextId = row[0].get<int>() + 1;
-        }
-        return nextId;
-    }
-    void addStudent(const std::string& id, const std::string& fname, const std::string& lname, const std::string& email, const std::string& degree, int semester)
+        std::string name;
+        int credits = 0;
+        int semester = 0;
+    };
+    struct MarkRow
     {
-        auto students = db.getTable("students");
-        students.insert("student_id", "first_name", "last_name", "email", "degree", "semester", "password")
-            .values(id, fname, lname, email, degree, semester, "bnu") // password defaults to "bnu"
-            .execute();
-    }
-    void removeStudent(const std::string& id)
+        std::string student_id, course_code, assignment_name;
+        int total_marks, obtained_marks;
+    };
+    struct CourseGrade
     {
-        auto students = db.getTable("students");
-        students.remove().where("student_id = :sid").bind("sid", id).execute();
+        std::string course_code, course_name;
+        int credits = 0, semester = 0;
+        long total_marks = 0, obtained_marks = 0;
+        double percentage() const { return total_marks > 0 ? 100.0 * obtained_marks / total_marks : 0.0; }
+        const GradePoint& grade() const { return gradeFor(percentage()); }
+    };
+    struct Transcript
+    {
+        std::vector<CourseGrade> courses;
+        std::map<int, double> semester_gpa;
+        double cgpa = 0;
+        int credits = 0;
+    };
+
+private:
+    struct CourseAggregate
+    {
+        long total_marks = 0, obtained_marks = 0;
+        std::unordered_map<std::string, std::pair<int, int>> assignments; // name -> (total, obtained)
+    };
+    struct SemesterAggregate
+    {
+        double quality_points = 0;
+        int credits = 0;
+    };
+    struct StudentAggregate
+    {
+        std::map<std::string, CourseAggregate> courses;
+        std::map<int, SemesterAggregate> semesters;
+    };
+
+    std::unordered_map<std::string, CourseInfo> catalogue;
+    std::unordered_map<std::string, StudentAggregate> students;
+
+    const CourseInfo& info(const std::string& course_code) const
+    {
+        static const CourseInfo unknown;
+        auto it = catalogue.find(course_code);
+        return it == catalogue.end() ? unknown : it->second;
     }
-    void addFaculty(int faculty_id, const std::string& fname, const std::string& lname, const std::string& email, const std::string& degree, const std::string& qualification, const std::string& expertise_sub, const std::string& designation)
+
+    // Adds (sign = +1) or removes (sign = -1) a course's weight from its semester.
+    void weigh(StudentAggregate& s, const std::string& course_code, const CourseAggregate& c, int sign) const
     {
-        auto faculty = db.getTable("faculty");
-        faculty.insert("faculty_id", "first_name", "last_name", "email", "degree", "qualification", "expertise_sub", "designation", "password")
-            .values(faculty_id, fname, lname, email, degree, qualification, expertise_sub, designation, "faculty_scit")
-            .execute();
+        if (c.total_marks <= 0)
+            return;
+        const CourseInfo& ci = info(course_code);
+        auto& sem = s.semesters[ci.semester];
+        sem.quality_points += sign * gradeFor(100.0 * c.obtained_marks / c.total_marks).points * ci.credits;
+        sem.credits += sign * ci.credits;
     }
-    void removeFaculty(int faculty_id)
+
+    void upsert(StudentAggregate& s, const MarkRow& m) const
     {
-        auto faculty = db.getTable("faculty");
-        faculty.remove().where("faculty_id = :fid").bind("fid", faculty_id).execute();
+        auto& c = s.courses[m.course_code];
+        weigh(s, m.course_code, c, -1);
+        auto it = c.assignments.find(m.assignment_name);
+        if (it != c.assignments.end())
+        {
+            c.total_marks -= it->second.first;
+            c.obtained_marks -= it->second.second;
+        }
+        c.assignments[m.assignment_name] = {m.total_marks, m.obtained_marks};
+        c.total_marks += m.total_marks;
+        c.obtained_marks += m.obtained_marks;
+        weigh(s, m.course_code, c, +1);
     }
-    void addCourse(const std::string& code, const std::string& name, int credits, int sem, const std::string& dept, int max, const std::string& prereq)
+
+public:
+    void setCourse(const std::string& course_code, const CourseInfo& ci) { catalogue[course_code] = ci; }
+    // The course's marks go with it (ON DELETE CASCADE), so its weight leaves
+    // every loaded student too.
+    void removeCourse(const std::string& course_code)
     {
-        auto courses = db.getTable("courses");
-        courses.insert("course_code", "course_name", "credits", "semester", "department", "max_students", "prerequisites")
-            .values(code, name, credits, sem, dept, max, prereq)
-            .execute();
+        for (auto& s : students)
+        {
+            auto it = s.second.courses.find(course_code);
+            if (it == s.second.courses.end())
+                continue;
+            weigh(s.second, course_code, it->second, -1);
+            s.second.courses.erase(it);
+        }
+        catalogue.erase(course_code);
     }
-    void removeCourse(const std::string& code)
+    bool hasCatalogue() const { return !catalogue.empty(); }
+    bool hasStudent(const std::string& studentId) const { return students.count(studentId) > 0; }
+    size_t studentCount() const { return students.size(); }
+    std::vector<std::string> studentIds() const
     {
-        auto courses = db.getTable("courses");
-        courses.remove().where("course_code = :ccode").bind("ccode", code).execute();
+        std::vector<std::string> ids;
+        for (const auto& s : students)
+            ids.push_back(s.first);
+        return ids;
     }
-    void addClassroom(const std::string& id, const std::string& building, const std::string& number, int capacity, const std::string& room_type)
+
+    void load(const std::string& studentId, const std::vector<MarkRow>& rows)
     {
-        auto classrooms = db.getTable("classrooms");
-        classrooms.insert("room_id", "building", "room_number", "capacity", "room_type")
-            .values(id, building, number, capacity, room_type)
-            .execute();
+        StudentAggregate s;
+        for (const auto& m : rows)
+            upsert(s, m);
+        students[studentId] = std::move(s);
     }
-    void removeClassroom(const std::string& id)
+
+    // Incremental hooks for addMarks/updateMarks. Students not yet loaded are
+    // skipped; they are built from scratch on first view.
+    void applyMarks(const std::string& studentId, const std::string& course_code, const std::string& assignment_name, int total_marks, int obtained_marks)
     {
-        auto classrooms = db.getTable("classrooms");
-        classrooms.remove().where("room_id = :rid").bind("rid", id).execute();
+        auto it = students.find(studentId);
+        if (it != students.end())
+            upsert(it->second, {studentId, course_code, assignment_name, total_marks, obtained_marks});
     }
-    void addTimeslot(const std::string& day, const std::string& start, const std::string& end)
+    void applyObtained(const std::string& studentId, const std::string& course_code, const std::string& assignment_name, int obtained_marks)
     {
-        auto timeslots = db.getTable("timeslots");
-        timeslots.insert("day_of_week", "start_time", "end_time")
-            .values(day, start, end)
-            .execute();
+        auto it = students.find(studentId);
+        if (it == students.end())
+            return;
+        auto cit = it->second.courses.find(course_code);
+        if (cit == it->second.courses.end())
+            return;
+        auto ait = cit->second.assignments.find(assignment_name);
+        if (ait != cit->second.assignments.end())
+            upsert(it->second, {studentId, course_code, assignment_name, ait->second.first, obtained_marks});
     }
-    void removeTimeslot(int timeslot_id)
+    void forgetStudent(const std::string& studentId) { students.erase(studentId); }
+    void forgetStudents() { students.clear(); }
+
+    Transcript transcript(const std::string& studentId) const
     {
-        auto timeslots = db.getTable("timeslots");
-        timeslots.remove().where("timeslot_id = :tid").bind("tid", timeslot_id).execute();
+        Transcript t;
+        auto it = students.find(studentId);
+        if (it == students.end())
+            return t;
+        for (const auto& c : it->second.courses)
+        {
+            if (c.second.total_marks <= 0)
+                continue;
+            const CourseInfo& ci = info(c.first);
+            CourseGrade g;
+            g.course_code = c.first;
+            g.course_name = ci.name;
+            g.credits = ci.credits;
+            g.semester = ci.semester;
+            g.total_marks = c.second.total_marks;
+            g.obtained_marks = c.second.obtained_marks;
+            t.courses.push_back(g);
+        }
+        std::sort(t.courses.begin(), t.courses.end(), [](const CourseGrade& a, const CourseGrade& b) {
+            return a.semester != b.semester ? a.semester < b.semester : a.course_code < b.course_code;
+        });
+        double quality_points = 0;
+        for (const auto& sem : it->second.semesters)
+        {
+            if (sem.second.credits <= 0)
+                continue;
+            t.semester_gpa[sem.first] = sem.second.quality_points / sem.second.credits;
+            quality_points += sem.second.quality_points;
+            t.credits += sem.second.credits;
+        }
+        t.cgpa = t.credits > 0 ? quality_points / t.credits : 0;
+        return t;
     }
-    std::vector<std::pair<std::string, std::string>> getUnscheduledCourses()
+
+    // End-of-term rebuild of every student from a full marks dump. Rows are
+    // partitioned by student across worker threads; each worker builds its own
+    // map, which are then merged without further locking.
+    void recomputeAll(const std::vector<MarkRow>& rows, unsigned threads)
     {
-        std::vector<std::pair<std::string, std::string>> resvec;
-        std::string query =
-            "SELECT course_code, course_name FROM courses WHERE course_code NOT IN (SELECT course_code FROM course_schedule)";
-        auto res = session.sql(query).execute();
-        mysqlx::Row row;
-        while ((row = res.fetchOne()))
-            resvec.emplace_back(row[0].get<std::string>(), row[1].get<std::string>());
-        return resvec;
+        threads = std::max(1u, threads);
+        std::vector<std::vector<const MarkRow*>> parts(threads);
+        std::hash<std::string> hasher;
+        for (const auto& m : rows)
+            parts[hasher(m.student_id) % threads].push_back(&m);
+
+        std::vector<std::unordered_map<std::string, StudentAggregate>> built(threads);
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([this, t, &parts, &built]() {
+                for (const MarkRow* m : parts[t])
+                    upsert(built[t][m->student_id], *m);
+            });
+        }
+        for (auto& w : workers)
+            w.join();
+
+        students.clear();
+        for (auto& part : built)
+            for (auto& s : part)
+                students.emplace(s.first, std::move(s.second));
     }
-    std::vector<std::pair<int, std::string>> getAllTimeslots()
+};
+
+// Read-only memory map of a whole file.
+class MappedFile
+{
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+
+public:
+    MappedFile() {}
+    explicit MappedFile(const std::string& path)
     {
-        std::vector<std::pair<int, std::string>> resvec;
-        std::string query =
-            "SELECT timeslot_id, CONCAT(day_of_week, ' ', start_time, '-', end_time) FROM timeslots";
-        auto res = session.sql(query).execute();
-        mysqlx::Row row;
-        while ((row = res.fetchOne()))
-            resvec.emplace_back(row[0].get<int>(), row[1].get<std::string>());
-        return resvec;
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Cannot open " + path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat " + path);
+        }
+        length = static_cast<size_t>(st.st_size);
+        void* mapped = length ? ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+            throw std::runtime_error("Cannot map " + path);
+        bytes = static_cast<const uint8_t*>(mapped);
     }
-    std::vector<std::pair<std::string, std::string>> getAvailableRooms(int timeslot_id)
+    MappedFile(MappedFile&& other) noexcept : bytes(other.bytes), length(other.length)
     {
-        std::vector<std::pair<std::string, std::string>> resvec;
-        std::string query =
-            "SELECT room_id, CONCAT(room_number, ' ', building) FROM classrooms "
-            "WHERE room_id NOT IN (SELECT room_id FROM course_schedule WHERE timeslot_id = ?)";
-        auto res = session.sql(query).bind(timeslot_id).execute();
-        mysqlx::Row row;
-        while ((row = res.fetchOne()))
-            resvec.emplace_back(row[0].get<std::string>(), row[1].get<std::string>());
-        return resvec;
+        other.bytes = nullptr;
+        other.length = 0;
     }
-    std::vector<std::pair<int, std::string>> getAvailableFaculty(int timeslot_id)
+    MappedFile& operator=(MappedFile&& other) noexcept
     {
-        std::vector<std::pair<int, std::string>> resvec;
-        std::string query =
-            "SELECT faculty_id, CONCAT(first_name, ' ', last_name) FROM faculty "
-            "WHERE faculty_id NOT IN (SELECT faculty_id FROM course_schedule WHERE timeslot_id = ?)";
-        auto res = session.sql(query).bind(timeslot_id).execute();
-        mysqlx::Row row;
-        while ((row = res.fetchOne()))
-            resvec.emplace_back(row[0].get<int>(), row[1].get<std::string>());
-        return resvec;
+        std::swap(bytes, other.bytes);
+        std::swap(length, other.length);
+        return *this;
     }
-    void addCourseSchedule(const std::string& course_code, int faculty_id, int timeslot_id, const std::string& room_id)
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile()
     {
-        auto course_schedule = db.getTable("course_schedule");
-        course_schedule.insert("course_code", "faculty_id", "timeslot_id", "room_id")
-            .values(course_code, faculty_id, timeslot_id, room_id)
-            .execute();
+        if (bytes)
+            ::munmap(const_cast<uint8_t*>(bytes), length);
     }
-    struct ScheduledAssignment
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+// Column file layout (host byte order, checked on open):
+//   header      kind[4] version:u32 endian:u32 column_count:u32
+//   descriptor  name[24] width:u32 reserved:u32 rows:u64 offset:u64   (x column_count)
+//   data        each column 8-byte aligned, rows * width bytes
+// Integer columns are stored at the narrowest width (1, 2 or 4 bytes) that
+// holds their largest value, so a mapped column is read in place.
+struct ColumnFileHeader
+{
+    char kind[4];
+    uint32_t version;
+    uint32_t endian;
+    uint32_t column_count;
+};
+struct ColumnDescriptor
+{
+    char name[24];
+    uint32_t width;
+    uint32_t reserved;
+    uint64_t rows;
+    uint64_t offset;
+};
+static const uint32_t COLUMN_FILE_ENDIAN = 0x01020304;
+
+class ColumnFileWriter
+{
+    struct Pending
     {
-        int schedule_id;
-        std::string course_code, course_name, faculty_name, room, timeslot;
+        std::string name;
+        uint32_t width;
+        uint64_t rows;
+        std::string bytes;
     };
-    std::vector<ScheduledAssignment> getAllCourseSchedules()
+    std::vector<Pending> columns;
+
+public:
+    void addInts(const std::string& name, const std::vector<uint32_t>& values)
     {
-        std::vector<ScheduledAssignment> result;
-        std::string query =
-            "SELECT cs.schedule_id, cs.course_code, c.course_name, CONCAT(f.first_name, ' ', f.last_name) AS faculty, "
-            "CONCAT(cl.room_number, ' ', cl.building) AS room, CONCAT(t.day_of_week, ' ', t.start_time, '-', t.end_time) AS timeslot "
-            "FROM course_schedule cs "
-            "JOIN courses c ON cs.course_code = c.course_code "
-            "JOIN faculty f ON cs.faculty_id = f.faculty_id "
-            "JOIN timeslots t ON cs.timeslot_id = t.timeslot_id "
-            "JOIN classrooms cl ON cs.room_id = cl.room_id";
-        auto res = session.sql(query).execute();
-        mysqlx::Row row;
-        while ((row = res.fetchOne()))
+        uint32_t max = 0;
+        for (uint32_t v : values)
+            max = std::max(max, v);
+        uint32_t width = max <= 0xFF ? 1 : max <= 0xFFFF ? 2 : 4;
+        Pending p{name, width, values.size(), std::string(values.size() * width, '\0')};
+        for (size_t i = 0; i < values.size(); ++i)
         {
-            result.push_back({
-                row[0].get<int>(),
-                row[1].get<std::string>(),
-                row[2].get<std::string>(),
-                row[3].get<std::string>(),
-                row[4].get<std::string>(),
-                row[5].get<std::string>()
-            });
+            if (width == 1) p.bytes[i] = static_cast<char>(values[i]);
+            else if (width == 2) { uint16_t v = static_cast<uint16_t>(values[i]); std::memcpy(&p.bytes[i * 2], &v, 2); }
+            else std::memcpy(&p.bytes[i * 4], &values[i], 4);
         }
-        return result;
+        columns.push_back(std::move(p));
     }
-    void removeCourseSchedule(int schedule_id)
+    void addBytes(const std::string& name, const std::string& bytes)
+    {
+        columns.push_back({name, 1, bytes.size(), bytes});
+    }
+    // Writes to a temporary file, fsyncs, then renames over path.
+    void write(const std::string& path, const char kind[4], uint32_t version) const
     {
+        ColumnFileHeader header;
+        std::memcpy(header.kind, kind, 4);
+        header.version = version;
+        header.endian = COLUMN_FILE_ENDIAN;
+        header.column_count = static_cast<uint32_t>(columns.size());
+
+        std::string out(reinterpret_cast<const char*>(&header), sizeof(header));
+        uint64_t offset = sizeof(header) + columns.size() * sizeof(ColumnDescriptor);
+        for (const auto& c : columns)
         {
-            auto enrollments = db.getTable("enrollments");
-            enrollments.remove().where("schedule_id = :sid").bind("sid", schedule_id).execute();
+            offset = (offset + 7) & ~uint64_t(7);
+            ColumnDescriptor d;
+            std::memset(&d, 0, sizeof(d));
+            std::strncpy(d.name, c.name.c_str(), sizeof(d.name) - 1);
+            d.width = c.width;
+            d.rows = c.rows;
+            d.offset = offset;
+            out.append(reinterpret_cast<const char*>(&d), sizeof(d));
+            offset += c.bytes.size();
         }
+        for (const auto& c : columns)
         {
-            auto course_schedule = db.getTable("course_schedule");
-            course_schedule.remove().where("schedule_id = :sid").bind("sid", schedule_id).execute();
+            out.resize((out.size() + 7) & ~size_t(7), '\0');
+            out += c.bytes;
         }
+
+        std::string tmp = path + ".tmp";
+        int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            throw std::runtime_error("Cannot create " + tmp);
+        size_t written = 0;
+        while (written < out.size())
+        {
+            ssize_t n = ::write(fd, out.data() + written, out.size() - written);
+            if (n <= 0)
+            {
+                ::close(fd);
+                throw std::runtime_error("Cannot write " + tmp);
+            }
+            written += static_cast<size_t>(n);
+        }
+        bool ok = ::fsync(fd) == 0;
+        ::close(fd);
+        if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0)
+            throw std::runtime_error("Cannot commit " + path);
     }
-    bool isAdminPasswordCorrect(const std::string& password)
-    {
-        return password == "admin123";
-    }
+};
 
-    // Marks related methods
-    struct Mark {
-        std::string assignment_name;
-        int total_marks;
-        int obtained_marks;
-        std::string course_name;
+class ColumnFile
+{
+public:
+    struct Column
+    {
+        const uint8_t* data = nullptr;
+        uint32_t width = 0;
+        uint64_t rows = 0;
+        uint32_t operator[](size_t i) const
+        {
+            if (width == 1) return data[i];
+            if (width == 2) { uint16_t v; std::memcpy(&v, data + i * 2, 2); return v; }
+            uint32_t v;
+            std::memcpy(&v, data + i * 4, 4);
+            return v;
+        }
+        std::string bytes() const { return std::string(reinterpret_cast<const char*>(data), rows); }
+        // [first, last) rows equal to value in a column sorted ascending.
+        std::pair<size_t, size_t> equalRange(uint32_t value) const
+        {
+            size_t lo = 0, hi = rows;
+            while (lo < hi) { size_t mid = (lo + hi) / 2; if ((*this)[mid] < value) lo = mid + 1; else hi = mid; }
+            size_t first = lo;
+            hi = rows;
+            while (lo < hi) { size_t mid = (lo + hi) / 2; if ((*this)[mid] <= value) lo = mid + 1; else hi = mid; }
+            return {first, lo};
+        }
     };
-    std::vector<Mark> getStudentMarks(const std::string& student_id, const std::string& course_code = "")
+
+private:
+    MappedFile file;
+    std::unordered_map<std::string, Column> columns;
+
+public:
+    ColumnFile(const std::string& path, const char kind[4], uint32_t version) : file(path)
     {
-        std::vector<Mark> result;
-        std::string query =
-            "SELECT m.assignment_name, m.total_marks, m.obtained_marks, c.course_name "
-            "FROM marks m "
-            "JOIN courses c ON m.course_code = c.course_code "
-            "WHERE m.student_id = ?";
+        ColumnFileHeader header;
+        if (file.size() < sizeof(header))
+            throw std::runtime_error(path + ": truncated");
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.kind, kind, 4) != 0 || header.endian != COLUMN_FILE_ENDIAN)
+            throw std::runtime_error(path + ": not a readable " + std::string(kind, 4) + " file");
+        if (header.version != version)
+            throw std::runtime_error(path + ": unsupported version " + std::to_string(header.version));
+        if (file.size() < sizeof(header) + header.column_count * sizeof(ColumnDescriptor))
+            throw std::runtime_error(path + ": truncated");
+        for (uint32_t i = 0; i < header.column_count; ++i)
+        {
+            ColumnDescriptor d;
+            std::memcpy(&d, file.data() + sizeof(header) + i * sizeof(ColumnDescriptor), sizeof(d));
+            if (d.offset + d.rows * d.width > file.size())
+                throw std::runtime_error(path + ": column out of bounds");
+            columns[std::string(d.name, strnlen(d.name, sizeof(d.name)))] = {file.data() + d.offset, d.width, d.rows};
+        }
+    }
+    bool has(const std::string& name) const { return columns.count(name) > 0; }
+    const Column& column(const std::string& name) const
+    {
+        auto it = columns.find(name);
+        if (it == columns.end())
+            throw std::runtime_error("Missing column " + name);
+        return it->second;
+    }
+};
 
-        if (!course_code.empty()) {
-            query += " AND m.course_code = ?";
+// Sorted string dictionary stored as "<name>.offsets" + "<name>.bytes"; ids
+// follow sort order, so id order is string order.
+class StringDictionary
+{
+    std::vector<std::string> sorted;
+
+public:
+    explicit StringDictionary(std::vector<std::string> values)
+    {
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+        sorted = std::move(values);
+    }
+    uint32_t id(const std::string& value) const
+    {
+        return static_cast<uint32_t>(std::lower_bound(sorted.begin(), sorted.end(), value) - sorted.begin());
+    }
+    void write(ColumnFileWriter& out, const std::string& name) const
+    {
+        std::vector<uint32_t> offsets{0};
+        std::string bytes;
+        for (const auto& v : sorted)
+        {
+            bytes += v;
+            offsets.push_back(static_cast<uint32_t>(bytes.size()));
         }
+        out.addInts(name + ".offsets", offsets);
+        out.addBytes(name + ".bytes", bytes);
+    }
 
-        query += " ORDER BY m.assignment_name";
-        mysqlx::SqlStatement stmt = session.sql(query).bind(student_id);
-        if (!course_code.empty()) {
-            stmt.bind(course_code);
+    class View
+    {
+        ColumnFile::Column offsets, bytes;
+
+    public:
+        View() {}
+        View(const ColumnFile& file, const std::string& name)
+            : offsets(file.column(name + ".offsets")), bytes(file.column(name + ".bytes"))
+        {}
+        size_t size() const { return offsets.rows ? offsets.rows - 1 : 0; }
+        std::string get(uint32_t id) const
+        {
+            return std::string(reinterpret_cast<const char*>(bytes.data) + offsets[id], offsets[id + 1] - offsets[id]);
         }
-        auto res = stmt.execute();
-        mysqlx::Row row;
-        while ((row = res.fetchOne()))
+        // Id of value, or -1 if absent.
+        int64_t find(const std::string& value) const
         {
-            Mark mark;
-            mark.assignment_name = row[0].get<std::string>();
-            mark.total_marks = row[1].get<int>();
-            mark.obtained_marks = row[2].get<int>();
-            mark.course_name = row[3].get<std::string>();
-            result.push_back(mark);
+            size_t lo = 0, hi = size();
+            while (lo < hi)
+            {
+                size_t mid = (lo + hi) / 2;
+                int cmp = get(static_cast<uint32_t>(mid)).compare(value);
+                if (cmp == 0) return static_cast<int64_t>(mid);
+                if (cmp < 0) lo = mid + 1;
+                else hi = mid;
+            }
+            return -1;
         }
-        return result;
-    }
-    std::vector<std::string> getStudentCourses(const std::string& student_id)
+    };
+};
+
+// One closed term of enrollments and marks on disk, dictionary-encoded and
+// sorted by student so per-student reads are a binary search over a mapped column.
+class TermArchive
+{
+    ColumnFile file;
+    StringDictionary::View strings;
+    std::string termName;
+
+public:
+    static constexpr const char* KIND = "SCAR";
+    static constexpr uint32_t VERSION = 1;
+
+    struct Enrollment
     {
-        std::vector<std::string> result;
-        std::string query =
-            "SELECT DISTINCT c.course_code, c.course_name "
-            "FROM enrollments e "
-            "JOIN course_schedule cs ON e.schedule_id = cs.schedule_id "
-            "JOIN courses c ON cs.course_code = c.course_code "
-            "WHERE e.student_id = ?";
+        std::string student_id, course_code;
+        int faculty_id, timeslot_id;
+        std::string room_id;
+    };
+    struct Mark
+    {
+        std::string student_id, course_code, assignment_name;
+        int total_marks, obtained_marks;
+    };
 
-        auto res = session.sql(query).bind(student_id).execute();
-        mysqlx::Row row;
-        while ((row = res.fetchOne()))
+    static void write(const std::string& path, const std::string& term, std::vector<Enrollment> enrollments, std::vector<Mark> marks)
+    {
+        std::vector<std::string> values;
+        for (const auto& e : enrollments)
+            values.insert(values.end(), {e.student_id, e.course_code, e.room_id});
+        for (const auto& m : marks)
+            values.insert(values.end(), {m.student_id, m.course_code, m.assignment_name});
+        StringDictionary dict(values);
+        std::sort(enrollments.begin(), enrollments.end(), [](const Enrollment& a, const Enrollment& b) {
+            return std::tie(a.student_id, a.course_code) < std::tie(b.student_id, b.course_code);
+        });
+        std::sort(marks.begin(), marks.end(), [](const Mark& a, const Mark& b) {
+            return std::tie(a.student_id, a.course_code, a.assignment_name) < std::tie(b.student_id, b.course_code, b.assignment_name);
+        });
+
+        ColumnFileWriter out;
+        out.addBytes("term", term);
+        dict.write(out, "dict");
+        std::vector<uint32_t> c1, c2, c3, c4, c5;
+        for (const auto& e : enrollments)
+        {
+            c1.push_back(dict.id(e.student_id));
+            c2.push_back(dict.id(e.course_code));
+            c3.push_back(static_cast<uint32_t>(e.faculty_id));
+            c4.push_back(static_cast<uint32_t>(e.timeslot_id));
+            c5.push_back(dict.id(e.room_id));
+        }
+        out.addInts("e.student", c1);
+        out.addInts("e.course", c2);
+        out.addInts("e.faculty", c3);
+        out.addInts("e.timeslot", c4);
+        out.addInts("e.room", c5);
+        c1.clear(); c2.clear(); c3.clear(); c4.clear(); c5.clear();
+        for (const auto& m : marks)
         {
-            result.push_back(row[0].get<std::string>() + " - " + row[1].get<std::string>());
+            c1.push_back(dict.id(m.student_id));
+            c2.push_back(dict.id(m.course_code));
+            c3.push_back(dict.id(m.assignment_name));
+            c4.push_back(static_cast<uint32_t>(m.total_marks));
+            c5.push_back(static_cast<uint32_t>(m.obtained_marks));
         }
+        out.addInts("m.student", c1);
+        out.addInts("m.course", c2);
+        out.addInts("m.assignment", c3);
+        out.addInts("m.total", c4);
+        out.addInts("m.obtained", c5);
+        out.write(path, KIND, VERSION);
+    }
+
+    explicit TermArchive(const std::string& path)
+        : file(path, KIND, VERSION), strings(file, "dict"), termName(file.column("term").bytes())
+    {}
+
+    const std::string& term() const { return termName; }
+    size_t enrollmentCount() const { return file.column("e.student").rows; }
+    size_t markCount() const { return file.column("m.student").rows; }
+
+    std::vector<Mark> marksForStudent(const std::string& studentId) const
+    {
+        std::vector<Mark> result;
+        int64_t sid = strings.find(studentId);
+        if (sid < 0)
+            return result;
+        const auto& student = file.column("m.student");
+        const auto& course = file.column("m.course");
+        const auto& assignment = file.column("m.assignment");
+        const auto& total = file.column("m.total");
+        const auto& obtained = file.column("m.obtained");
+        auto r = student.equalRange(static_cast<uint32_t>(sid));
+        for (size_t i = r.first; i < r.second; ++i)
+            result.push_back({studentId, strings.get(course[i]), strings.get(assignment[i]),
+                              static_cast<int>(total[i]), static_cast<int>(obtained[i])});
+        return result;
+    }
+    std::vector<Enrollment> enrollmentsForStudent(const std::string& studentId) const
+    {
+        std::vector<Enrollment> result;
+        int64_t sid = strings.find(studentId);
+        if (sid < 0)
+            return result;
+        const auto& student = file.column("e.student");
+        const auto& course = file.column("e.course");
+        const auto& faculty = file.column("e.faculty");
+        const auto& timeslot = file.column("e.timeslot");
+        const auto& room = file.column("e.room");
+        auto r = student.equalRange(static_cast<uint32_t>(sid));
+        for (size_t i = r.first; i < r.second; ++i)
+            result.push_back({studentId, strings.get(course[i]), static_cast<int>(faculty[i]),
+                              static_cast<int>(timeslot[i]), strings.get(room[i])});
+        return result;
+    }
+    // Scans one column only; for historical per-course analytics.
+    std::map<std::string, int> enrollmentsPerCourse() const
+    {
+        std::vector<int> counts(strings.size(), 0);
+        const auto& course = file.column("e.course");
+        for (size_t i = 0; i < course.rows; ++i)
+            ++counts[course[i]];
+        std::map<std::string, int> result;
+        for (size_t id = 0; id < counts.size(); ++id)
+            if (counts[id])
+                result[strings.get(static_cast<uint32_t>(id))] = counts[id];
         return result;
     }
+    template <typename F>
+    void forEachEnrollment(F f) const
+    {
+        const auto& student = file.column("e.student");
+        const auto& course = file.column("e.course");
+        const auto& faculty = file.column("e.faculty");
+        const auto& timeslot = file.column("e.timeslot");
+        const auto& room = file.column("e.room");
+        for (size_t i = 0; i < student.rows; ++i)
+            f(Enrollment{strings.get(student[i]), strings.get(course[i]), static_cast<int>(faculty[i]),
+                         static_cast<int>(timeslot[i]), strings.get(room[i])});
+    }
+    template <typename F>
+    void forEachMark(F f) const
+    {
+        const auto& student = file.column("m.student");
+        const auto& course = file.column("m.course");
+        const auto& assignment = file.column("m.assignment");
+        const auto& total = file.column("m.total");
+        const auto& obtained = file.column("m.obtained");
+        for (size_t i = 0; i < student.rows; ++i)
+            f(Mark{strings.get(student[i]), strings.get(course[i]), strings.get(assignment[i]),
+                   static_cast<int>(total[i]), static_cast<int>(obtained[i])});
+    }
 };
 
-class Student : public Person
+// Whole-dataset snapshot in the column file format: reference tables, the
+// current schedule and enrollments (no passwords). Loading it only maps the
+// file, so it can warm Database caches at startup and serve the read-only
+// kiosk with no database at all. Students and enrollments are sorted by
+// student id, sections by schedule id, so lookups are binary searches.
+class Snapshot
 {
-    Database& db;
-
 public:
-    Student(Database& db, const std::string& id, const std::string& name, const std::string& email)
-        : Person(id, name, email), db(db)
-    {}
-    void menu() override
+    static constexpr const char* KIND = "SNAP";
+    static constexpr uint32_t VERSION = 1;
+
+    struct Course
     {
-        int choice;
-        do
-        {
-            std::cout << CYAN << "\n--- Student Menu ---\n" << RESET;
-            std::cout << "1. Add Course\n";
-            std::cout << "2. Drop Course\n";
-            std::cout << "3. View Timetable\n";
-            std::cout << "4. View Teachers\n";
-            std::cout << "5. View Classroom Details\n";
-            std::cout << "6. Export Timetable\n";
+        std::string code, name, department, prerequisites;
+        int credits, semester, max_students;
+    };
+    struct Room
+    {
+        std::string room_id, building, room_number, room_type;
+        int capacity;
+    };
+    struct Timeslot
+    {
+        int timeslot_id;
+        std::string day, start, end;
+    };
+    struct Member // student or faculty
+    {
+        std::string id, first_name, last_name, email, degree;
+        int semester; // students only
+    };
+    struct Section
+    {
+        int schedule_id;
+        std::string course_code;
+        int faculty_id, timeslot_id;
+        std::string room_id;
+        int seats_taken;
+    };
+    struct Contents
+    {
+        std::vector<Course> courses;
+        std::vector<Room> rooms;
+        std::vector<Timeslot> timeslots;
+        std::vector<Member> faculty, students;
+        std::vector<Section> sections;
+        std::vector<std::pair<std::string, int>> enrollments; // student_id, schedule_id
+    };
+
+private:
+    ColumnFile file;
+    StringDictionary::View strings;
+
+    std::string str(const char* column, size_t row) const { return strings.get(file.column(column)[row]); }
+    int num(const char* column, size_t row) const { return static_cast<int>(file.column(column)[row]); }
+    size_t rows(const char* column) const { return file.column(column).rows; }
+
+public:
+    static void write(const std::string& path, Contents c)
+    {
+        std::vector<std::string> values;
+        for (const auto& x : c.courses)
+            values.insert(values.end(), {x.code, x.name, x.department, x.prerequisites});
+        for (const auto& x : c.rooms)
+            values.insert(values.end(), {x.room_id, x.building, x.room_number, x.room_type});
+        for (const auto& x : c.timeslots)
+            values.insert(values.end(), {x.day, x.start, x.end});
+        for (const auto* people : {&c.faculty, &c.students})
+            for (const auto& x : *people)
+                values.insert(values.end(), {x.id, x.first_name, x.last_name, x.email, x.degree});
+        for (const auto& x : c.sections)
+            values.insert(values.end(), {x.course_code, x.room_id});
+        for (const auto& x : c.enrollments)
+            values.push_back(x.first);
+        StringDictionary dict(values);
+        std::sort(c.students.begin(), c.students.end(), [](const Member& a, const Member& b) { return a.id < b.id; });
+        std::sort(c.sections.begin(), c.sections.end(), [](const Section& a, const Section& b) { return a.schedule_id < b.schedule_id; });
+        std::sort(c.enrollments.begin(), c.enrollments.end());
+
+        ColumnFileWriter out;
+        out.addInts("created", {static_cast<uint32_t>(std::time(nullptr))});
+        dict.write(out, "dict");
+        auto ids = [&](const std::string& name, auto& rows, auto field) {
+            std::vector<uint32_t> col;
+            for (const auto& r : rows)
+                col.push_back(dict.id(field(r)));
+            out.addInts(name, col);
+        };
+        auto ints = [&](const std::string& name, auto& rows, auto field) {
+            std::vector<uint32_t> col;
+            for (const auto& r : rows)
+                col.push_back(static_cast<uint32_t>(field(r)));
+            out.addInts(name, col);
+        };
+        ids("c.code", c.courses, [](const Course& x) { return x.code; });
+        ids("c.name", c.courses, [](const Course& x) { return x.name; });
+        ids("c.department", c.courses, [](const Course& x) { return x.department; });
+        ids("c.prerequisites", c.courses, [](const Course& x) { return x.prerequisites; });
+        ints("c.credits", c.courses, [](const Course& x) { return x.credits; });
+        ints("c.semester", c.courses, [](const Course& x) { return x.semester; });
+        ints("c.max", c.courses, [](const Course& x) { return x.max_students; });
+        ids("r.id", c.rooms, [](const Room& x) { return x.room_id; });
+        ids("r.building", c.rooms, [](const Room& x) { return x.building; });
+        ids("r.number", c.rooms, [](const Room& x) { return x.room_number; });
+        ids("r.type", c.rooms, [](const Room& x) { return x.room_type; });
+        ints("r.capacity", c.rooms, [](const Room& x) { return x.capacity; });
+        ints("t.id", c.timeslots, [](const Timeslot& x) { return x.timeslot_id; });
+        ids("t.day", c.timeslots, [](const Timeslot& x) { return x.day; });
+        ids("t.start", c.timeslots, [](const Timeslot& x) { return x.start; });
+        ids("t.end", c.timeslots, [](const Timeslot& x) { return x.end; });
+        for (const auto& p : {std::make_pair("f.", &c.faculty), std::make_pair("s.", &c.students)})
+        {
+            std::string prefix = p.first;
+            ids(prefix + "id", *p.second, [](const Member& x) { return x.id; });
+            ids(prefix + "first", *p.second, [](const Member& x) { return x.first_name; });
+            ids(prefix + "last", *p.second, [](const Member& x) { return x.last_name; });
+            ids(prefix + "email", *p.second, [](const Member& x) { return x.email; });
+            ids(prefix + "degree", *p.second, [](const Member& x) { return x.degree; });
+            ints(prefix + "semester", *p.second, [](const Member& x) { return x.semester; });
+        }
+        ints("cs.id", c.sections, [](const Section& x) { return x.schedule_id; });
+        ids("cs.course", c.sections, [](const Section& x) { return x.course_code; });
+        ints("cs.faculty", c.sections, [](const Section& x) { return x.faculty_id; });
+        ints("cs.timeslot", c.sections, [](const Section& x) { return x.timeslot_id; });
+        ids("cs.room", c.sections, [](const Section& x) { return x.room_id; });
+        ints("cs.seats", c.sections, [](const Section& x) { return x.seats_taken; });
+        ids("e.student", c.enrollments, [](const std::pair<std::string, int>& x) { return x.first; });
+        ints("e.schedule", c.enrollments, [](const std::pair<std::string, int>& x) { return x.second; });
+        out.write(path, KIND, VERSION);
+    }
+
+    explicit Snapshot(const std::string& path) : file(path, KIND, VERSION), strings(file, "dict") {}
+
+    std::time_t created() const { return static_cast<std::time_t>(file.column("created")[0]); }
+
+    std::vector<Course> courses() const
+    {
+        std::vector<Course> result;
+        for (size_t i = 0; i < rows("c.code"); ++i)
+            result.push_back({str("c.code", i), str("c.name", i), str("c.department", i), str("c.prerequisites", i),
+                              num("c.credits", i), num("c.semester", i), num("c.max", i)});
+        return result;
+    }
+    std::vector<Room> rooms() const
+    {
+        std::vector<Room> result;
+        for (size_t i = 0; i < rows("r.id"); ++i)
+            result.push_back({str("r.id", i), str("r.building", i), str("r.number", i), str("r.type", i), num("r.capacity", i)});
+        return result;
+    }
+    std::vector<Timeslot> timeslots() const
+    {
+        std::vector<Timeslot> result;
+        for (size_t i = 0; i < rows("t.id"); ++i)
+            result.push_back({num("t.id", i), str("t.day", i), str("t.start", i), str("t.end", i)});
+        return result;
+    }
+    // prefix "f." for faculty, "s." for students
+    std::vector<Member> members(const std::string& prefix) const
+    {
+        std::vector<Member> result;
+        const auto& id = file.column(prefix + "id");
+        const auto& first = file.column(prefix + "first");
+        const auto& last = file.column(prefix + "last");
+        const auto& email = file.column(prefix + "email");
+        const auto& degree = file.column(prefix + "degree");
+        const auto& semester = file.column(prefix + "semester");
+        for (size_t i = 0; i < id.rows; ++i)
+            result.push_back({strings.get(id[i]), strings.get(first[i]), strings.get(last[i]), strings.get(email[i]),
+                              strings.get(degree[i]), static_cast<int>(semester[i])});
+        return result;
+    }
+    std::vector<Section> sections() const
+    {
+        std::vector<Section> result;
+        for (size_t i = 0; i < rows("cs.id"); ++i)
+            result.push_back({num("cs.id", i), str("cs.course", i), num("cs.faculty", i), num("cs.timeslot", i),
+                              str("cs.room", i), num("cs.seats", i)});
+        return result;
+    }
+    std::vector<int> scheduleIdsForStudent(const std::string& studentId) const
+    {
+        std::vector<int> result;
+        int64_t sid = strings.find(studentId);
+        if (sid < 0)
+            return result;
+        const auto& schedule = file.column("e.schedule");
+        auto r = file.column("e.student").equalRange(static_cast<uint32_t>(sid));
+        for (size_t i = r.first; i < r.second; ++i)
+            result.push_back(static_cast<int>(schedule[i]));
+        return result;
+    }
+    size_t enrollmentCount() const { return rows("e.student"); }
+};
+
+// Opt-in allocation accounting. The global operator new/delete below count
+// into plain thread-local totals while counting is on, so the hot paths
+// pay one relaxed load when it is off. TraceSpan takes the difference of
+// the totals across its scope, which attributes allocations to each menu
+// action and Database call (inclusive of the spans beneath it).
+class AllocationCounter
+{
+public:
+    struct Totals
+    {
+        uint64_t allocations = 0, bytes = 0, frees = 0;
+    };
+    static bool enabled()
+    {
+        return flag().load(std::memory_order_relaxed);
+    }
+    static void enable(bool on)
+    {
+        flag().store(on, std::memory_order_relaxed);
+    }
+    // The calling thread's running totals.
+    static Totals& local()
+    {
+        thread_local Totals totals;
+        return totals;
+    }
+    static void allocated(std::size_t size)
+    {
+        Totals& t = local();
+        ++t.allocations;
+        t.bytes += size;
+    }
+
+private:
+    static std::atomic<bool>& flag()
+    {
+        static std::atomic<bool> on{false};
+        return on;
+    }
+};
+
+// GCC inlines the replacements below into new/delete expressions and then
+// takes free() on operator new's memory for a mismatch.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void* operator new(std::size_t size)
+{
+    if (AllocationCounter::enabled())
+        AllocationCounter::allocated(size);
+    for (;;)
+    {
+        if (void* p = std::malloc(size ? size : 1))
+            return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (AllocationCounter::enabled())
+        AllocationCounter::allocated(size);
+    std::size_t align = static_cast<std::size_t>(alignment);
+    for (;;)
+    {
+        if (void* p = std::aligned_alloc(align, (size + align - 1) / align * align))
+            return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+void operator delete(void* p) noexcept
+{
+    if (p && AllocationCounter::enabled())
+        ++AllocationCounter::local().frees;
+    std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    operator delete(p);
+}
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+    operator delete(p);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// Span tracing, for "the timetable took 5 seconds" reports. A TraceSpan
+// records one complete event (category, name, start, duration) when it goes
+// out of scope. Spans on a thread nest by time, so a menu action shows the
+// Database calls and fetch loops it made. Each thread appends to a buffer of
+// its own and publishes with a release store, so recording takes no lock;
+// with tracing off a span costs one relaxed load. Names are kept by pointer
+// and must be string literals or __func__.
+class Tracer
+{
+public:
+    struct Event
+    {
+        const char* category;
+        const char* name;
+        uint64_t start, duration; // ns
+        uint64_t allocations, bytes; // with AllocationCounter on
+    };
+    struct Status
+    {
+        bool on = false;
+        size_t events = 0, threads = 0, dropped = 0;
+    };
+    // Per span name, over the current session.
+    struct Summary
+    {
+        std::string category, name;
+        uint64_t calls = 0, totalNs = 0, maxNs = 0, allocations = 0, bytes = 0;
+    };
+    static constexpr size_t EVENTS_PER_THREAD = 1 << 16;
+
+    static bool enabled()
+    {
+        return on().load(std::memory_order_relaxed);
+    }
+    // Starts a new session; events of the previous one are discarded.
+    static void start()
+    {
+        origin().store(now(), std::memory_order_relaxed);
+        epoch().fetch_add(1, std::memory_order_release);
+        on().store(true, std::memory_order_release);
+    }
+    static void stop()
+    {
+        on().store(false, std::memory_order_release);
+    }
+    // SCIT_TRACE=<file> traces the whole run and writes the trace on exit.
+    static void startFromEnvironment()
+    {
+        const char* allocs = std::getenv("SCIT_TRACE_ALLOCS");
+        if (allocs && *allocs && std::string(allocs) != "0")
+            AllocationCounter::enable(true);
+        const char* path = std::getenv("SCIT_TRACE");
+        if (!path || !*path)
+            return;
+        registry(); // built before the exit handler is registered, so it outlives it
+        start();
+        std::atexit([] {
+            try {
+                size_t events = writeChromeTrace(std::getenv("SCIT_TRACE"));
+                std::cerr << "Trace: " << events << " event(s) written to " << std::getenv("SCIT_TRACE") << std::endl;
+            }
+            catch (const std::exception& ex) {
+                std::cerr << ex.what() << std::endl;
+            }
+        });
+    }
+    static uint64_t now()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+    static void record(const char* category, const char* name, uint64_t start, uint64_t end,
+                       uint64_t allocations = 0, uint64_t bytes = 0)
+    {
+        Buffer& b = local();
+        uint64_t current = epoch().load(std::memory_order_acquire);
+        if (b.epoch.load(std::memory_order_relaxed) != current)
+        {
+            b.count.store(0, std::memory_order_relaxed);
+            b.dropped.store(0, std::memory_order_relaxed);
+            b.epoch.store(current, std::memory_order_release);
+        }
+        size_t n = b.count.load(std::memory_order_relaxed);
+        if (n == EVENTS_PER_THREAD)
+        {
+            b.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        b.events[n] = {category, name, start, end - start, allocations, bytes};
+        b.count.store(n + 1, std::memory_order_release);
+    }
+
+    static Status status()
+    {
+        Status s;
+        s.on = enabled();
+        forEachBuffer([&](const Buffer& b, size_t count) {
+            ++s.threads;
+            s.events += count;
+            s.dropped += b.dropped.load(std::memory_order_relaxed);
+        });
+        return s;
+    }
+    // Writes the current session as Chrome trace-event JSON, which Perfetto
+    // (ui.perfetto.dev) and chrome://tracing open directly. Returns the
+    // number of events written.
+    static size_t writeChromeTrace(const std::string& path)
+    {
+        std::ofstream out(path);
+        if (!out)
+            throw std::runtime_error("Cannot write trace " + path);
+        uint64_t base = origin().load(std::memory_order_relaxed);
+        size_t written = 0;
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        forEachBuffer([&](const Buffer& b, size_t count) {
+            out << (written ? ",\n" : "\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << b.tid
+                << ",\"args\":{\"name\":\"thread " << b.tid << "\"}}";
+            ++written;
+            for (size_t i = 0; i < count; ++i)
+            {
+                const Event& e = b.events[i];
+                out << ",\n{\"ph\":\"X\",\"cat\":\"" << e.category << "\",\"name\":\"" << e.name
+                    << "\",\"pid\":1,\"tid\":" << b.tid << ",\"ts\":" << std::fixed << std::setprecision(3)
+                    << (e.start > base ? e.start - base : 0) / 1000.0 << ",\"dur\":" << e.duration / 1000.0
+                    << ",\"args\":{\"allocations\":" << e.allocations << ",\"bytes\":" << e.bytes << "}}";
+                ++written;
+            }
+        });
+        out << "\n]}\n";
+        if (!out)
+            throw std::runtime_error("Cannot write trace " + path);
+        return written;
+    }
+
+    // Sorted by total time, slowest first.
+    static std::vector<Summary> summarize()
+    {
+        std::map<std::pair<std::string, std::string>, Summary> byName;
+        forEachBuffer([&](const Buffer& b, size_t count) {
+            for (size_t i = 0; i < count; ++i)
+            {
+                const Event& e = b.events[i];
+                Summary& s = byName[{e.category, e.name}];
+                ++s.calls;
+                s.totalNs += e.duration;
+                s.maxNs = std::max(s.maxNs, e.duration);
+                s.allocations += e.allocations;
+                s.bytes += e.bytes;
+            }
+        });
+        std::vector<Summary> result;
+        for (auto& entry : byName)
+        {
+            entry.second.category = entry.first.first;
+            entry.second.name = entry.first.second;
+            result.push_back(entry.second);
+        }
+        std::sort(result.begin(), result.end(), [](const Summary& a, const Summary& b) { return a.totalNs > b.totalNs; });
+        return result;
+    }
+
+private:
+    struct Buffer
+    {
+        std::unique_ptr<Event[]> events{new Event[EVENTS_PER_THREAD]};
+        std::atomic<size_t> count{0}, dropped{0};
+        std::atomic<uint64_t> epoch{0};
+        size_t tid = 0;
+    };
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Buffer>> buffers; // kept after their thread exits
+    };
+
+    static std::atomic<bool>& on()
+    {
+        static std::atomic<bool> flag{false};
+        return flag;
+    }
+    static std::atomic<uint64_t>& epoch()
+    {
+        static std::atomic<uint64_t> value{0};
+        return value;
+    }
+    static std::atomic<uint64_t>& origin()
+    {
+        static std::atomic<uint64_t> value{0};
+        return value;
+    }
+    static Registry& registry()
+    {
+        static Registry r;
+        return r;
+    }
+    // The calling thread's buffer, registered on its first span.
+    static Buffer& local()
+    {
+        thread_local Buffer* mine = nullptr;
+        if (!mine)
+        {
+            // The tracer's own buffer is not charged to the span being recorded.
+            AllocationCounter::Totals counted = AllocationCounter::local();
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.buffers.emplace_back(new Buffer);
+            mine = r.buffers.back().get();
+            mine->tid = r.buffers.size();
+            AllocationCounter::local() = counted;
+        }
+        return *mine;
+    }
+    template <typename F>
+    static void forEachBuffer(F visit)
+    {
+        Registry& r = registry();
+        uint64_t current = epoch().load(std::memory_order_acquire);
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (const auto& b : r.buffers)
+            if (b->epoch.load(std::memory_order_acquire) == current)
+                visit(*b, b->count.load(std::memory_order_acquire));
+    }
+};
+
+class TraceSpan
+{
+public:
+    TraceSpan(const char* category, const char* name)
+        : category(category), name(name), start(Tracer::enabled() ? Tracer::now() : 0)
+    {
+        if (start)
+            allocatedBefore = AllocationCounter::local();
+    }
+    ~TraceSpan()
+    {
+        if (!start)
+            return;
+        const AllocationCounter::Totals& now = AllocationCounter::local();
+        Tracer::record(category, name, start, Tracer::now(), now.allocations - allocatedBefore.allocations,
+                       now.bytes - allocatedBefore.bytes);
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* category;
+    const char* name;
+    uint64_t start;
+    AllocationCounter::Totals allocatedBefore;
+};
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SPAN(category, name) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(category, name)
+#define TRACE_FUNCTION(category) TRACE_SPAN(category, __func__)
+
+// Bounded multi-producer/multi-consumer queue (Vyukov). Each cell carries a
+// sequence number that tells producers and consumers whether it is free, so
+// neither side takes a lock. Capacity is rounded up to a power of two.
+template <typename T>
+class RingBuffer
+{
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    alignas(64) std::atomic<size_t> dequeuePos{0};
+
+public:
+    explicit RingBuffer(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        cells.reset(new Cell[size]);
+        mask = size - 1;
+        for (size_t i = 0; i < size; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    bool tryPush(T&& value)
+    {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false; // full
+            else
+                pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    bool tryPop(T& out)
+    {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    out = std::move(cell.value);
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false; // empty
+            else
+                pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+};
+
+inline uint32_t crc32(const char* data, size_t length)
+{
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; ++i)
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+enum class AuditOp : uint8_t
+{
+    StudentPassword = 1, FacultyPassword, Enroll, Drop, MarksAdd, MarksUpdate,
+    StudentAdd, StudentRemove, FacultyAdd, FacultyRemove, CourseAdd, CourseRemove,
+    ClassroomAdd, ClassroomRemove, TimeslotAdd, TimeslotRemove, ScheduleAdd, ScheduleRemove,
+    SeatRepair, TermArchive, Graduate, Promote, ScheduleClear, TermToDisk, ExamSchedule, SectionMove,
+    EnrollRejected
+};
+
+inline const char* auditOpName(AuditOp op)
+{
+    static const char* names[] = {
+        "?", "student-password", "faculty-password", "enroll", "drop", "marks-add", "marks-update",
+        "student-add", "student-remove", "faculty-add", "faculty-remove", "course-add", "course-remove",
+        "classroom-add", "classroom-remove", "timeslot-add", "timeslot-remove", "schedule-add", "schedule-remove",
+        "seat-repair", "term-archive", "graduate", "promote", "schedule-clear", "term-to-disk", "exam-schedule", "section-move",
+        "enroll-rejected"};
+    size_t i = static_cast<size_t>(op);
+    return i < sizeof(names) / sizeof(names[0]) ? names[i] : "?";
+}
+
+struct AuditEvent
+{
+    uint64_t seq = 0;
+    int64_t time_us = 0;
+    AuditOp op = AuditOp::StudentPassword;
+    std::string actor;   // who: "admin", "student:<id>", "faculty:<email>"
+    std::string subject; // whom: student id, faculty email, course code...
+    std::string object;  // what: course/assignment, schedule id...
+    std::string detail;  // new values
+};
+
+// Append-only binary journal of Database mutations. Callers only push onto a
+// lock-free ring; a background writer drains it in batches and issues one
+// fsync per batch (group commit).
+//
+// File: "SCAJ" version:u32, then records of
+//   length:u32 crc32:u32 payload[length]
+//   payload = seq:u64 time_us:i64 op:u8 then actor, subject, object, detail
+//             each as length:u16 + bytes
+// A torn record at the tail (crash mid-write) fails its CRC and ends replay;
+// it is cut off when the journal is next opened, and numbering resumes after
+// the last intact record. One journal is shared by everyone writing to a path
+// (see open()). A failed write or fsync stops the journal: the batch is not
+// counted as persisted, and record() and sync() throw from then on.
+class AuditJournal
+{
+    std::string path;
+    RingBuffer<AuditEvent> queue{8192};
+    std::atomic<uint64_t> issued{0};
+    std::atomic<uint64_t> persisted{0};
+    std::atomic<uint64_t> lost{0};
+    std::atomic<uint64_t> batches{0};
+    std::atomic<bool> running{false};
+    std::atomic<bool> failed{false};
+    std::string failure; // written once, before failed is set
+    std::thread writer;
+    int fd = -1;
+    off_t journalEnd = 0;
+
+    static void put(std::string& out, const void* p, size_t n) { out.append(static_cast<const char*>(p), n); }
+    static void putString(std::string& out, const std::string& s)
+    {
+        uint16_t n = static_cast<uint16_t>(std::min<size_t>(s.size(), 0xFFFF));
+        put(out, &n, 2);
+        out.append(s, 0, n);
+    }
+    static void encode(const AuditEvent& e, std::string& out)
+    {
+        std::string payload;
+        put(payload, &e.seq, 8);
+        put(payload, &e.time_us, 8);
+        put(payload, &e.op, 1);
+        putString(payload, e.actor);
+        putString(payload, e.subject);
+        putString(payload, e.object);
+        putString(payload, e.detail);
+        uint32_t length = static_cast<uint32_t>(payload.size());
+        uint32_t crc = crc32(payload.data(), payload.size());
+        put(out, &length, 4);
+        put(out, &crc, 4);
+        out += payload;
+    }
+
+    void run()
+    {
+        std::string batch;
+        AuditEvent event;
+        for (;;)
+        {
+            batch.clear();
+            uint64_t n = 0;
+            while (n < 4096 && queue.tryPop(event))
+            {
+                encode(event, batch);
+                ++n;
+            }
+            if (n == 0)
+            {
+                if (!running.load(std::memory_order_acquire) && persisted.load() + lost.load() == issued.load())
+                    return;
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+                continue;
+            }
+            std::string error = failed.load(std::memory_order_relaxed) ? failure : append(batch);
+            if (!error.empty())
+            {
+                if (!failed.load(std::memory_order_relaxed))
+                {
+                    std::cerr << "Audit journal " << path << ": " << error << std::endl;
+                    failure = error;
+                    failed.store(true, std::memory_order_release);
+                }
+                lost.fetch_add(n, std::memory_order_release);
+                continue;
+            }
+            batches.fetch_add(1, std::memory_order_relaxed);
+            persisted.fetch_add(n, std::memory_order_release);
+        }
+    }
+    // Writes and fsyncs one batch; on failure cuts the file back to the
+    // previous batch and returns why.
+    std::string append(const std::string& bytes)
+    {
+        size_t written = 0;
+        while (written < bytes.size())
+        {
+            ssize_t w = ::write(fd, bytes.data() + written, bytes.size() - written);
+            if (w < 0 && errno == EINTR)
+                continue;
+            if (w <= 0)
+                break;
+            written += static_cast<size_t>(w);
+        }
+        std::string error;
+        if (written < bytes.size())
+            error = std::string("write: ") + std::strerror(errno);
+        else if (::fsync(fd) != 0)
+            error = std::string("fsync: ") + std::strerror(errno);
+        if (error.empty())
+            journalEnd += static_cast<off_t>(bytes.size());
+        else if (::ftruncate(fd, journalEnd) != 0)
+            error += "; the journal may end in a torn record";
+        return error;
+    }
+    void check() const
+    {
+        if (failed.load(std::memory_order_acquire))
+            throw std::runtime_error("Audit journal " + path + " failed (" + failure + ")");
+    }
+
+public:
+    static constexpr const char* MAGIC = "SCAJ";
+    static constexpr uint32_t VERSION = 1;
+
+    explicit AuditJournal(const std::string& path) : path(path)
+    {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0600);
+        if (fd < 0)
+        {
+            std::cerr << "Audit journal disabled: cannot open " << path << std::endl;
+            return;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size == 0)
+        {
+            std::string header(MAGIC, 4);
+            put(header, &VERSION, 4);
+            if (::write(fd, header.data(), header.size()) != static_cast<ssize_t>(header.size()) || ::fsync(fd) != 0)
+            {
+                std::cerr << "Audit journal disabled: cannot write " << path << std::endl;
+                ::close(fd);
+                fd = -1;
+                return;
+            }
+            journalEnd = static_cast<off_t>(header.size());
+        }
+        else
+        {
+            // Carry on numbering from the last intact record, dropping a torn tail.
+            uint64_t lastSeq = 0;
+            size_t end = 0;
+            try {
+                scan(path, [&](const AuditEvent& e) { lastSeq = std::max(lastSeq, e.seq); }, end);
+            }
+            catch (const std::runtime_error& ex) {
+                std::cerr << "Audit journal disabled: " << ex.what() << std::endl;
+                ::close(fd);
+                fd = -1;
+                return;
+            }
+            if (end < static_cast<size_t>(st.st_size))
+            {
+                std::cerr << "Audit journal " << path << ": dropping " << st.st_size - static_cast<off_t>(end)
+                          << " byte(s) of torn tail" << std::endl;
+                if (::ftruncate(fd, static_cast<off_t>(end)) != 0)
+                    std::cerr << "Audit journal " << path << ": cannot truncate: " << std::strerror(errno) << std::endl;
+            }
+            journalEnd = static_cast<off_t>(end);
+            issued = lastSeq;
+            persisted = lastSeq;
+        }
+        running = true;
+        writer = std::thread(&AuditJournal::run, this);
+    }
+    // One journal per path, shared by every Database in the process, so
+    // sequence numbers stay unique and batches never interleave.
+    static std::shared_ptr<AuditJournal> open(const std::string& path)
+    {
+        static std::mutex registryMutex;
+        static std::map<std::string, std::weak_ptr<AuditJournal>> registry;
+        std::error_code ec;
+        std::string key = std::filesystem::weakly_canonical(path, ec).string();
+        if (ec)
+            key = path;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto& slot = registry[key];
+        auto journal = slot.lock();
+        if (!journal)
+        {
+            journal = std::make_shared<AuditJournal>(path);
+            slot = journal;
+        }
+        return journal;
+    }
+    ~AuditJournal()
+    {
+        running = false;
+        if (writer.joinable())
+            writer.join();
+        if (fd >= 0)
+            ::close(fd);
+    }
+    AuditJournal(const AuditJournal&) = delete;
+    AuditJournal& operator=(const AuditJournal&) = delete;
+
+    void record(AuditOp op, const std::string& actor, const std::string& subject, const std::string& object = "", const std::string& detail = "")
+    {
+        if (fd < 0)
+            return;
+        check();
+        AuditEvent e;
+        e.seq = issued.fetch_add(1, std::memory_order_relaxed) + 1;
+        e.time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        e.op = op;
+        e.actor = actor;
+        e.subject = subject;
+        e.object = object;
+        e.detail = detail;
+        while (!queue.tryPush(std::move(e)))
+            std::this_thread::yield(); // full: wait for the writer rather than drop
+    }
+    // Blocks until everything recorded so far is on disk; throws if some of
+    // it could not be written.
+    void sync()
+    {
+        uint64_t target = issued.load();
+        while (fd >= 0 && persisted.load(std::memory_order_acquire) + lost.load(std::memory_order_acquire) < target)
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        check();
+    }
+    uint64_t recordCount() const { return persisted.load(); }
+    uint64_t batchCount() const { return batches.load(); }
+
+    // Calls f for every intact record in path; returns the number read. Stops
+    // at the first truncated or corrupt record.
+    static size_t replay(const std::string& path, const std::function<void(const AuditEvent&)>& f)
+    {
+        size_t intactEnd;
+        return scan(path, f, intactEnd);
+    }
+    // As replay, also setting intactEnd to the offset just past the last intact record.
+    static size_t scan(const std::string& path, const std::function<void(const AuditEvent&)>& f, size_t& intactEnd)
+    {
+        MappedFile file(path);
+        const uint8_t* p = file.data();
+        size_t size = file.size(), at = 8, count = 0;
+        if (size < 8 || std::memcmp(p, MAGIC, 4) != 0)
+            throw std::runtime_error(path + ": not an audit journal");
+        auto getString = [&](size_t& pos, size_t end, std::string& out) {
+            if (pos + 2 > end) return false;
+            uint16_t n;
+            std::memcpy(&n, p + pos, 2);
+            if (pos + 2 + n > end) return false;
+            out.assign(reinterpret_cast<const char*>(p + pos + 2), n);
+            pos += 2 + n;
+            return true;
+        };
+        while (at + 8 <= size)
+        {
+            uint32_t length, crc;
+            std::memcpy(&length, p + at, 4);
+            std::memcpy(&crc, p + at + 4, 4);
+            size_t begin = at + 8, end = begin + length;
+            if (end > size || length < 17 || crc32(reinterpret_cast<const char*>(p + begin), length) != crc)
+                break;
+            AuditEvent e;
+            size_t pos = begin;
+            std::memcpy(&e.seq, p + pos, 8);
+            std::memcpy(&e.time_us, p + pos + 8, 8);
+            e.op = static_cast<AuditOp>(p[pos + 16]);
+            pos += 17;
+            if (!getString(pos, end, e.actor) || !getString(pos, end, e.subject) ||
+                !getString(pos, end, e.object) || !getString(pos, end, e.detail))
+                break;
+            f(e);
+            ++count;
+            at = end;
+        }
+        intactEnd = at;
+        return count;
+    }
+
+    static std::string format(const AuditEvent& e)
+    {
+        std::time_t secs = static_cast<std::time_t>(e.time_us / 1000000);
+        char when[32];
+        std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", std::localtime(&secs));
+        std::ostringstream out;
+        out << when << "  #" << e.seq << "  " << std::left << std::setw(17) << auditOpName(e.op)
+            << " by " << e.actor << "  " << e.subject;
+        if (!e.object.empty()) out << "  " << e.object;
+        if (!e.detail.empty()) out << "  " << e.detail;
+        return out.str();
+    }
+};
+
+// Fast registration: seat counters for every section live in memory and a
+// seat is taken or given back with a compare-and-swap, with no database
+// round trip. Confirmed enrollments are appended to a checksummed journal
+// (the AuditJournal framing) and fsynced in groups. A writer thread then
+// applies them to the database in batches a few times a second. apply()
+// reports which records it could not store, e.g. duplicates, and their seats
+// are given back. After a crash, the records past the checkpoint file are
+// replayed before the counters are loaded again. If the journal cannot be
+// written, the records of that group are dropped and their seats given back,
+// and take() throws from then on: no seat is confirmed that is not on disk.
+class SeatReservations
+{
+public:
+    struct Reservation
+    {
+        uint64_t seq = 0;
+        int32_t schedule_id = 0;
+        std::string student_id;
+        std::string request_key; // "" if the caller gave none
+    };
+    typedef std::function<std::vector<bool>(const std::vector<Reservation>&)> Apply;
+    struct Counter
+    {
+        int schedule_id, taken, capacity, timeslot_id;
+    };
+    enum Result { Taken, Full, Unknown };
+    struct Stats
+    {
+        uint64_t taken = 0, full = 0, journalled = 0, applied = 0, rejected = 0, batches = 0;
+    };
+
+    static constexpr const char* MAGIC = "SCSJ";
+    static constexpr uint32_t VERSION = 2; // 2 added the request key
+    static constexpr int APPLY_INTERVAL_MS = 250;
+    static constexpr int GROUP_COMMIT_US = 500;
+
+    // Replays anything left over from a previous run through apply, then
+    // starts a fresh journal. Call load() before taking seats.
+    SeatReservations(const std::string& path, Apply apply)
+        : path(path), apply(std::move(apply))
+    {
+        recover();
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0)
+            throw std::runtime_error("Cannot open seat journal " + path);
+        std::string header(MAGIC, 4);
+        put(header, &VERSION, 4);
+        if (::write(fd, header.data(), header.size()) != static_cast<ssize_t>(header.size()) || ::fsync(fd) != 0)
+            throw std::runtime_error("Cannot write seat journal " + path);
+        journalEnd = static_cast<off_t>(header.size());
+        writeCheckpoint(0);
+        running = true;
+        writer = std::thread(&SeatReservations::run, this);
+    }
+    ~SeatReservations()
+    {
+        running = false;
+        if (writer.joinable())
+            writer.join();
+        if (fd >= 0)
+            ::close(fd);
+    }
+    SeatReservations(const SeatReservations&) = delete;
+    SeatReservations& operator=(const SeatReservations&) = delete;
+
+    // Not safe while seats are being taken; call once after construction.
+    void load(const std::vector<Counter>& counters)
+    {
+        int maxId = 0;
+        for (const auto& c : counters)
+            maxId = std::max(maxId, c.schedule_id);
+        slotOf.assign(maxId + 1, -1);
+        slots.reset(new Slot[counters.size()]);
+        for (size_t i = 0; i < counters.size(); ++i)
+        {
+            slots[i].taken.store(counters[i].taken, std::memory_order_relaxed);
+            slots[i].capacity = counters[i].capacity;
+            slots[i].timeslot_id = counters[i].timeslot_id;
+            slotOf[counters[i].schedule_id] = static_cast<int32_t>(i);
+        }
+    }
+
+    // Throws once the journal has failed.
+    void check() const
+    {
+        if (failed.load(std::memory_order_acquire))
+            throw std::runtime_error("Seat journal " + path + " failed (" + failure + "); fast registration stopped");
+    }
+    Result take(int schedule_id)
+    {
+        check();
+        Slot* s = slot(schedule_id);
+        if (!s)
+            return Unknown;
+        int taken = s->taken.load(std::memory_order_relaxed);
+        do
+        {
+            if (taken >= s->capacity)
+            {
+                full.fetch_add(1, std::memory_order_relaxed);
+                return Full;
+            }
+        } while (!s->taken.compare_exchange_weak(taken, taken + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+        takenCount.fetch_add(1, std::memory_order_relaxed);
+        return Taken;
+    }
+    void give(int schedule_id)
+    {
+        Slot* s = slot(schedule_id);
+        if (!s)
+            return;
+        int taken = s->taken.load(std::memory_order_relaxed);
+        while (taken > 0 && !s->taken.compare_exchange_weak(taken, taken - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+            ;
+    }
+    // Marks the sections pending for the student unless one of them shares a
+    // timeslot with another or with a section already pending for them. The
+    // check and the mark are one step, so concurrent sessions cannot both
+    // pass it. Call before take(); unhold() if the seats are not submitted.
+    bool hold(const std::string& studentId, const std::vector<int>& scheduleIds)
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        std::vector<int>& pending = pendingSeats[studentId];
+        std::vector<int> timeslots;
+        for (int schedule_id : pending)
+            if (Slot* s = slot(schedule_id))
+                timeslots.push_back(s->timeslot_id);
+        for (int schedule_id : scheduleIds)
+        {
+            Slot* s = slot(schedule_id);
+            if (!s || std::find(timeslots.begin(), timeslots.end(), s->timeslot_id) != timeslots.end())
+            {
+                if (pending.empty())
+                    pendingSeats.erase(studentId);
+                return false;
+            }
+            timeslots.push_back(s->timeslot_id);
+        }
+        pending.insert(pending.end(), scheduleIds.begin(), scheduleIds.end());
+        return true;
+    }
+    void unhold(const std::string& studentId, const std::vector<int>& scheduleIds)
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        for (int schedule_id : scheduleIds)
+            unpend(studentId, schedule_id);
+    }
+    // Queues a held, taken seat for the journal; returns its sequence number.
+    // A requestKey should first be claimed with claimKey().
+    uint64_t submit(int schedule_id, const std::string& studentId, const std::string& requestKey = "")
+    {
+        Reservation r;
+        r.schedule_id = schedule_id;
+        r.student_id = studentId;
+        r.request_key = requestKey;
+        r.seq = issued.fetch_add(1, std::memory_order_relaxed) + 1;
+        uint64_t seq = r.seq;
+        while (!queue.tryPush(std::move(r)))
+            std::this_thread::yield();
+        return seq;
+    }
+    // Blocks until seq is on disk in the journal. Throws if the journal
+    // failed first; the seat has then been given back.
+    void waitDurable(uint64_t seq)
+    {
+        while (durable.load(std::memory_order_acquire) < seq)
+        {
+            if (failed.load(std::memory_order_acquire) && durable.load(std::memory_order_acquire) < seq)
+                throw std::runtime_error("Seat journal " + path + " failed (" + failure + "); enrollment not taken");
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+    // Blocks until everything submitted so far, and still journalled, is in
+    // the database.
+    void sync()
+    {
+        uint64_t target = issued.load();
+        for (;;)
+        {
+            uint64_t reachable = failed.load(std::memory_order_acquire) ? std::min<uint64_t>(target, durable.load()) : target;
+            if (applied.load(std::memory_order_acquire) >= reachable)
+                return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    // Request keys of enrollments not yet in the database. claimKey returns
+    // false if the key is already pending; releaseKey undoes a claim that
+    // was never submitted.
+    bool claimKey(const std::string& requestKey)
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        return pendingKeys.insert(requestKey).second;
+    }
+    void releaseKey(const std::string& requestKey)
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pendingKeys.erase(requestKey);
+    }
+    // Enrollments submitted but not yet applied, for the menu checks that
+    // would otherwise only see the database.
+    bool isPending(const std::string& studentId, int schedule_id)
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        auto it = pendingSeats.find(studentId);
+        return it != pendingSeats.end() && std::find(it->second.begin(), it->second.end(), schedule_id) != it->second.end();
+    }
+    bool isPendingAt(const std::string& studentId, int timeslot_id)
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        auto it = pendingSeats.find(studentId);
+        if (it == pendingSeats.end())
+            return false;
+        for (int schedule_id : it->second)
+        {
+            Slot* s = slot(schedule_id);
+            if (s && s->timeslot_id == timeslot_id)
+                return true;
+        }
+        return false;
+    }
+    // -1 for sections not in the counters.
+    int timeslotOf(int schedule_id)
+    {
+        Slot* s = slot(schedule_id);
+        return s ? s->timeslot_id : -1;
+    }
+    Stats getStats() const
+    {
+        Stats s;
+        s.taken = takenCount.load();
+        s.full = full.load();
+        s.journalled = durable.load();
+        s.applied = applied.load();
+        s.rejected = rejected.load();
+        s.batches = batches.load();
+        return s;
+    }
+
+private:
+    struct alignas(64) Slot // one cache line each, so hot sections don't share one
+    {
+        std::atomic<int> taken{0};
+        int capacity = 0;
+        int timeslot_id = 0;
+    };
+    std::string path;
+    Apply apply;
+    std::unique_ptr<Slot[]> slots;
+    std::vector<int32_t> slotOf; // schedule_id -> slot, -1 if not loaded
+    RingBuffer<Reservation> queue{65536};
+    std::atomic<uint64_t> issued{0}, durable{0}, applied{0};
+    std::atomic<uint64_t> takenCount{0}, full{0}, rejected{0}, batches{0};
+    std::atomic<bool> running{false};
+    std::thread writer;
+    int fd = -1;
+    off_t journalEnd = 0; // end of the last fsynced group
+    std::atomic<bool> failed{false};
+    std::string failure;  // written once, before failed is set
+    std::mutex pendingMutex;
+    std::map<std::string, std::vector<int>> pendingSeats; // student -> schedule_ids not yet applied
+    std::set<std::string> pendingKeys;
+
+    Slot* slot(int schedule_id)
+    {
+        if (schedule_id < 0 || static_cast<size_t>(schedule_id) >= slotOf.size() || slotOf[schedule_id] < 0)
+            return nullptr;
+        return &slots[slotOf[schedule_id]];
+    }
+    static void put(std::string& out, const void* p, size_t n) { out.append(static_cast<const char*>(p), n); }
+    static void encode(const Reservation& r, std::string& out)
+    {
+        std::string payload;
+        uint16_t keyLength = static_cast<uint16_t>(r.request_key.size());
+        put(payload, &r.seq, 8);
+        put(payload, &r.schedule_id, 4);
+        put(payload, &keyLength, 2);
+        payload += r.request_key;
+        payload += r.student_id;
+        uint32_t length = static_cast<uint32_t>(payload.size());
+        uint32_t crc = crc32(payload.data(), payload.size());
+        put(out, &length, 4);
+        put(out, &crc, 4);
+        out += payload;
+    }
+
+    std::string checkpointPath() const { return path + ".ckpt"; }
+    void writeCheckpoint(uint64_t seq)
+    {
+        std::string tmp = checkpointPath() + ".tmp";
+        int cfd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (cfd < 0)
+            return;
+        bool ok = ::write(cfd, &seq, 8) == 8 && ::fsync(cfd) == 0;
+        ::close(cfd);
+        if (ok)
+            std::rename(tmp.c_str(), checkpointPath().c_str());
+    }
+    uint64_t readCheckpoint() const
+    {
+        uint64_t seq = 0;
+        std::ifstream in(checkpointPath(), std::ios::binary);
+        in.read(reinterpret_cast<char*>(&seq), 8);
+        return in ? seq : 0;
+    }
+
+    // Applies journalled records newer than the checkpoint, stopping at the
+    // first torn or corrupt one (it was never confirmed to anyone).
+    void recover()
+    {
+        if (!std::filesystem::exists(path))
+            return;
+        MappedFile file(path);
+        const uint8_t* p = file.data();
+        size_t size = file.size(), at = 8;
+        if (size < 8 || std::memcmp(p, MAGIC, 4) != 0)
+            return;
+        uint32_t version;
+        std::memcpy(&version, p + 4, 4);
+        size_t fixed = version >= 2 ? 14 : 12; // seq, schedule_id[, key length]
+        uint64_t done = readCheckpoint();
+        std::vector<Reservation> pending;
+        while (at + 8 <= size)
+        {
+            uint32_t length, crc;
+            std::memcpy(&length, p + at, 4);
+            std::memcpy(&crc, p + at + 4, 4);
+            size_t begin = at + 8, end = begin + length;
+            if (end > size || length < fixed || crc32(reinterpret_cast<const char*>(p + begin), length) != crc)
+                break;
+            Reservation r;
+            std::memcpy(&r.seq, p + begin, 8);
+            std::memcpy(&r.schedule_id, p + begin + 8, 4);
+            uint16_t keyLength = 0;
+            if (version >= 2)
+                std::memcpy(&keyLength, p + begin + 12, 2);
+            if (fixed + keyLength > length)
+                break;
+            const char* text = reinterpret_cast<const char*>(p + begin + fixed);
+            r.request_key.assign(text, keyLength);
+            r.student_id.assign(text + keyLength, length - fixed - keyLength);
+            if (r.seq > done)
+                pending.push_back(std::move(r));
+            at = end;
+        }
+        for (size_t i = 0; i < pending.size(); i += 4096)
+        {
+            std::vector<Reservation> batch(pending.begin() + i, pending.begin() + std::min(pending.size(), i + 4096));
+            auto ok = apply(batch);
+            std::cerr << "Seat journal: replayed " << std::count(ok.begin(), ok.end(), true) << " of " << batch.size()
+                      << " enrollment(s)" << std::endl;
+        }
+    }
+
+    // Caller holds pendingMutex.
+    void unpend(const std::string& studentId, int schedule_id)
+    {
+        auto it = pendingSeats.find(studentId);
+        if (it == pendingSeats.end())
+            return;
+        auto at = std::find(it->second.begin(), it->second.end(), schedule_id);
+        if (at != it->second.end())
+            it->second.erase(at);
+        if (it->second.empty())
+            pendingSeats.erase(it);
+    }
+    // Clears applied records from the pending lists. Seats of records the
+    // database refused (ok[i] false), or that never reached the journal (no
+    // ok), go back to the counters.
+    void settle(const std::vector<Reservation>& records, const std::vector<bool>* ok)
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        for (size_t i = 0; i < records.size(); ++i)
+        {
+            const Reservation& r = records[i];
+            if (!ok || i >= ok->size() || !(*ok)[i])
+                give(r.schedule_id);
+            unpend(r.student_id, r.schedule_id);
+            if (!r.request_key.empty())
+                pendingKeys.erase(r.request_key);
+        }
+    }
+    // Appends one group and fsyncs it. On failure the journal is cut back to
+    // the previous group, so a torn group is not replayed, and the reason is
+    // returned.
+    std::string append(const std::string& bytes)
+    {
+        size_t written = 0;
+        while (written < bytes.size())
+        {
+            ssize_t w = ::write(fd, bytes.data() + written, bytes.size() - written);
+            if (w < 0 && errno == EINTR)
+                continue;
+            if (w <= 0)
+                break;
+            written += static_cast<size_t>(w);
+        }
+        std::string error;
+        if (written < bytes.size())
+            error = std::string("write: ") + std::strerror(errno);
+        else if (::fsync(fd) != 0)
+            error = std::string("fsync: ") + std::strerror(errno);
+        if (error.empty())
+            journalEnd += static_cast<off_t>(bytes.size());
+        else if (::ftruncate(fd, journalEnd) != 0 || ::lseek(fd, journalEnd, SEEK_SET) < 0)
+            error += "; the journal may end in a torn group";
+        return error;
+    }
+
+    void run()
+    {
+        std::string bytes;
+        std::vector<Reservation> fresh, unapplied;
+        auto lastApply = std::chrono::steady_clock::now();
+        Reservation r;
+        for (;;)
+        {
+            bytes.clear();
+            fresh.clear();
+            uint64_t last = 0;
+            while (unapplied.size() + fresh.size() < 65536 && queue.tryPop(r))
+            {
+                encode(r, bytes);
+                last = r.seq;
+                fresh.push_back(std::move(r));
+            }
+            if (last)
+            {
+                // Once the journal has failed nothing more is written to it.
+                std::string error = failed.load(std::memory_order_relaxed) ? failure : append(bytes);
+                if (error.empty())
+                {
+                    durable.store(last, std::memory_order_release);
+                    std::move(fresh.begin(), fresh.end(), std::back_inserter(unapplied));
+                }
+                else
+                {
+                    if (!failed.load(std::memory_order_relaxed))
+                    {
+                        std::cerr << "Seat journal " << path << ": " << error << "; fast registration stopped" << std::endl;
+                        failure = error;
+                        failed.store(true, std::memory_order_release);
+                    }
+                    settle(fresh, nullptr);
+                }
+            }
+            bool stopping = !running.load(std::memory_order_acquire);
+            auto now = std::chrono::steady_clock::now();
+            if (!unapplied.empty() && (stopping || unapplied.size() >= 4096 ||
+                                       now - lastApply >= std::chrono::milliseconds(APPLY_INTERVAL_MS)))
+            {
+                std::vector<bool> ok;
+                try {
+                    ok = apply(unapplied);
+                }
+                catch (const std::exception& ex) {
+                    // Still in the journal; try the same batch again shortly.
+                    std::cerr << "Seat journal: batch of " << unapplied.size() << " not applied: " << ex.what() << std::endl;
+                    lastApply = now;
+                    if (stopping)
+                        return; // replayed on the next start
+                    continue;
+                }
+                for (size_t i = 0; i < unapplied.size(); ++i)
+                    if (i >= ok.size() || !ok[i])
+                        rejected.fetch_add(1, std::memory_order_relaxed);
+                settle(unapplied, &ok);
+                uint64_t through = unapplied.back().seq;
+                writeCheckpoint(through);
+                batches.fetch_add(1, std::memory_order_relaxed);
+                applied.store(through, std::memory_order_release);
+                unapplied.clear();
+                lastApply = now;
+            }
+            if (!last && unapplied.empty())
+            {
+                uint64_t target = failed.load(std::memory_order_acquire) ? durable.load() : issued.load();
+                if (stopping && applied.load() >= target)
+                    return;
+            }
+            if (!last)
+                std::this_thread::sleep_for(std::chrono::microseconds(GROUP_COMMIT_US));
+        }
+    }
+};
+
+// In-memory lookup of students and faculty by id, name or email. A trie over
+// lowercased tokens answers prefix queries; a trigram index finds candidates
+// for misspelt queries, which are then ranked by edit distance. Removed people
+// are tombstoned and skipped.
+class PeopleIndex
+{
+public:
+    enum Kind { StudentEntry, FacultyEntry };
+    struct Entry
+    {
+        Kind kind;
+        std::string key; // student_id or faculty email
+        int faculty_id;
+        std::string name, email;
+        bool live;
+    };
+    struct Match
+    {
+        Entry entry;
+        int distance; // 0 for exact/prefix hits
+    };
+
+private:
+    struct TrieNode
+    {
+        std::vector<std::pair<char, uint32_t>> next;
+        std::vector<uint32_t> ids;
+    };
+    std::vector<Entry> entries;
+    std::unordered_map<std::string, uint32_t> byKey;
+    std::vector<TrieNode> trie{1};
+    std::unordered_map<uint32_t, std::vector<uint32_t>> grams;
+    std::vector<std::vector<std::string>> entryTokens;
+
+    static std::string lower(const std::string& s)
+    {
+        std::string out(s);
+        for (char& ch : out)
+            ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+        return out;
+    }
+    static std::string keyOf(Kind kind, const std::string& key) { return (kind == StudentEntry ? "s:" : "f:") + lower(key); }
+    static uint32_t gram(const std::string& s, size_t i)
+    {
+        return (uint32_t(uint8_t(s[i])) << 16) | (uint32_t(uint8_t(s[i + 1])) << 8) | uint8_t(s[i + 2]);
+    }
+    static std::vector<uint32_t> gramsOf(const std::string& token)
+    {
+        std::string padded = "$" + token + "$";
+        std::vector<uint32_t> result;
+        for (size_t i = 0; i + 2 < padded.size(); ++i)
+            result.push_back(gram(padded, i));
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+
+    void insertToken(const std::string& token, uint32_t id)
+    {
+        uint32_t at = 0;
+        for (char ch : token)
+        {
+            auto& next = trie[at].next;
+            auto it = std::find_if(next.begin(), next.end(), [ch](const std::pair<char, uint32_t>& e) { return e.first == ch; });
+            if (it == next.end())
+            {
+                trie.emplace_back();
+                trie[at].next.push_back({ch, static_cast<uint32_t>(trie.size() - 1)});
+                at = static_cast<uint32_t>(trie.size() - 1);
+            }
+            else
+                at = it->second;
+        }
+        trie[at].ids.push_back(id);
+        for (uint32_t g : gramsOf(token))
+            grams[g].push_back(id);
+    }
+
+    void collect(uint32_t node, std::vector<uint32_t>& out, std::vector<char>& seen, size_t limit) const
+    {
+        for (uint32_t id : trie[node].ids)
+        {
+            if (out.size() >= limit)
+                return;
+            if (entries[id].live && !seen[id])
+            {
+                seen[id] = 1;
+                out.push_back(id);
+            }
+        }
+        for (const auto& child : trie[node].next)
+        {
+            if (out.size() >= limit)
+                return;
+            collect(child.second, out, seen, limit);
+        }
+    }
+
+    // Levenshtein distance, giving up (returning max + 1) once it must exceed max.
+    static int editDistance(const std::string& a, const std::string& b, int max)
+    {
+        if (std::abs(static_cast<int>(a.size()) - static_cast<int>(b.size())) > max)
+            return max + 1;
+        std::vector<int> prev(b.size() + 1), cur(b.size() + 1);
+        for (size_t j = 0; j <= b.size(); ++j)
+            prev[j] = static_cast<int>(j);
+        for (size_t i = 1; i <= a.size(); ++i)
+        {
+            cur[0] = static_cast<int>(i);
+            int best = cur[0];
+            for (size_t j = 1; j <= b.size(); ++j)
+            {
+                cur[j] = std::min({prev[j] + 1, cur[j - 1] + 1, prev[j - 1] + (a[i - 1] != b[j - 1])});
+                best = std::min(best, cur[j]);
+            }
+            if (best > max)
+                return max + 1;
+            std::swap(prev, cur);
+        }
+        return prev[b.size()];
+    }
+
+public:
+    void clear()
+    {
+        entries.clear();
+        byKey.clear();
+        trie.assign(1, TrieNode());
+        grams.clear();
+        entryTokens.clear();
+    }
+    size_t size() const { return byKey.size(); }
+
+    void add(Kind kind, const std::string& key, int faculty_id, const std::string& first, const std::string& last, const std::string& email)
+    {
+        remove(kind, key);
+        uint32_t id = static_cast<uint32_t>(entries.size());
+        entries.push_back({kind, key, faculty_id, first + " " + last, email, true});
+        byKey[keyOf(kind, key)] = id;
+        std::vector<std::string> tokens = {lower(key), lower(first), lower(last), lower(first + " " + last), lower(email)};
+        size_t at = email.find('@');
+        if (at != std::string::npos)
+            tokens.push_back(lower(email.substr(0, at)));
+        std::sort(tokens.begin(), tokens.end());
+        tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+        tokens.erase(std::remove(tokens.begin(), tokens.end(), ""), tokens.end());
+        for (const auto& t : tokens)
+            insertToken(t, id);
+        entryTokens.push_back(tokens);
+    }
+    void remove(Kind kind, const std::string& key)
+    {
+        auto it = byKey.find(keyOf(kind, key));
+        if (it == byKey.end())
+            return;
+        entries[it->second].live = false;
+        byKey.erase(it);
+    }
+    void removeFaculty(int faculty_id)
+    {
+        for (auto& e : entries)
+            if (e.live && e.kind == FacultyEntry && e.faculty_id == faculty_id)
+            {
+                byKey.erase(keyOf(FacultyEntry, e.key));
+                e.live = false;
+            }
+    }
+
+    // Prefix hits first, then typo-tolerant hits by distance. kind < 0 searches both.
+    std::vector<Match> search(const std::string& query, size_t limit, int kind = -1) const
+    {
+        std::vector<Match> result;
+        std::string q = lower(query);
+        if (q.empty())
+            return result;
+        std::vector<char> seen(entries.size(), 0);
+        auto wanted = [&](uint32_t id) { return kind < 0 || entries[id].kind == kind; };
+
+        uint32_t at = 0;
+        bool found = true;
+        for (char ch : q)
+        {
+            const auto& next = trie[at].next;
+            auto it = std::find_if(next.begin(), next.end(), [ch](const std::pair<char, uint32_t>& e) { return e.first == ch; });
+            if (it == next.end())
+            {
+                found = false;
+                break;
+            }
+            at = it->second;
+        }
+        if (found)
+        {
+            std::vector<uint32_t> ids;
+            collect(at, ids, seen, entries.size());
+            for (uint32_t id : ids)
+                if (wanted(id))
+                    result.push_back({entries[id], 0});
+            std::sort(result.begin(), result.end(), [](const Match& a, const Match& b) { return a.entry.key < b.entry.key; });
+            if (result.size() > limit)
+                result.resize(limit);
+        }
+        if (!result.empty())
+            return result;
+
+        // Trigrams shared by a large share of everyone (e.g. "$s1" in student
+        // ids) cannot narrow anything down, so they are skipped unless nothing
+        // rarer is left.
+        int max = q.size() <= 4 ? 1 : 2;
+        std::vector<uint32_t> queryGrams = gramsOf(q);
+        std::vector<const std::vector<uint32_t>*> postings;
+        size_t common = std::max<size_t>(1024, entries.size() / 8);
+        for (uint32_t g : queryGrams)
+        {
+            auto it = grams.find(g);
+            if (it != grams.end() && it->second.size() <= common)
+                postings.push_back(&it->second);
+        }
+        int needed = std::max<int>(1, static_cast<int>(postings.size()) - 3 * max);
+        std::vector<uint16_t> shared(entries.size(), 0);
+        std::vector<uint32_t> touched;
+        for (const auto* list : postings)
+            for (uint32_t id : *list)
+                if (shared[id]++ == 0)
+                    touched.push_back(id);
+        std::vector<std::pair<int, uint32_t>> candidates;
+        for (uint32_t id : touched)
+            if (shared[id] >= needed && entries[id].live && wanted(id))
+                candidates.push_back({shared[id], id});
+        std::sort(candidates.begin(), candidates.end(), std::greater<std::pair<int, uint32_t>>());
+        if (candidates.size() > 256)
+            candidates.resize(256);
+
+        std::vector<Match> fuzzy;
+        for (const auto& c : candidates)
+        {
+            int best = max + 1;
+            for (const auto& token : entryTokens[c.second])
+            {
+                best = std::min(best, editDistance(q, token, max));
+                if (token.size() > q.size())
+                    best = std::min(best, editDistance(q, token.substr(0, q.size()), max));
+            }
+            if (best <= max)
+                fuzzy.push_back({entries[c.second], best});
+        }
+        std::sort(fuzzy.begin(), fuzzy.end(), [](const Match& a, const Match& b) {
+            return a.distance != b.distance ? a.distance < b.distance : a.entry.key < b.entry.key;
+        });
+        for (const auto& m : fuzzy)
+        {
+            if (result.size() >= limit)
+                break;
+            result.push_back(m);
+        }
+        return result;
+    }
+};
+
+// Rooms or faculty by timeslot, one bit per booked slot. Row and column counts
+// come straight from popcounts over the row words.
+class OccupancyMatrix
+{
+    std::vector<Bitset> rows;
+    size_t slots;
+
+public:
+    OccupancyMatrix(size_t rowCount, size_t slotCount) : rows(rowCount, Bitset(slotCount)), slots(slotCount) {}
+
+    size_t rowCount() const { return rows.size(); }
+    size_t slotCount() const { return slots; }
+    // Returns false if the slot was already booked (a double booking).
+    bool book(size_t row, size_t slot)
+    {
+        if (rows[row].test(slot))
+            return false;
+        rows[row].set(slot);
+        return true;
+    }
+    size_t booked(size_t row) const { return rows[row].count(); }
+    size_t totalBooked() const
+    {
+        size_t n = 0;
+        for (const auto& r : rows)
+            n += r.count();
+        return n;
+    }
+    double utilisation(size_t row) const { return slots ? double(booked(row)) / slots : 0.0; }
+    double utilisation() const { return slots && !rows.empty() ? double(totalBooked()) / (slots * rows.size()) : 0.0; }
+    std::vector<size_t> idleSlots(size_t row) const
+    {
+        std::vector<size_t> idle;
+        for (size_t s = 0; s < slots; ++s)
+            if (!rows[row].test(s))
+                idle.push_back(s);
+        return idle;
+    }
+    // Number of rows booked in each slot.
+    std::vector<size_t> slotLoad() const
+    {
+        std::vector<size_t> load(slots, 0);
+        for (const auto& r : rows)
+            r.forEach([&](size_t s) { if (s < slots) ++load[s]; });
+        return load;
+    }
+};
+
+// Sorted (block, word) pairs holding only the non-zero 64-bit blocks, for sets
+// that are large but thin, like the students of one course.
+class SparseBitset
+{
+    std::vector<std::pair<uint32_t, uint64_t>> blocks;
+
+public:
+    void set(uint32_t i)
+    {
+        uint32_t block = i / 64;
+        uint64_t bit = uint64_t(1) << (i % 64);
+        if (blocks.empty() || blocks.back().first < block)
+        {
+            blocks.push_back({block, bit});
+            return;
+        }
+        auto it = std::lower_bound(blocks.begin(), blocks.end(), std::make_pair(block, uint64_t(0)));
+        if (it != blocks.end() && it->first == block)
+            it->second |= bit;
+        else
+            blocks.insert(it, {block, bit});
+    }
+    size_t count() const
+    {
+        size_t n = 0;
+        for (const auto& b : blocks)
+            n += __builtin_popcountll(b.second);
+        return n;
+    }
+    size_t intersectCount(const SparseBitset& other) const
+    {
+        size_t n = 0;
+        auto a = blocks.begin(), b = other.blocks.begin();
+        while (a != blocks.end() && b != other.blocks.end())
+        {
+            if (a->first < b->first)
+                ++a;
+            else if (b->first < a->first)
+                ++b;
+            else
+                n += __builtin_popcountll((a++)->second & (b++)->second);
+        }
+        return n;
+    }
+    template <typename F>
+    void forEach(F f) const
+    {
+        for (const auto& b : blocks)
+            for (uint64_t w = b.second; w; w &= w - 1)
+                f(b.first * 64 + __builtin_ctzll(w));
+    }
+};
+
+// Exam timetabling as graph colouring: courses sharing a student conflict, and
+// colours are exam slots. Each worker thread runs a randomised DSATUR to get a
+// feasible timetable, then a tabu search (TabuCol) that keeps trying to empty
+// the last slot. A slot may not seat more students than the campus holds;
+// a course may spread over several rooms.
+class ExamScheduler
+{
+public:
+    struct Sitting
+    {
+        std::string course_code, room_id;
+        int slot, seats;
+    };
+    struct Result
+    {
+        std::vector<int> slot; // per course
+        int slots = 0;
+        int lowerBound = 0;       // no timetable can use fewer slots
+        long long backToBack = 0; // students with exams in consecutive slots
+        long long peakSeats = 0;
+        size_t edges = 0;
+        int runs = 0;
+        double millis = 0;
+        std::vector<Sitting> sittings;
+        std::vector<std::string> unseated; // courses not every student of which has a seat
+    };
+
+private:
+    std::vector<std::string> codes;
+    std::unordered_map<std::string, uint32_t> courseIndex;
+    std::unordered_map<std::string, uint32_t> studentIndex;
+    std::vector<SparseBitset> members;
+    std::vector<std::vector<uint32_t>> studentCourses;
+    std::vector<int> sizes;
+    std::vector<std::vector<uint32_t>> adj;
+    std::vector<std::vector<uint32_t>> shared; // students shared with adj[v][i]
+    std::vector<std::pair<std::string, int>> rooms;
+    long long capacity = 0;
+
+    struct Solution
+    {
+        std::vector<int> colour;
+        int colours = 0;
+    };
+
+    Solution dsatur(std::mt19937& rng) const
+    {
+        size_t n = codes.size();
+        Solution s;
+        s.colour.assign(n, -1);
+        std::vector<Bitset> neighbourColours(n);
+        std::vector<int> satur(n, 0);
+        std::vector<uint32_t> tiebreak(n);
+        for (auto& t : tiebreak)
+            t = rng();
+        std::vector<long long> load;
+        for (size_t step = 0; step < n; ++step)
+        {
+            size_t v = n;
+            for (size_t u = 0; u < n; ++u)
+            {
+                if (s.colour[u] >= 0)
+                    continue;
+                if (v == n || std::make_tuple(satur[u], adj[u].size(), tiebreak[u]) > std::make_tuple(satur[v], adj[v].size(), tiebreak[v]))
+                    v = u;
+            }
+            int c = 0;
+            while (c < static_cast<int>(load.size()) &&
+                   (neighbourColours[v].test(c) || (load[c] > 0 && load[c] + sizes[v] > capacity)))
+                ++c;
+            if (c == static_cast<int>(load.size()))
+                load.push_back(0);
+            s.colour[v] = c;
+            load[c] += sizes[v];
+            for (uint32_t u : adj[v])
+                if (s.colour[u] < 0 && !neighbourColours[u].test(c))
+                {
+                    neighbourColours[u].set(c);
+                    ++satur[u];
+                }
+        }
+        s.colours = static_cast<int>(load.size());
+        return s;
+    }
+
+    // Tries to recolour `s` with k colours: the last colour's courses are
+    // scattered at random over the colours with room for them and conflicts
+    // are then removed by tabu search. A course too big for the campus may
+    // only sit alone, as dsatur leaves it.
+    bool tabuReduce(Solution& s, int k, std::mt19937& rng, std::chrono::steady_clock::time_point deadline) const
+    {
+        size_t n = codes.size();
+        std::vector<int> colour = s.colour;
+        std::vector<long long> load(k, 0);
+        std::vector<int> courses(k, 0);
+        std::vector<size_t> moved;
+        for (size_t v = 0; v < n; ++v)
+        {
+            if (colour[v] >= k)
+                moved.push_back(v);
+            else
+            {
+                load[colour[v]] += sizes[v];
+                ++courses[colour[v]];
+            }
+        }
+        std::vector<int> fits;
+        for (size_t v : moved)
+        {
+            fits.clear();
+            for (int c = 0; c < k; ++c)
+                if (load[c] + sizes[v] <= capacity)
+                    fits.push_back(c);
+            if (fits.empty())
+                return false;
+            colour[v] = fits[rng() % fits.size()];
+            load[colour[v]] += sizes[v];
+            ++courses[colour[v]];
+        }
+        std::vector<int> gamma(n * k, 0); // neighbours of v in colour c
+        long long conflicts = 0;
+        for (size_t v = 0; v < n; ++v)
+            for (uint32_t u : adj[v])
+            {
+                ++gamma[v * k + colour[u]];
+                if (u > v && colour[u] == colour[v])
+                    ++conflicts;
+            }
+        std::vector<long long> tabu(n * k, 0);
+        const long long maxIterations = 200000;
+        for (long long iter = 1; conflicts > 0 && iter <= maxIterations; ++iter)
+        {
+            if ((iter & 1023) == 0 && std::chrono::steady_clock::now() > deadline)
+                return false;
+            long long bestDelta = LLONG_MAX;
+            size_t bestV = n;
+            int bestC = -1;
+            uint32_t ties = 0;
+            for (size_t v = 0; v < n; ++v)
+            {
+                int cur = colour[v];
+                if (gamma[v * k + cur] == 0)
+                    continue;
+                for (int c = 0; c < k; ++c)
+                {
+                    if (c == cur || load[c] + sizes[v] > capacity)
+                        continue;
+                    long long delta = gamma[v * k + c] - gamma[v * k + cur];
+                    // Aspiration: a tabu move is allowed if it clears everything.
+                    if (tabu[v * k + c] >= iter && conflicts + delta > 0)
+                        continue;
+                    if (delta < bestDelta || (delta == bestDelta && rng() % ++ties == 0))
+                    {
+                        if (delta < bestDelta)
+                            ties = 1;
+                        bestDelta = delta;
+                        bestV = v;
+                        bestC = c;
+                    }
+                }
+            }
+            if (bestV == n)
+                continue;
+            int old = colour[bestV];
+            colour[bestV] = bestC;
+            load[old] -= sizes[bestV];
+            load[bestC] += sizes[bestV];
+            --courses[old];
+            ++courses[bestC];
+            conflicts += bestDelta;
+            for (uint32_t u : adj[bestV])
+            {
+                --gamma[u * k + old];
+                ++gamma[u * k + bestC];
+            }
+            tabu[bestV * k + old] = iter + static_cast<long long>(0.6 * conflicts) + rng() % 10;
+        }
+        if (conflicts > 0)
+            return false;
+        for (int c = 0; c < k; ++c)
+            if (load[c] > capacity && courses[c] > 1)
+                return false;
+        s.colour = colour;
+        s.colours = k;
+        return true;
+    }
+
+    int greedyClique() const
+    {
+        std::vector<uint32_t> order(codes.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = static_cast<uint32_t>(i);
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return adj[a].size() > adj[b].size(); });
+        size_t best = order.empty() ? 0 : 1;
+        for (size_t start = 0; start < order.size() && start < 32; ++start)
+        {
+            std::vector<uint32_t> clique = {order[start]};
+            for (uint32_t v : order)
+            {
+                bool joins = true;
+                for (uint32_t c : clique)
+                    if (c == v || !std::binary_search(adj[v].begin(), adj[v].end(), c))
+                    {
+                        joins = false;
+                        break;
+                    }
+                if (joins)
+                    clique.push_back(v);
+            }
+            best = std::max(best, clique.size());
+        }
+        return static_cast<int>(best);
+    }
+
+public:
+    void addRoom(const std::string& room_id, int seats)
+    {
+        rooms.push_back({room_id, seats});
+        capacity += seats;
+    }
+    void addCourse(const std::string& code)
+    {
+        if (courseIndex.count(code))
+            return;
+        courseIndex[code] = static_cast<uint32_t>(codes.size());
+        codes.push_back(code);
+        members.emplace_back();
+    }
+    void addEnrollment(const std::string& code, const std::string& student)
+    {
+        addCourse(code);
+        auto s = studentIndex.emplace(student, static_cast<uint32_t>(studentIndex.size()));
+        if (s.second)
+            studentCourses.emplace_back();
+        uint32_t course = courseIndex[code];
+        auto& list = studentCourses[s.first->second];
+        if (std::find(list.begin(), list.end(), course) != list.end())
+            return;
+        list.push_back(course);
+        members[course].set(s.first->second);
+    }
+
+    Result solve(unsigned threads, std::chrono::milliseconds budget)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = start + budget;
+        size_t n = codes.size();
+        Result result;
+
+        // Conflict graph: candidate neighbours come from each member's course
+        // list; the edge weight is the size of the intersection.
+        sizes.assign(n, 0);
+        adj.assign(n, {});
+        shared.assign(n, {});
+        std::vector<uint32_t> seen(n, UINT32_MAX);
+        for (uint32_t a = 0; a < n; ++a)
+        {
+            sizes[a] = static_cast<int>(members[a].count());
+            members[a].forEach([&](size_t student) {
+                for (uint32_t b : studentCourses[student])
+                    if (b != a && seen[b] != a)
+                    {
+                        seen[b] = a;
+                        adj[a].push_back(b);
+                    }
+            });
+            std::sort(adj[a].begin(), adj[a].end());
+            for (uint32_t b : adj[a])
+                shared[a].push_back(static_cast<uint32_t>(members[a].intersectCount(members[b])));
+            result.edges += adj[a].size();
+        }
+        result.edges /= 2;
+        for (uint32_t v = 0; v < n; ++v)
+            if (sizes[v] > capacity)
+                result.unseated.push_back(codes[v]);
+        // Neither a clique nor the total seats needed can share fewer slots.
+        long long totalSeats = 0;
+        for (int size : sizes)
+            totalSeats += size;
+        result.lowerBound = greedyClique();
+        if (capacity > 0)
+            result.lowerBound = std::max<int>(result.lowerBound, static_cast<int>((totalSeats + capacity - 1) / capacity));
+
+        threads = std::max(1u, threads);
+        std::vector<Solution> best(threads);
+        std::vector<int> runs(threads, 0);
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t)
+            workers.emplace_back([&, t]() {
+                std::mt19937 rng(0x5eed + t * 7919);
+                do
+                {
+                    Solution s = dsatur(rng);
+                    while (s.colours > result.lowerBound && tabuReduce(s, s.colours - 1, rng, deadline))
+                        ;
+                    if (best[t].colour.empty() || s.colours < best[t].colours)
+                        best[t] = s;
+                    ++runs[t];
+                } while (std::chrono::steady_clock::now() < deadline && best[t].colours > result.lowerBound);
+            });
+        for (auto& w : workers)
+            w.join();
+
+        const Solution* winner = &best[0];
+        for (const auto& s : best)
+            if (s.colours < winner->colours)
+                winner = &s;
+        result.slot = winner->colour;
+        result.slots = winner->colours;
+        for (int r : runs)
+            result.runs += r;
+
+        std::vector<long long> load(result.slots, 0);
+        for (uint32_t v = 0; v < n; ++v)
+        {
+            load[result.slot[v]] += sizes[v];
+            for (size_t i = 0; i < adj[v].size(); ++i)
+                if (adj[v][i] > v && std::abs(result.slot[v] - result.slot[adj[v][i]]) == 1)
+                    result.backToBack += shared[v][i];
+        }
+        for (long long l : load)
+            result.peakSeats = std::max(result.peakSeats, l);
+
+        // Seat each slot largest course first, always drawing on the room with
+        // the most seats left.
+        std::vector<std::vector<uint32_t>> bySlot(result.slots);
+        for (uint32_t v = 0; v < n; ++v)
+            bySlot[result.slot[v]].push_back(v);
+        for (int slot = 0; slot < result.slots; ++slot)
+        {
+            auto& list = bySlot[slot];
+            std::sort(list.begin(), list.end(), [&](uint32_t a, uint32_t b) { return sizes[a] > sizes[b]; });
+            std::vector<std::pair<int, size_t>> free;
+            for (size_t r = 0; r < rooms.size(); ++r)
+                free.push_back({rooms[r].second, r});
+            for (uint32_t v : list)
+            {
+                int need = sizes[v];
+                while (need > 0)
+                {
+                    auto most = std::max_element(free.begin(), free.end());
+                    if (most == free.end() || most->first == 0)
+                        break;
+                    int seats = std::min(need, most->first);
+                    result.sittings.push_back({codes[v], rooms[most->second].first, slot + 1, seats});
+                    most->first -= seats;
+                    need -= seats;
+                }
+                if (need > 0 && sizes[v] <= capacity)
+                    result.unseated.push_back(codes[v]);
+            }
+        }
+        result.millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+};
+
+// Min-cost flow by successive shortest paths (SPFA). Small graphs only: the
+// section balancer has one node per student and section.
+class MinCostFlow
+{
+    struct Edge
+    {
+        size_t to;
+        int cap;
+        long long cost;
+    };
+    std::vector<Edge> edges;
+    std::vector<std::vector<size_t>> out;
+
+public:
+    explicit MinCostFlow(size_t nodes) : out(nodes) {}
+    // Returns the edge id, for flowOn.
+    size_t addEdge(size_t from, size_t to, int cap, long long cost)
+    {
+        out[from].push_back(edges.size());
+        edges.push_back({to, cap, cost});
+        out[to].push_back(edges.size());
+        edges.push_back({from, 0, -cost});
+        return edges.size() - 2;
+    }
+    int flowOn(size_t edge) const { return edges[edge ^ 1].cap; }
+    // Pushes up to maxFlow units from s to t; returns {flow, cost}.
+    std::pair<int, long long> solve(size_t s, size_t t, int maxFlow)
+    {
+        int flow = 0;
+        long long cost = 0;
+        size_t n = out.size();
+        while (flow < maxFlow)
+        {
+            std::vector<long long> dist(n, LLONG_MAX);
+            std::vector<size_t> via(n, SIZE_MAX);
+            std::vector<char> queued(n, 0);
+            std::vector<size_t> queue = {s};
+            dist[s] = 0;
+            for (size_t head = 0; head < queue.size(); ++head)
+            {
+                size_t u = queue[head];
+                queued[u] = 0;
+                for (size_t id : out[u])
+                {
+                    const Edge& e = edges[id];
+                    if (e.cap > 0 && dist[u] + e.cost < dist[e.to])
+                    {
+                        dist[e.to] = dist[u] + e.cost;
+                        via[e.to] = id;
+                        if (!queued[e.to])
+                        {
+                            queued[e.to] = 1;
+                            queue.push_back(e.to);
+                        }
+                    }
+                }
+            }
+            if (dist[t] == LLONG_MAX)
+                break;
+            int push = maxFlow - flow;
+            for (size_t v = t; v != s; v = edges[via[v] ^ 1].to)
+                push = std::min(push, edges[via[v]].cap);
+            for (size_t v = t; v != s; v = edges[via[v] ^ 1].to)
+            {
+                edges[via[v]].cap -= push;
+                edges[via[v] ^ 1].cap += push;
+            }
+            flow += push;
+            cost += push * dist[t];
+        }
+        return {flow, cost};
+    }
+};
+
+// Evens out parallel sections (CS202A, CS202B, ...) of a course. Each movable
+// student may go to any section that does not clash with their other
+// enrollments. The k-th seat of a section costs 2k-1 (so total cost tracks the
+// sum of squared section sizes); leaving one's current section costs a little
+// extra, so among equally balanced answers the one with fewest moves wins.
+class SectionBalancer
+{
+public:
+    struct Section
+    {
+        int schedule_id;
+        std::string course_code;
+        int capacity;
+        int pinned = 0; // students who cannot move (already marked, or clash everywhere else)
+        int before = 0, after = 0;
+    };
+    struct Move
+    {
+        std::string student_id;
+        size_t from, to; // section indices
+    };
+
+private:
+    struct Student
+    {
+        std::string id;
+        size_t current;
+        std::vector<size_t> allowed;
+    };
+    std::vector<Section> sections;
+    std::vector<Student> students;
+
+public:
+    size_t addSection(int schedule_id, const std::string& course_code, int capacity)
+    {
+        sections.push_back({schedule_id, course_code, capacity});
+        return sections.size() - 1;
+    }
+    void pin(size_t section)
+    {
+        ++sections[section].pinned;
+        ++sections[section].before;
+    }
+    // `allowed` must include the current section.
+    void addStudent(const std::string& id, size_t current, const std::vector<size_t>& allowed)
+    {
+        students.push_back({id, current, allowed});
+        ++sections[current].before;
+    }
+    const std::vector<Section>& getSections() const { return sections; }
+
+    std::vector<Move> solve()
+    {
+        size_t n = students.size();
+        size_t source = n + sections.size(), sink = source + 1;
+        MinCostFlow flow(sink + 1);
+        long long weight = static_cast<long long>(n) + 1; // one seat step outweighs every move
+        std::vector<std::vector<std::pair<size_t, size_t>>> choice(n); // (section, edge)
+        for (size_t i = 0; i < n; ++i)
+        {
+            flow.addEdge(source, i, 1, 0);
+            for (size_t sec : students[i].allowed)
+                choice[i].push_back({sec, flow.addEdge(i, n + sec, 1, sec == students[i].current ? 0 : 1)});
+        }
+        for (size_t sec = 0; sec < sections.size(); ++sec)
+        {
+            // Sections already over capacity keep their students rather than
+            // making the flow infeasible.
+            int seats = std::max(sections[sec].capacity, sections[sec].before) - sections[sec].pinned;
+            for (int k = 1; k <= seats; ++k)
+                flow.addEdge(n + sec, sink, 1, (2 * (sections[sec].pinned + k) - 1) * weight);
+        }
+        flow.solve(source, sink, static_cast<int>(n));
+
+        std::vector<Move> moves;
+        for (auto& sec : sections)
+            sec.after = sec.pinned;
+        for (size_t i = 0; i < n; ++i)
+            for (const auto& c : choice[i])
+                if (flow.flowOn(c.second))
+                {
+                    ++sections[c.first].after;
+                    if (c.first != students[i].current)
+                        moves.push_back({students[i].id, students[i].current, c.first});
+                }
+        return moves;
+    }
+};
+
+// Distribution statistics over percentage scores. The hot loops (sums, min/max,
+// z-scores) run two doubles at a time with SSE2 on x86-64 or NEON on arm64 and
+// fall back to plain loops elsewhere; percentiles use nth_element on a copy.
+class GradeStats
+{
+public:
+    static const int BINS = 10; // 0-9, 10-19, ... 90-100
+    struct Summary
+    {
+        size_t count = 0;
+        double mean = 0, stddev = 0, min = 0, max = 0;
+        double median = 0, p10 = 0, p25 = 0, p75 = 0, p90 = 0;
+        size_t histogram[BINS] = {};
+        std::vector<double> z;       // per score, same order as the input
+        std::vector<char> outlier;   // outside the 1.5 IQR fences
+    };
+
+    static void sums(const double* v, size_t n, double& sum, double& squares, double& lo, double& hi)
+    {
+        size_t i = 0;
+        lo = n ? v[0] : 0;
+        hi = lo;
+#if defined(__SSE2__)
+        __m128d s = _mm_setzero_pd(), q = _mm_setzero_pd(), mn = _mm_set1_pd(lo), mx = mn;
+        for (; i + 2 <= n; i += 2)
+        {
+            __m128d x = _mm_loadu_pd(v + i);
+            s = _mm_add_pd(s, x);
+            q = _mm_add_pd(q, _mm_mul_pd(x, x));
+            mn = _mm_min_pd(mn, x);
+            mx = _mm_max_pd(mx, x);
+        }
+        double ls[2], lq[2], lmn[2], lmx[2];
+        _mm_storeu_pd(ls, s);
+        _mm_storeu_pd(lq, q);
+        _mm_storeu_pd(lmn, mn);
+        _mm_storeu_pd(lmx, mx);
+        sum = ls[0] + ls[1];
+        squares = lq[0] + lq[1];
+        lo = std::min(lmn[0], lmn[1]);
+        hi = std::max(lmx[0], lmx[1]);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        float64x2_t s = vdupq_n_f64(0), q = vdupq_n_f64(0), mn = vdupq_n_f64(lo), mx = mn;
+        for (; i + 2 <= n; i += 2)
+        {
+            float64x2_t x = vld1q_f64(v + i);
+            s = vaddq_f64(s, x);
+            q = vfmaq_f64(q, x, x);
+            mn = vminq_f64(mn, x);
+            mx = vmaxq_f64(mx, x);
+        }
+        sum = vaddvq_f64(s);
+        squares = vaddvq_f64(q);
+        lo = vminvq_f64(mn);
+        hi = vmaxvq_f64(mx);
+#else
+        sum = squares = 0;
+#endif
+        for (; i < n; ++i)
+        {
+            sum += v[i];
+            squares += v[i] * v[i];
+            lo = std::min(lo, v[i]);
+            hi = std::max(hi, v[i]);
+        }
+    }
+
+    // out[i] = (v[i] - mean) * scale
+    static void standardise(const double* v, size_t n, double mean, double scale, double* out)
+    {
+        size_t i = 0;
+#if defined(__SSE2__)
+        __m128d m = _mm_set1_pd(mean), k = _mm_set1_pd(scale);
+        for (; i + 2 <= n; i += 2)
+            _mm_storeu_pd(out + i, _mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(v + i), m), k));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        float64x2_t m = vdupq_n_f64(mean), k = vdupq_n_f64(scale);
+        for (; i + 2 <= n; i += 2)
+            vst1q_f64(out + i, vmulq_f64(vsubq_f64(vld1q_f64(v + i), m), k));
+#endif
+        for (; i < n; ++i)
+            out[i] = (v[i] - mean) * scale;
+    }
+
+    // p in [0, 1], nearest-rank on a scratch copy that nth_element reorders.
+    static double percentile(std::vector<double>& scratch, double p)
+    {
+        if (scratch.empty())
+            return 0;
+        size_t k = static_cast<size_t>(p * (scratch.size() - 1) + 0.5);
+        std::nth_element(scratch.begin(), scratch.begin() + k, scratch.end());
+        return scratch[k];
+    }
+
+    static Summary compute(const std::vector<double>& scores)
+    {
+        Summary s;
+        s.count = scores.size();
+        if (scores.empty())
+            return s;
+        double sum, squares;
+        sums(scores.data(), scores.size(), sum, squares, s.min, s.max);
+        s.mean = sum / s.count;
+        s.stddev = std::sqrt(std::max(0.0, squares / s.count - s.mean * s.mean));
+
+        std::vector<double> scratch(scores);
+        s.p10 = percentile(scratch, 0.10);
+        s.p25 = percentile(scratch, 0.25);
+        s.median = percentile(scratch, 0.50);
+        s.p75 = percentile(scratch, 0.75);
+        s.p90 = percentile(scratch, 0.90);
+
+        s.z.resize(s.count);
+        standardise(scores.data(), s.count, s.mean, s.stddev > 0 ? 1.0 / s.stddev : 0.0, s.z.data());
+        double iqr = s.p75 - s.p25, lowFence = s.p25 - 1.5 * iqr, highFence = s.p75 + 1.5 * iqr;
+        s.outlier.resize(s.count);
+        for (size_t i = 0; i < s.count; ++i)
+        {
+            s.outlier[i] = scores[i] < lowFence || scores[i] > highFence;
+            int bin = static_cast<int>(scores[i] / 10);
+            ++s.histogram[std::min(BINS - 1, std::max(0, bin))];
+        }
+        return s;
+    }
+};
+
+// Finds clash-free section combinations for a set of wanted courses. Every
+// timeslot involved gets a bit in a 64-bit set, along with a mask of the bits
+// it overlaps, so each branch is one AND. The search is depth-first,
+// most-constrained course first, and keeps the best `keep` schedules. Days on
+// campus never shrink as sections are added, so any branch already using more
+// days than the worst kept schedule is pruned.
+class ScheduleBuilder
+{
+public:
+    struct Option
+    {
+        int schedule_id;
+        int timeslot_id;
+        int seatsLeft;
+    };
+    struct Plan
+    {
+        std::vector<size_t> picks; // option index per group
+        int days = 0;
+        int gapMinutes = 0;
+        int minSeats = 0;
+    };
+
+private:
+    struct Slot
+    {
+        int day, start, end; // minutes since midnight
+    };
+    std::unordered_map<int, Slot> timeslots;
+    std::vector<int> bitSlot;                  // bit -> timeslot_id
+    std::unordered_map<int, int> slotBit;      // timeslot_id -> bit
+    std::vector<uint64_t> overlaps;            // bit -> bits it clashes with
+    uint64_t busy = 0;
+    std::vector<std::vector<Option>> groups;
+    std::vector<std::vector<int>> optionBit;
+
+    int bitFor(int timeslot_id)
+    {
+        auto it = slotBit.find(timeslot_id);
+        if (it != slotBit.end())
+            return it->second;
+        if (bitSlot.size() == 64)
+            throw std::runtime_error("more than 64 distinct timeslots in one schedule");
+        int bit = static_cast<int>(bitSlot.size());
+        slotBit[timeslot_id] = bit;
+        bitSlot.push_back(timeslot_id);
+        overlaps.push_back(uint64_t(1) << bit);
+        const Slot& mine = timeslots.at(timeslot_id);
+        for (int other = 0; other < bit; ++other)
+        {
+            const Slot& s = timeslots.at(bitSlot[other]);
+            if (s.day == mine.day && s.start < mine.end && mine.start < s.end)
+            {
+                overlaps[bit] |= uint64_t(1) << other;
+                overlaps[other] |= uint64_t(1) << bit;
+            }
+        }
+        return bit;
+    }
+
+    void score(Plan& plan, uint64_t used) const
+    {
+        std::vector<std::vector<std::pair<int, int>>> byDay(7);
+        for (uint64_t w = used; w; w &= w - 1)
+        {
+            const Slot& s = timeslots.at(bitSlot[__builtin_ctzll(w)]);
+            byDay[s.day].push_back({s.start, s.end});
+        }
+        plan.days = 0;
+        plan.gapMinutes = 0;
+        for (auto& day : byDay)
+        {
+            if (day.empty())
+                continue;
+            ++plan.days;
+            std::sort(day.begin(), day.end());
+            int end = day[0].second;
+            for (const auto& s : day)
+            {
+                plan.gapMinutes += std::max(0, s.first - end);
+                end = std::max(end, s.second);
+            }
+        }
+        plan.minSeats = INT_MAX;
+        for (size_t g = 0; g < groups.size(); ++g)
+            plan.minSeats = std::min(plan.minSeats, groups[g][plan.picks[g]].seatsLeft);
+    }
+    static bool better(const Plan& a, const Plan& b)
+    {
+        return std::make_tuple(a.days, a.gapMinutes, -a.minSeats) < std::make_tuple(b.days, b.gapMinutes, -b.minSeats);
+    }
+    int daysOf(uint64_t used) const
+    {
+        int mask = 0;
+        for (uint64_t w = used; w; w &= w - 1)
+            mask |= 1 << timeslots.at(bitSlot[__builtin_ctzll(w)]).day;
+        return __builtin_popcount(mask);
+    }
+
+public:
+    // day: 0 = Monday; times as "HH:MM[:SS]".
+    void addTimeslot(int timeslot_id, int day, const std::string& start, const std::string& end)
+    {
+        auto minutes = [](const std::string& t) { return std::atoi(t.c_str()) * 60 + (t.size() >= 5 ? std::atoi(t.c_str() + 3) : 0); };
+        timeslots[timeslot_id] = {day, minutes(start), minutes(end)};
+    }
+    // A timeslot the student is already committed to.
+    void addBusy(int timeslot_id) { busy |= uint64_t(1) << bitFor(timeslot_id); }
+    void addGroup(const std::vector<Option>& options)
+    {
+        groups.push_back(options);
+        optionBit.emplace_back();
+        for (const auto& o : options)
+            optionBit.back().push_back(bitFor(o.timeslot_id));
+    }
+
+    std::vector<Plan> build(size_t keep, uint64_t& complete)
+    {
+        complete = 0;
+        std::vector<Plan> best;
+        std::vector<size_t> order(groups.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return groups[a].size() < groups[b].size(); });
+        Plan current;
+        current.picks.assign(groups.size(), 0);
+
+        std::function<void(size_t, uint64_t, uint64_t)> search = [&](size_t depth, uint64_t used, uint64_t blocked) {
+            if (best.size() == keep && daysOf(used) > best.back().days)
+                return;
+            if (depth == order.size())
+            {
+                ++complete;
+                score(current, used);
+                if (best.size() < keep || better(current, best.back()))
+                {
+                    best.insert(std::upper_bound(best.begin(), best.end(), current, better), current);
+                    if (best.size() > keep)
+                        best.pop_back();
+                }
+                return;
+            }
+            size_t g = order[depth];
+            for (size_t o = 0; o < groups[g].size(); ++o)
+            {
+                int bit = optionBit[g][o];
+                if (blocked >> bit & 1)
+                    continue;
+                current.picks[g] = o;
+                search(depth + 1, used | uint64_t(1) << bit, blocked | overlaps[bit]);
+            }
+        };
+        uint64_t blocked = 0;
+        for (uint64_t w = busy; w; w &= w - 1)
+            blocked |= overlaps[__builtin_ctzll(w)];
+        search(0, busy, blocked);
+        return best;
+    }
+};
+
+// Results of one listing query per (semester, degree) cohort, shared by every
+// Database on the same schema in this process. Concurrent misses on a key
+// wait for the first caller's query rather than issuing their own. Writers
+// invalidate exactly the entries they affect and patch seat counts in place;
+// the TTL bounds how stale changes made by other processes can get.
+template <typename Row>
+class CohortCache
+{
+public:
+    typedef std::pair<int, std::string> Key;
+    struct Stats
+    {
+        uint64_t hits = 0, misses = 0, coalesced = 0, invalidations = 0;
+        size_t entries = 0;
+    };
+
+    explicit CohortCache(std::chrono::seconds ttl)
+        : ttl(ttl)
+    {}
+    // One cache per database name, alive while any Database uses it.
+    static std::shared_ptr<CohortCache> shared(const std::string& database, std::chrono::seconds ttl)
+    {
+        static std::mutex registryMutex;
+        static std::map<std::string, std::weak_ptr<CohortCache>> registry;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto cache = registry[database].lock();
+        if (!cache)
+        {
+            cache = std::make_shared<CohortCache>(ttl);
+            registry[database] = cache;
+        }
+        return cache;
+    }
+
+    std::vector<Row> get(const Key& key, const std::function<std::vector<Row>()>& load)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            auto it = entries.find(key);
+            if (it == entries.end())
+                break;
+            std::shared_ptr<Entry> e = it->second;
+            if (!e->ready)
+            {
+                ++stats.coalesced;
+                loaded.wait(lock, [&] { return e->ready || e->failed; });
+                if (e->ready && !e->stale)
+                    return e->rows;
+                continue; // failed or invalidated meanwhile; look again
+            }
+            if (std::chrono::steady_clock::now() - e->filledAt < ttl)
+            {
+                ++stats.hits;
+                return e->rows;
+            }
+            entries.erase(it);
+            break;
+        }
+        ++stats.misses;
+        auto e = std::make_shared<Entry>();
+        entries[key] = e;
+        lock.unlock();
+        std::vector<Row> rows;
+        try {
+            rows = load();
+        }
+        catch (...) {
+            lock.lock();
+            e->failed = true;
+            drop(key, e);
+            loaded.notify_all();
+            throw;
+        }
+        lock.lock();
+        e->rows = rows;
+        e->filledAt = std::chrono::steady_clock::now();
+        e->ready = true;
+        if (e->stale)
+            drop(key, e);
+        loaded.notify_all();
+        return rows;
+    }
+
+    void invalidate(const Key& key)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if (it != entries.end())
+            invalidate(it);
+    }
+    // Drops every entry holding a row that matches.
+    void invalidateIf(const std::function<bool(const Row&)>& match)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            auto next = std::next(it);
+            const auto& rows = it->second->rows;
+            if (!it->second->ready || std::any_of(rows.begin(), rows.end(), match))
+                invalidate(it);
+            it = next;
+        }
+    }
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (!entries.empty())
+            invalidate(entries.begin());
+    }
+    void adjustSeats(int schedule_id, int delta)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& kv : entries)
+        {
+            if (!kv.second->ready)
+            {
+                kv.second->stale = true; // the load may have read the old count
+                continue;
+            }
+            for (auto& row : kv.second->rows)
+                if (row.schedule_id == schedule_id)
+                    row.seats_taken = std::max(0, row.seats_taken + delta);
+        }
+    }
+    Stats getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Stats s = stats;
+        s.entries = entries.size();
+        return s;
+    }
+
+private:
+    struct Entry
+    {
+        std::vector<Row> rows;
+        std::chrono::steady_clock::time_point filledAt;
+        bool ready = false, failed = false, stale = false;
+    };
+    typedef std::map<Key, std::shared_ptr<Entry>> Entries;
+
+    std::chrono::seconds ttl;
+    mutable std::mutex mutex;
+    std::condition_variable loaded;
+    Entries entries;
+    Stats stats;
+
+    // A load still in flight is marked stale so that callers waiting on it
+    // query again; the loader itself returns what it read.
+    void invalidate(typename Entries::iterator it)
+    {
+        it->second->stale = true;
+        ++stats.invalidations;
+        entries.erase(it);
+    }
+    void drop(const Key& key, const std::shared_ptr<Entry>& e)
+    {
+        auto it = entries.find(key);
+        if (it != entries.end() && it->second == e)
+            entries.erase(it);
+    }
+};
+
+// Result rows decoded by declaration rather than by position. A RowMap names
+// the member that receives each SELECT column, in column order, e.g.
+//     rowMap(&Mark::assignment_name, &Mark::total_marks, &Mark::obtained_marks)
+// and is called on a row to build the struct. The decoder for each column is
+// chosen from the member's type at compile time (a type without a
+// ColumnReader does not compile). Values are read in place from the row, and
+// fetchAll() checks the column count once per result, not per row.
+template <typename F>
+struct ColumnReader;
+template <>
+struct ColumnReader<int>
+{
+    static void read(mysqlx::Value& v, int& out) { out = v.get<int>(); }
+};
+template <>
+struct ColumnReader<double>
+{
+    static void read(mysqlx::Value& v, double& out) { out = v.get<double>(); }
+};
+template <>
+struct ColumnReader<std::string>
+{
+    static void read(mysqlx::Value& v, std::string& out) { out = v.get<std::string>(); }
+};
+
+template <typename Struct, typename... Fields>
+class RowMap
+{
+public:
+    static constexpr size_t COLUMNS = sizeof...(Fields);
+
+    constexpr explicit RowMap(Fields Struct::*... members) : members(members...) {}
+    Struct operator()(mysqlx::Row& row) const
+    {
+        Struct out{};
+        decode(row, out, std::index_sequence_for<Fields...>());
+        return out;
+    }
+
+private:
+    std::tuple<Fields Struct::*...> members;
+
+    template <size_t... I>
+    void decode(mysqlx::Row& row, Struct& out, std::index_sequence<I...>) const
+    {
+        (ColumnReader<Fields>::read(row[static_cast<unsigned>(I)], out.*std::get<I>(members)), ...);
+    }
+};
+template <typename Struct, typename... Fields>
+constexpr RowMap<Struct, Fields...> rowMap(Fields Struct::*... members)
+{
+    return RowMap<Struct, Fields...>(members...);
+}
+// Two-column results returned as pairs, e.g. (course code, course name).
+template <typename A, typename B>
+constexpr RowMap<std::pair<A, B>, A, B> pairColumns()
+{
+    return RowMap<std::pair<A, B>, A, B>(&std::pair<A, B>::first, &std::pair<A, B>::second);
+}
+// One-column results returned as plain values.
+template <typename T>
+struct SingleColumn
+{
+    static constexpr size_t COLUMNS = 1;
+    T operator()(mysqlx::Row& row) const
+    {
+        T out{};
+        ColumnReader<T>::read(row[0], out);
+        return out;
+    }
+};
+// Guards against a map drifting out of step with its SELECT list.
+inline void checkColumnCount(const mysqlx::SqlResult& res, size_t expected)
+{
+    if (res.getColumnCount() != expected)
+        throw std::logic_error("Row map expects " + std::to_string(expected) + " columns, query returns " +
+                               std::to_string(res.getColumnCount()));
+}
+template <typename Map>
+auto fetchAll(mysqlx::SqlResult res, const Map& map) -> std::vector<decltype(map(std::declval<mysqlx::Row&>()))>
+{
+    TRACE_SPAN("db", "fetch");
+    checkColumnCount(res, Map::COLUMNS);
+    std::vector<decltype(map(std::declval<mysqlx::Row&>()))> rows;
+    mysqlx::Row row;
+    while ((row = res.fetchOne()))
+        rows.push_back(map(row));
+    return rows;
+}
+
+// Splits a migration script into statements on ';', ignoring semicolons inside
+// quotes and dropping "--" comment lines.
+inline std::vector<std::string> splitSqlStatements(const std::string& script)
+{
+    std::vector<std::string> statements;
+    std::string current;
+    char quote = 0;
+    std::istringstream lines(script);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        size_t first = line.find_first_not_of(" \t\r");
+        if (!quote && (first == std::string::npos || line.compare(first, 2, "--") == 0))
+            continue;
+        for (char ch : line)
+        {
+            if (quote)
+            {
+                if (ch == quote)
+                    quote = 0;
+            }
+            else if (ch == '\'' || ch == '"' || ch == '`')
+            {
+                quote = ch;
+            }
+            else if (ch == ';')
+            {
+                if (current.find_first_not_of(" \t\r\n") != std::string::npos)
+                    statements.push_back(current);
+                current.clear();
+                continue;
+            }
+            current += ch;
+        }
+        current += '\n';
+    }
+    if (current.find_first_not_of(" \t\r\n") != std::string::npos)
+        statements.push_back(current);
+    return statements;
+}
+
+inline std::string fnv1aHex(const std::string& text)
+{
+    uint64_t h = 1469598103934665603ull;
+    for (unsigned char ch : text)
+    {
+        h ^= ch;
+        h *= 1099511628211ull;
+    }
+    std::ostringstream out;
+    out << std::hex << std::setw(16) << std::setfill('0') << h;
+    return out.str();
+}
+
+// One "host[:port]" per line; blank lines and '#' comments are skipped. A
+// missing file means no replicas.
+inline std::vector<std::string> readEndpoints(const std::string& path)
+{
+    std::vector<std::string> endpoints;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        line = line.substr(0, line.find('#'));
+        line.erase(std::remove_if(line.begin(), line.end(), [](unsigned char c) { return std::isspace(c); }), line.end());
+        if (!line.empty())
+            endpoints.push_back(line);
+    }
+    return endpoints;
+}
+
+class Database {
+    mysqlx::Session session;
+    mysqlx::Schema db;
+    std::string connHost, connUser, connPass, connDb; // for sessions of our own, e.g. the seat writer
+    // SQL on the hot paths. checkQueryPlans() EXPLAINs these same strings, so the
+    // plan check always sees the text that actually runs.
+    static constexpr const char* SQL_AVAILABLE_SCHEDULED_COURSES =
+        "SELECT cs.schedule_id, cs.course_code, c.course_name, CONCAT(f.first_name, ' ', f.last_name), "
+        "t.day_of_week, CAST(t.start_time AS CHAR), CAST(t.end_time AS CHAR), "
+        "cl.room_number, cl.building, cs.timeslot_id, cs.seats_taken, c.max_students "
+        "FROM course_schedule cs "
+        "JOIN courses c ON cs.course_code = c.course_code "
+        "JOIN faculty f ON cs.faculty_id = f.faculty_id "
+        "JOIN timeslots t ON cs.timeslot_id = t.timeslot_id "
+        "JOIN classrooms cl ON cs.room_id = cl.room_id "
+        "WHERE c.semester = ? AND c.department = ?";
+    static constexpr const char* SQL_HAS_CLASH =
+        "SELECT COUNT(*) FROM enrollments e "
+        "JOIN course_schedule cs ON e.schedule_id = cs.schedule_id "
+        "WHERE e.student_id = ? AND cs.timeslot_id = ?";
+    static constexpr const char* SQL_COMPLETED_COURSES = "SELECT course_code FROM completed_courses WHERE student_id = ?";
+    // Prerequisites a student's standing implies: those of the degree's courses up
+    // to their semester, unless the catalogue places the prerequisite itself in
+    // their semester or later. Covers students with no recorded completions.
+    static constexpr const char* SQL_STANDING_PREREQUISITES =
+        "SELECT DISTINCT UPPER(p.code) FROM students s "
+        "JOIN courses c ON c.department = s.degree AND c.semester <= s.semester "
+        "JOIN JSON_TABLE(CONCAT('[\"', REPLACE(REPLACE(REPLACE(REPLACE(TRIM(COALESCE(c.prerequisites, '')), "
+        "';', ','), '/', ','), ' ', ','), ',', '\",\"'), '\"]'), '$[*]' COLUMNS (code VARCHAR(20) PATH '$')) p "
+        "WHERE s.student_id = ? AND p.code <> '' "
+        "AND NOT EXISTS (SELECT 1 FROM courses later WHERE later.course_code = p.code AND later.semester >= s.semester)";
+    static constexpr const char* SQL_TAKE_SEAT =
+        "UPDATE course_schedule cs JOIN courses c ON cs.course_code = c.course_code "
+        "SET cs.seats_taken = cs.seats_taken + 1 "
+        "WHERE cs.schedule_id = ? AND cs.seats_taken < c.max_students";
+    static constexpr const char* SQL_ENROLLED_COURSES =
+        "SELECT cs.schedule_id, c.course_code, c.course_name, c.department, c.semester, "
+        "f.faculty_id, CONCAT(f.first_name,' ',f.last_name) AS faculty_name, "
+        "t.timeslot_id, t.day_of_week, CAST(t.start_time AS CHAR), CAST(t.end_time AS CHAR), "
+        "cl.room_id, cl.room_number, cl.building "
+        "FROM enrollments e "
+        "JOIN course_schedule cs ON e.schedule_id = cs.schedule_id "
+        "JOIN courses c ON cs.course_code = c.course_code "
+        "JOIN faculty f ON cs.faculty_id = f.faculty_id "
+        "JOIN timeslots t ON cs.timeslot_id = t.timeslot_id "
+        "JOIN classrooms cl ON cs.room_id = cl.room_id "
+        "WHERE e.student_id = ?";
+    static constexpr const char* SQL_FACULTY_COURSES =
+        "SELECT DISTINCT CONCAT(cs.course_code, ' - ', c.course_name) FROM course_schedule cs "
+        "JOIN courses c ON cs.course_code = c.course_code "
+        "WHERE cs.faculty_id = ?";
+    static constexpr const char* SQL_ENROLLED_STUDENTS =
+        "SELECT DISTINCT s.student_id, s.first_name, s.last_name, s.email, s.semester, s.degree "
+        "FROM enrollments e "
+        "JOIN students s ON e.student_id = s.student_id "
+        "JOIN course_schedule cs ON e.schedule_id = cs.schedule_id "
+        "WHERE cs.course_code = ?";
+    static constexpr const char* SQL_FACULTY_TIMETABLE =
+        "SELECT cs.schedule_id, cs.course_code, c.course_name, c.department, c.semester, "
+        "cs.faculty_id, CONCAT(f.first_name, ' ', f.last_name) AS faculty_name, cs.timeslot_id, "
+        "t.day_of_week, CAST(t.start_time AS CHAR), CAST(t.end_time AS CHAR), "
+        "cs.room_id, cl.room_number, cl.building "
+        "FROM course_schedule cs "
+        "JOIN courses c ON cs.course_code = c.course_code "
+        "JOIN faculty f ON cs.faculty_id = f.faculty_id "
+        "JOIN timeslots t ON cs.timeslot_id = t.timeslot_id "
+        "JOIN classrooms cl ON cs.room_id = cl.room_id "
+        "WHERE cs.faculty_id = ?";
+    static constexpr const char* SQL_COURSE_ASSIGNMENTS = "SELECT DISTINCT assignment_name FROM marks WHERE course_code = ?";
+    static constexpr const char* SQL_ASSIGNMENT_MARKS = "SELECT student_id, total_marks, obtained_marks FROM marks WHERE course_code = ? AND assignment_name = ?";
+    static constexpr const char* SQL_COURSE_SCORES =
+        "SELECT student_id, CAST(SUM(obtained_marks) * 100 / SUM(total_marks) AS DOUBLE) FROM marks "
+        "WHERE course_code = ? GROUP BY student_id HAVING SUM(total_marks) > 0";
+    static constexpr const char* SQL_DEPARTMENT_SCORES =
+        "SELECT m.course_code, CAST(SUM(m.obtained_marks) * 100 / SUM(m.total_marks) AS DOUBLE) FROM marks m "
+        "JOIN courses c ON m.course_code = c.course_code "
+        "WHERE c.department = ? GROUP BY m.course_code, m.student_id HAVING SUM(m.total_marks) > 0 ORDER BY m.course_code";
+    static constexpr const char* SQL_COURSE_SEATS_TAKEN = "SELECT CAST(COALESCE(SUM(seats_taken), 0) AS SIGNED) FROM course_schedule WHERE course_code = ?";
+    static constexpr const char* SQL_UNSCHEDULED_COURSES = "SELECT course_code, course_name FROM courses WHERE course_code NOT IN (SELECT course_code FROM course_schedule)";
+    static constexpr const char* SQL_AVAILABLE_ROOMS =
+        "SELECT room_id, CONCAT(room_number, ' ', building) FROM classrooms "
+        "WHERE room_id NOT IN (SELECT room_id FROM course_schedule WHERE timeslot_id = ?)";
+    static constexpr const char* SQL_AVAILABLE_FACULTY =
+        "SELECT faculty_id, CONCAT(first_name, ' ', last_name) FROM faculty "
+        "WHERE faculty_id NOT IN (SELECT faculty_id FROM course_schedule WHERE timeslot_id = ?)";
+    static constexpr const char* SQL_STUDENT_MARKS =
+        "SELECT m.assignment_name, m.total_marks, m.obtained_marks, c.course_name "
+        "FROM marks m "
+        "JOIN courses c ON m.course_code = c.course_code "
+        "WHERE m.student_id = ?";
+    static constexpr const char* SQL_STUDENT_COURSES =
+        "SELECT DISTINCT CONCAT(c.course_code, ' - ', c.course_name) "
+        "FROM enrollments e "
+        "JOIN course_schedule cs ON e.schedule_id = cs.schedule_id "
+        "JOIN courses c ON cs.course_code = c.course_code "
+        "WHERE e.student_id = ?";
+    static constexpr const char* SQL_STUDENT_MARK_ROWS =
+        "SELECT course_code, assignment_name, total_marks, obtained_marks FROM marks WHERE student_id = ? "
+        "UNION ALL "
+        "SELECT course_code, assignment_name, total_marks, obtained_marks FROM marks_history WHERE student_id = ?";
+
+    PrerequisiteEngine prerequisites;
+    bool prerequisitesLoaded = false;
+    static constexpr int COMPLETED_RECHECK_MS = 5000;
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> completedLoadedAt;
+    GradingEngine grading;
+    std::string archiveDir = "Archive";
+    std::string auditPath = "audit.journal";
+    std::shared_ptr<AuditJournal> audit = AuditJournal::open(auditPath);
+    std::string actor = "system";
+    std::vector<std::unique_ptr<TermArchive>> archives;
+    bool archivesLoaded = false;
+    PeopleIndex people;
+    bool peopleLoaded = false;
+
+    // Read replicas. Read-only screens go to the least-lagged replica that is
+    // within MAX_REPLICA_LAG and has applied this process's last write (its
+    // GTID set, or STICKY_MS after the write if GTIDs are off); otherwise to
+    // the primary. Mutations always use the primary session.
+    struct Replica
+    {
+        std::string name;
+        std::unique_ptr<mysqlx::Session> session;
+        double lag = -1; // seconds behind the primary; -1 if unusable
+        std::chrono::steady_clock::time_point checkedAt;
+        bool caughtUp = true;
+        uint64_t reads = 0;
+    };
+    static constexpr double MAX_REPLICA_LAG = 2.0;
+    static constexpr int LAG_CHECK_MS = 1000;
+    static constexpr int STICKY_MS = 5000;
+    std::vector<Replica> replicas;
+    std::string lastWriteGtids;
+    std::chrono::steady_clock::time_point stickyUntil;
+    uint64_t primaryReads = 0;
+
+    void recordWrite(AuditOp op, const std::string& subject, const std::string& object = "", const std::string& detail = "")
+    {
+        audit->record(op, actor, subject, object, detail);
+        if (replicas.empty())
+            return;
+        stickyUntil = std::chrono::steady_clock::now() + std::chrono::milliseconds(STICKY_MS);
+        try {
+            auto row = session.sql("SELECT @@GLOBAL.gtid_executed").execute().fetchOne();
+            lastWriteGtids = row && !row[0].isNull() ? row[0].get<std::string>() : "";
+        }
+        catch (const mysqlx::Error&) {
+            lastWriteGtids.clear();
+        }
+        for (auto& r : replicas)
+            r.caughtUp = false;
+    }
+    double replicaLag(Replica& r)
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (now - r.checkedAt < std::chrono::milliseconds(LAG_CHECK_MS))
+            return r.lag;
+        r.checkedAt = now;
+        r.lag = -1;
+        try {
+            auto res = r.session->sql("SHOW REPLICA STATUS").execute();
+            const auto& cols = res.getColumns();
+            int lagCol = -1;
+            for (unsigned i = 0; i < res.getColumnCount(); ++i)
+                if (std::string(cols[i].getColumnLabel()) == "Seconds_Behind_Source")
+                    lagCol = i;
+            auto row = res.fetchOne();
+            if (row && lagCol >= 0 && !row[lagCol].isNull())
+                r.lag = row[lagCol].get<int>();
+        }
+        catch (const mysqlx::Error& err) {
+            std::cerr << "Replica " << r.name << " unavailable: " << err.what() << std::endl;
+        }
+        return r.lag;
+    }
+    bool replicaCaughtUp(Replica& r)
+    {
+        if (r.caughtUp)
+            return true;
+        if (lastWriteGtids.empty())
+            r.caughtUp = std::chrono::steady_clock::now() >= stickyUntil;
+        else
+        {
+            try {
+                auto row = r.session->sql("SELECT GTID_SUBSET(?, @@GLOBAL.gtid_executed)").bind(lastWriteGtids).execute().fetchOne();
+                r.caughtUp = row && row[0].get<int>() == 1;
+            }
+            catch (const mysqlx::Error&) {
+                r.caughtUp = false;
+            }
+        }
+        return r.caughtUp;
+    }
+    // Session for a read that may be served slightly stale.
+    mysqlx::Session& reader()
+    {
+        Replica* best = nullptr;
+        for (auto& r : replicas)
+        {
+            double lag = replicaLag(r);
+            if (lag < 0 || lag > MAX_REPLICA_LAG || !replicaCaughtUp(r))
+                continue;
+            if (!best || lag < best->lag)
+                best = &r;
+        }
+        if (!best)
+        {
+            ++primaryReads;
+            return session;
+        }
+        ++best->reads;
+        return *best->session;
+    }
+
+    // Transaction executor for every mutation. Deadlocks and lock wait
+    // timeouts roll back and rerun the body after a jittered backoff: the
+    // n-th retry waits between half and all of TX_BACKOFF_MS * 2^(n-1), capped
+    // at TX_BACKOFF_CAP_MS, so the first waits 5-10 ms. A
+    // non-empty requestKey is claimed in idempotency_keys inside the same
+    // transaction; if it is already there the body is skipped.
+    enum class TxOutcome { Committed, Aborted, Replayed };
+    static constexpr int TX_MAX_ATTEMPTS = 6;
+    static constexpr int TX_BACKOFF_MS = 10;
+    static constexpr int TX_BACKOFF_CAP_MS = 500;
+    std::mt19937 backoffRng{std::random_device{}()};
+    struct TransactionStats
+    {
+        uint64_t committed = 0, aborted = 0, replayed = 0, failed = 0;
+        uint64_t retries = 0, deadlocks = 0, lockTimeouts = 0;
+    } txStats;
+
+    static bool errorContains(const mysqlx::Error& err, const char* text)
+    {
+        return std::string(err.what()).find(text) != std::string::npos;
+    }
+    // `body` runs against the primary session and returns false to roll back.
+    // It may run more than once, so it must only touch the database and state
+    // it resets itself; caches and the audit log are updated by the caller.
+    TxOutcome transact(const std::function<bool()>& body, const std::string& requestKey = "")
+    {
+        TRACE_SPAN("db", "transaction");
+        for (int attempt = 1;; ++attempt)
+        {
+            session.startTransaction();
+            try {
+                if (!requestKey.empty())
+                {
+                    try {
+                        session.sql("INSERT INTO idempotency_keys (request_key) VALUES (?)").bind(requestKey).execute();
+                    }
+                    catch (const mysqlx::Error& err) {
+                        if (!errorContains(err, "Duplicate entry"))
+                            throw;
+                        session.rollback();
+                        ++txStats.replayed;
+                        return TxOutcome::Replayed;
+                    }
+                }
+                if (!body())
+                {
+                    session.rollback();
+                    ++txStats.aborted;
+                    return TxOutcome::Aborted;
+                }
+                session.commit();
+                ++txStats.committed;
+                return TxOutcome::Committed;
+            }
+            catch (const mysqlx::Error& err) {
+                try { session.rollback(); } catch (...) {}
+                bool deadlock = errorContains(err, "Deadlock found");
+                bool lockWait = errorContains(err, "Lock wait timeout");
+                if ((!deadlock && !lockWait) || attempt == TX_MAX_ATTEMPTS)
+                {
+                    ++txStats.failed;
+                    throw;
+                }
+                ++(deadlock ? txStats.deadlocks : txStats.lockTimeouts);
+                ++txStats.retries;
+                int cap = std::min(TX_BACKOFF_CAP_MS, TX_BACKOFF_MS << (attempt - 1));
+                std::this_thread::sleep_for(std::chrono::milliseconds(
+                    std::uniform_int_distribution<int>(cap / 2, cap)(backoffRng)));
+            }
+            catch (...) {
+                try { session.rollback(); } catch (...) {}
+                ++txStats.failed;
+                throw;
+            }
+        }
+    }
+
+    mysqlx::SqlResult runBound(mysqlx::Session& on, const std::string& sql, const std::vector<mysqlx::Value>& params)
+    {
+        mysqlx::SqlStatement stmt = on.sql(sql);
+        for (const auto& v : params)
+            stmt.bind(v);
+        return stmt.execute();
+    }
+    // Appends "AND column = ?" for each filter that is set.
+    static void addFilter(std::string& sql, std::vector<mysqlx::Value>& params, const char* column, const std::string& value)
+    {
+        if (value.empty())
+            return;
+        sql += std::string(" AND ") + column + " = ?";
+        params.emplace_back(value);
+    }
+    // Fetches pageSize + 1 rows so the extra one tells whether another page follows.
+    template <typename T, typename Map>
+    void fillPage(mysqlx::SqlResult res, size_t pageSize, std::vector<T>& rows, bool& more, const Map& map)
+    {
+        TRACE_SPAN("db", "fetch");
+        checkColumnCount(res, Map::COLUMNS);
+        mysqlx::Row row;
+        more = false;
+        while ((row = res.fetchOne()))
+        {
+            if (rows.size() == pageSize)
+            {
+                more = true;
+                break;
+            }
+            rows.push_back(map(row));
+        }
+    }
+
+    void ensurePeopleIndex()
+    {
+        if (peopleLoaded)
+            return;
+        people.clear();
+        auto res = session.sql("SELECT student_id, first_name, last_name, email FROM students").execute();
+        mysqlx::Row row;
+        while ((row = res.fetchOne()))
+            people.add(PeopleIndex::StudentEntry, row[0].get<std::string>(), 0, row[1].get<std::string>(), row[2].get<std::string>(), row[3].get<std::string>());
+        res = session.sql("SELECT faculty_id, first_name, last_name, email FROM faculty").execute();
+        while ((row = res.fetchOne()))
+            people.add(PeopleIndex::FacultyEntry, row[3].get<std::string>(), row[0].get<int>(), row[1].get<std::string>(), row[2].get<std::string>(), row[3].get<std::string>());
+        peopleLoaded = true;
+    }
+
+    void ensureArchives()
+    {
+        if (archivesLoaded)
+            return;
+        archivesLoaded = true;
+        if (!std::filesystem::is_directory(archiveDir))
+            return;
+        for (const auto& entry : std::filesystem::directory_iterator(archiveDir))
+        {
+            if (entry.path().extension() != ".scar")
+                continue;
+            try {
+                archives.emplace_back(new TermArchive(entry.path().string()));
+            }
+            catch (const std::exception& ex) {
+                std::cerr << "Skipping archive " << entry.path() << ": " << ex.what() << std::endl;
+            }
+        }
+    }
+
+    void ensureGradingCatalogue()
+    {
+        if (grading.hasCatalogue())
+            return;
+        auto res = session.sql("SELECT course_code, course_name, credits, semester FROM courses").execute();
+        mysqlx::Row row;
+        while ((row = res.fetchOne()))
+            grading.setCourse(row[0].get<std::string>(), {row[1].get<std::string>(), row[2].get<int>(), row[3].get<int>()});
+    }
+
+    void ensurePrerequisites()
+    {
+        if (prerequisitesLoaded)
+            return;
+        auto courses = fetchAll(session.sql("SELECT course_code, COALESCE(prerequisites, '') FROM courses").execute(),
+                                pairColumns<std::string, std::string>());
+        for (const auto& cycle : prerequisites.rebuild(courses))
+            std::cerr << "Ignoring cyclic prerequisite: " << cycle << std::endl;
+        prerequisitesLoaded = true;
+    }
+
+public:
+    // host may be "host[:port]"; the X Protocol port defaults to 33060.
+    static std::string endpointHost(const std::string& endpoint)
+    {
+        return endpoint.substr(0, endpoint.find(':'));
+    }
+    static int endpointPort(const std::string& endpoint)
+    {
+        size_t colon = endpoint.find(':');
+        return colon == std::string::npos ? 33060 : std::stoi(endpoint.substr(colon + 1));
+    }
+    Database(const std::string& host, const std::string& user, const std::string& pass, const std::string& dbname)
+        try : session(mysqlx::SessionOption::HOST, endpointHost(host),
+                     mysqlx::SessionOption::PORT, endpointPort(host),
+                     mysqlx::SessionOption::USER, user,
+                     mysqlx::SessionOption::PWD, pass,
+                     mysqlx::SessionOption::DB, dbname),
+              db(session.getSchema(dbname))
+    {
+        try {
+            db = session.getSchema(dbname);
+            if (!db.existsInDatabase()) {
+                throw std::runtime_error("Database " + dbname + " does not exist");
+            }
+        }
+        catch (const mysqlx::Error& err) {
+            throw std::runtime_error("Failed to get schema: " + std::string(err.what()));
+        }
+        cohortCache = CohortCache<ScheduledCourse>::shared(host + "/" + dbname, std::chrono::seconds(COHORT_CACHE_TTL));
+        connHost = host;
+        connUser = user;
+        connPass = pass;
+        connDb = dbname;
+    }
+    catch (const mysqlx::Error& err) {
+        throw std::runtime_error("Connection failed: " + std::string(err.what()));
+    }
+
+    // Replica endpoints take the same form and the primary's credentials. An
+    // unreachable replica is skipped with a warning.
+    Database(const std::string& host, const std::string& user, const std::string& pass, const std::string& dbname,
+             const std::vector<std::string>& replicaEndpoints)
+        : Database(host, user, pass, dbname)
+    {
+        for (const auto& endpoint : replicaEndpoints)
+        {
+            try {
+                Replica r;
+                r.name = endpoint;
+                r.session.reset(new mysqlx::Session(mysqlx::SessionOption::HOST, endpointHost(endpoint),
+                                                    mysqlx::SessionOption::PORT, endpointPort(endpoint),
+                                                    mysqlx::SessionOption::USER, user,
+                                                    mysqlx::SessionOption::PWD, pass,
+                                                    mysqlx::SessionOption::DB, dbname));
+                replicas.push_back(std::move(r));
+            }
+            catch (const mysqlx::Error& err) {
+                std::cerr << "Skipping replica " << endpoint << ": " << err.what() << std::endl;
+            }
+        }
+    }
+
+    ~Database() {
+        try {
+            for (auto& r : replicas)
+                r.session->close();
+            session.close();
+        } catch (...) {}
+    }
+
+    const auto& getTransactionStats() const
+    {
+        return txStats;
+    }
+    // Random key for a request that a caller may resubmit, e.g. after a lost
+    // connection; pass the same key on every attempt.
+    static std::string newRequestKey()
+    {
+        static thread_local std::mt19937_64 rng{std::random_device{}()};
+        std::ostringstream out;
+        out << std::hex << std::setfill('0') << std::setw(16) << rng() << std::setw(16) << rng();
+        return out.str();
+    }
+
+    struct ReplicaStatus
+    {
+        std::string name;
+        double lag;
+        bool caughtUp;
+        uint64_t reads;
+    };
+    std::vector<ReplicaStatus> getReplicaStatus(uint64_t& readsOnPrimary)
+    {
+        std::vector<ReplicaStatus> result;
+        for (auto& r : replicas)
+            result.push_back({r.name, replicaLag(r), replicaCaughtUp(r), r.reads});
+        readsOnPrimary = primaryReads;
+        return result;
+    }
+
+    // Who subsequent mutations are attributed to in the audit journal.
+    void setActor(const std::string& who) { actor = who; }
+    // Term archives are per database, so shards sharing a directory each need their own.
+    void setArchiveDir(const std::string& dir)
+    {
+        archiveDir = dir;
+        archives.clear();
+        archivesLoaded = false;
+    }
+    std::vector<AuditEvent> getAuditTrail(const std::string& subject)
+    {
+        audit->sync();
+        std::vector<AuditEvent> events;
+        AuditJournal::replay(auditPath, [&](const AuditEvent& e) {
+            if (subject.empty() || e.subject == subject || e.object.find(subject) != std::string::npos)
+                events.push_back(e);
+        });
+        return events;
+    }
+
+    bool studentExists(const std::string& studentId)
+    {
+        TRACE_FUNCTION("db");
+        auto students = db.getTable("students");
+        auto res = students.select("COUNT(*)").where("student_id = :sid").bind("sid", studentId).execute();
+        auto row = res.fetchOne();
+        return row && row[0].get<int>() > 0;
+    }
+    bool courseExists(const std::string& code)
+    {
+        TRACE_FUNCTION("db");
+        auto courses = db.getTable("courses");
+        auto res = courses.select("COUNT(*)").where("course_code = :ccode").bind("ccode", code).execute();
+        auto row = res.fetchOne();
+        return row && row[0].get<int>() > 0;
+    }
+    struct TableCounts
+    {
+        int students, faculty, courses, sections, enrollments;
+    };
+    TableCounts getTableCounts()
+    {
+        TRACE_FUNCTION("db");
+        auto row = reader().sql("SELECT (SELECT COUNT(*) FROM students), (SELECT COUNT(*) FROM faculty), (SELECT COUNT(*) FROM courses), "
+                                "(SELECT COUNT(*) FROM course_schedule), (SELECT COUNT(*) FROM enrollments)").execute().fetchOne();
+        return {row[0].get<int>(), row[1].get<int>(), row[2].get<int>(), row[3].get<int>(), row[4].get<int>()};
+    }
+    bool validateStudentPassword(const std::string& studentId, const std::string& password)
+    {
+        TRACE_FUNCTION("db");
+        auto students = db.getTable("students");
+        auto res = students.select("password").where("student_id = :sid").bind("sid", studentId).execute();
+        auto row = res.fetchOne();
+        return row && row[0].get<std::string>() == password;
+    }
+    bool changeStudentPassword(const std::string& studentId, const std::string& newPassword)
+    {
+        TRACE_FUNCTION("db");
+        uint64_t changed = 0;
+        transact([&] {
+            auto students = db.getTable("students");
+            changed = students.update().set("password", newPassword).where("student_id = :sid").bind("sid", studentId)
+                          .execute().getAffectedItemsCount();
+            return true;
+        });
+        if (changed == 0)
+            return false;
+        recordWrite(AuditOp::StudentPassword, studentId);
+        return true;
+    }
+    bool resetStudentPassword(const std::string& studentId)
+    {
+        return changeStudentPassword(studentId, "bnu");
+    }
+    int getStudentSemester(const std::string& studentId)
+    {
+        TRACE_FUNCTION("db");
+        auto students = db.getTable("students");
+        auto res = students.select("semester").where("student_id = :sid").bind("sid", studentId).execute();
+        auto row = res.fetchOne();
+        return row ? row[0].get<int>() : -1;
+    }
+    std::string getStudentDegree(const std::string& studentId)
+    {
+        TRACE_FUNCTION("db");
+        auto students = db.getTable("students");
+        auto res = students.select("degree").where("student_id = :sid").bind("sid", studentId).execute();
+        auto row = res.fetchOne();
+        return row ? std::string(row[0].get<std::string>()) : "";
+    }
+
+    // Faculty related methods
+    bool facultyExists(const std::string& email)
+    {
+        TRACE_FUNCTION("db");
+        auto faculty = db.getTable("faculty");
+        auto res = faculty.select("COUNT(*)").where("email = :email").bind("email", email).execute();
+        auto row = res.fetchOne();
+        return row && row[0].get<int>() > 0;
+    }
+
+    bool validateFacultyPassword(const std::string& email, const std::string& password)
+    {
+        TRACE_FUNCTION("db");
+        auto faculty = db.getTable("faculty");
+        auto res = faculty.select("password").where("email = :email").bind("email", email).execute();
+        auto row = res.fetchOne();
+        return row && row[0].get<std::string>() == password;
+    }
+
+    std::string getFacultyId(const std::string& email)
+    {
+        TRACE_FUNCTION("db");
+        auto faculty = db.getTable("faculty");
+        auto res = faculty.select("faculty_id").where("email = :email").bind("email", email).execute();
+        auto row = res.fetchOne();
+        return row ? std::to_string(row[0].get<int>()) : "";
+    }
+
+    std::string getFacultyName(const std::string& email)
+    {
+        TRACE_FUNCTION("db");
+        auto faculty = db.getTable("faculty");
+        auto res = faculty.select("first_name", "last_name").where("email = :email").bind("email", email).execute();
+        auto row = res.fetchOne();
+        return row ? (row[0].get<std::string>() + " " + row[1].get<std::string>()) : "";
+    }
+
+    bool changeFacultyPassword(const std::string& email, const std::string& newPassword)
+    {
+        TRACE_FUNCTION("db");
+        uint64_t changed = 0;
+        transact([&] {
+            auto faculty = db.getTable("faculty");
+            changed = faculty.update().set("password", newPassword).where("email = :email").bind("email", email)
+                          .execute().getAffectedItemsCount();
+            return true;
+        });
+        if (changed == 0)
+            return false;
+        recordWrite(AuditOp::FacultyPassword, email);
+        return true;
+    }
+
+    bool resetFacultyPassword(const std::string& email)
+    {
+        return changeFacultyPassword(email, "faculty_scit");
+    }
+
+    struct ScheduledCourse
+    {
+        int schedule_id;
+        std::string course_code, course_name, department;
+        int semester, faculty_id, timeslot_id;
+        std::string faculty_name, day, start_time, end_time;
+        std::string room_id, room_number, building;
+        int seats_taken = 0, max_students = 0; // filled by getAvailableScheduledCourses
+    };
+    // Column order of SQL_ENROLLED_COURSES and SQL_FACULTY_TIMETABLE.
+    static constexpr auto TIMETABLE_ROW = rowMap(
+        &ScheduledCourse::schedule_id, &ScheduledCourse::course_code, &ScheduledCourse::course_name,
+        &ScheduledCourse::department, &ScheduledCourse::semester, &ScheduledCourse::faculty_id,
+        &ScheduledCourse::faculty_name, &ScheduledCourse::timeslot_id, &ScheduledCourse::day,
+        &ScheduledCourse::start_time, &ScheduledCourse::end_time, &ScheduledCourse::room_id,
+        &ScheduledCourse::room_number, &ScheduledCourse::building);
+    // Column order of SQL_AVAILABLE_SCHEDULED_COURSES.
+    static constexpr auto AVAILABLE_COURSE_ROW = rowMap(
+        &ScheduledCourse::schedule_id, &ScheduledCourse::course_code, &ScheduledCourse::course_name,
+        &ScheduledCourse::faculty_name, &ScheduledCourse::day, &ScheduledCourse::start_time,
+        &ScheduledCourse::end_time, &ScheduledCourse::room_number, &ScheduledCourse::building,
+        &ScheduledCourse::timeslot_id, &ScheduledCourse::seats_taken, &ScheduledCourse::max_students);
+
+private:
+    static constexpr int COHORT_CACHE_TTL = 30; // seconds
+    std::shared_ptr<CohortCache<ScheduledCourse>> cohortCache;
+
+    std::shared_ptr<SeatReservations> seats; // set by enableFastRegistration()
+    // Refuses a section the student already holds or one in the timeslot of a
+    // section they hold.
+    static constexpr const char* SQL_APPLY_ENROLLMENT =
+        "INSERT INTO enrollments (student_id, schedule_id) SELECT ?, ? FROM DUAL "
+        "WHERE NOT EXISTS (SELECT 1 FROM enrollments e "
+        "JOIN course_schedule held ON e.schedule_id = held.schedule_id "
+        "JOIN course_schedule wanted ON wanted.timeslot_id = held.timeslot_id "
+        "WHERE e.student_id = ? AND wanted.schedule_id = ?)";
+
+public:
+    CohortCache<ScheduledCourse>::Stats getCohortCacheStats() const
+    {
+        return cohortCache->getStats();
+    }
+
+    // Registration-day mode: seats are taken from in-memory counters and the
+    // enrollments written behind (see SeatReservations). Every Database on the
+    // same server and schema shares one set of counters and one journal. Only
+    // one process may run this mode against a database at a time, and section
+    // changes made by other processes while it runs are not seen by the
+    // counters. In this process, admin operations that change seats or
+    // enrollments are refused (refuseDuringFastRegistration).
+    void enableFastRegistration(const std::string& journalPath)
+    {
+        TRACE_FUNCTION("db");
+        static std::mutex registryMutex;
+        static std::map<std::string, std::weak_ptr<SeatReservations>> registry;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto& slot = registry[connHost + "/" + connDb];
+        seats = slot.lock();
+        if (seats)
+            return;
+
+        auto writerSession = std::make_shared<mysqlx::Session>(mysqlx::SessionOption::HOST, endpointHost(connHost),
+                                                               mysqlx::SessionOption::PORT, endpointPort(connHost),
+                                                               mysqlx::SessionOption::USER, connUser,
+                                                               mysqlx::SessionOption::PWD, connPass,
+                                                               mysqlx::SessionOption::DB, connDb);
+        auto cache = cohortCache;
+        auto journal = audit;
+        // One transaction per batch. A student already holding the section or
+        // its timeslot is refused here; request keys are recorded alongside.
+        // hold() keeps this process from getting that far, so a refusal means
+        // another writer got in first: the Enroll already in the audit log is
+        // answered by an EnrollRejected.
+        auto apply = [writerSession, cache, journal](const std::vector<SeatReservations::Reservation>& batch) {
+            std::vector<bool> ok(batch.size(), false);
+            std::map<int, int> added;
+            writerSession->startTransaction();
+            try {
+                for (size_t i = 0; i < batch.size(); ++i)
+                {
+                    const auto& r = batch[i];
+                    if (!r.request_key.empty())
+                        writerSession->sql("INSERT IGNORE INTO idempotency_keys (request_key) VALUES (?)")
+                            .bind(r.request_key).execute();
+                    auto res = writerSession->sql(SQL_APPLY_ENROLLMENT)
+                        .bind(r.student_id, r.schedule_id, r.student_id, r.schedule_id).execute();
+                    ok[i] = res.getAffectedItemsCount() > 0;
+                    if (ok[i])
+                        ++added[r.schedule_id];
+                }
+                for (const auto& a : added)
+                    writerSession->sql("UPDATE course_schedule SET seats_taken = seats_taken + ? WHERE schedule_id = ?")
+                        .bind(a.second, a.first).execute();
+                writerSession->commit();
+            }
+            catch (...) {
+                try { writerSession->rollback(); } catch (...) {}
+                throw;
+            }
+            for (size_t i = 0; i < batch.size(); ++i)
+                if (!ok[i])
+                {
+                    cache->adjustSeats(batch[i].schedule_id, -1);
+                    try { // committed already: a failed audit journal must not make the batch look unapplied
+                        journal->record(AuditOp::EnrollRejected, "fast-registration", batch[i].student_id,
+                                        "#" + std::to_string(batch[i].schedule_id), "duplicate or timeslot clash");
+                    }
+                    catch (const std::exception& ex) {
+                        std::cerr << "Seat journal: " << ex.what() << std::endl;
+                    }
+                }
+            return ok;
+        };
+        seats = std::make_shared<SeatReservations>(journalPath, apply);
+
+        // Counters are loaded after recovery so replayed seats are counted.
+        seats->load(fetchAll(session.sql("SELECT cs.schedule_id, cs.seats_taken, c.max_students, cs.timeslot_id FROM course_schedule cs "
+                                         "JOIN courses c ON cs.course_code = c.course_code").execute(),
+                             rowMap(&SeatReservations::Counter::schedule_id, &SeatReservations::Counter::taken,
+                                    &SeatReservations::Counter::capacity, &SeatReservations::Counter::timeslot_id)));
+        slot = seats;
+    }
+    bool fastRegistration() const
+    {
+        return seats != nullptr;
+    }
+    // Admin operations that move seats or enrollments behind the in-memory
+    // counters, or that the write-behind queue could still land after.
+    void refuseDuringFastRegistration(const std::string& what) const
+    {
+        if (seats)
+            throw std::runtime_error(what + " is not allowed while fast registration is on");
+    }
+    // Waits until every enrollment taken so far is in the database.
+    void flushRegistrations()
+    {
+        if (seats)
+            seats->sync();
+    }
+    SeatReservations::Stats getSeatStats() const
+    {
+        return seats ? seats->getStats() : SeatReservations::Stats();
+    }
+
+    // Served from the cohort cache; see CohortCache for how it stays fresh.
+    std::vector<ScheduledCourse> getAvailableScheduledCourses(int semester, const std::string& degree)
+    {
+        TRACE_FUNCTION("db");
+        return cohortCache->get({semester, degree}, [&] { return queryAvailableScheduledCourses(semester, degree); });
+    }
+    std::vector<ScheduledCourse> queryAvailableScheduledCourses(int semester, const std::string& degree)
+    {
+        TRACE_FUNCTION("db");
+        mysqlx::Session& rs = reader();
+        return fetchAll(rs.sql(SQL_AVAILABLE_SCHEDULED_COURSES).bind(semester, degree).execute(), AVAILABLE_COURSE_ROW);
+    }
+
+    // Both checks also see fast registration seats not yet written behind.
+    bool isAlreadyEnrolled(const std::string& studentId, int schedule_id)
+    {
+        TRACE_FUNCTION("db");
+        if (seats && seats->isPending(studentId, schedule_id))
+            return true;
+        auto enrollments = db.getTable("enrollments");
+        auto res = enrollments.select("COUNT(*)")
+            .where("student_id = :sid AND schedule_id = :scid")
+            .bind("sid", studentId)
+            .bind("scid", schedule_id)
+            .execute();
+        auto row = res.fetchOne();
+        return row && row[0].get<int>() > 0;
+    }
+    bool hasClash(const std::string& studentId, int timeslot_id)
+    {
+        TRACE_FUNCTION("db");
+        if (seats && seats->isPendingAt(studentId, timeslot_id))
+            return true;
+        std::string query = SQL_HAS_CLASH;
+        auto res = session.sql(query).bind(studentId, timeslot_id).execute();
+        auto row = res.fetchOne();
+        return row && row[0].get<int>() > 0;
+    }
+    // Prerequisites of course_code the student has not completed; empty if eligible.
+    std::vector<std::string> getMissingPrerequisites(const std::string& studentId, const std::string& course_code)
+    {
+        TRACE_FUNCTION("db");
+        ensurePrerequisites();
+        bool loaded = !prerequisites.hasStudent(studentId);
+        if (loaded)
+            loadCompletedCourses(studentId);
+        auto missing = prerequisites.missing(studentId, course_code);
+        // Another process may have recorded completions since the set was cached.
+        if (!missing.empty() && !loaded &&
+            std::chrono::steady_clock::now() - completedLoadedAt[studentId] > std::chrono::milliseconds(COMPLETED_RECHECK_MS))
+        {
+            loadCompletedCourses(studentId);
+            missing = prerequisites.missing(studentId, course_code);
+        }
+        return missing;
+    }
+    void loadCompletedCourses(const std::string& studentId)
+    {
+        std::vector<std::string> completed =
+            fetchAll(session.sql(SQL_STANDING_PREREQUISITES).bind(studentId).execute(), SingleColumn<std::string>());
+        try {
+            for (auto& code : fetchAll(session.sql(SQL_COMPLETED_COURSES).bind(studentId).execute(), SingleColumn<std::string>()))
+                completed.push_back(std::move(code));
+        }
+        catch (const mysqlx::Error& err) {
+            // Not migrated yet (completed_courses arrives in V002): standing only.
+            std::cerr << "Completed courses unavailable: " << err.what() << std::endl;
+        }
+        prerequisites.setCompleted(studentId, completed);
+        completedLoadedAt[studentId] = std::chrono::steady_clock::now();
+    }
+    // Drop cached completion sets after completed_courses changes.
+    void invalidateCompletedCourses(const std::string& studentId = "")
+    {
+        if (studentId.empty())
+            prerequisites.forgetStudents();
+        else
+            prerequisites.forgetStudent(studentId);
+    }
+    // A resubmitted request with the same requestKey reports success without
+    // enrolling twice.
+    bool addEnrollment(const std::string& studentId, int schedule_id, const std::string& requestKey = "")
+    {
+        TRACE_FUNCTION("db");
+        std::string course_code;
+        {
+            std::string query = "SELECT course_code FROM course_schedule WHERE schedule_id = ?";
+            auto res = session.sql(query).bind(schedule_id).execute();
+            auto row = res.fetchOne();
+            if (!row) return false;
+            course_code = row[0].get<std::string>();
+        }
+        if (!getMissingPrerequisites(studentId, course_code).empty())
+            return false;
+        // A section added since the counters were loaded goes through the database.
+        int timeslot = seats ? seats->timeslotOf(schedule_id) : -1;
+        if (timeslot >= 0)
+        {
+            seats->check();
+            if (!seats->hold(studentId, {schedule_id}))
+                return false; // clashes with a seat still being written behind
+            FastClaim claim = claimFastRequest(requestKey);
+            if (claim == FastClaim::Replayed || seats->take(schedule_id) != SeatReservations::Taken)
+            {
+                seats->unhold(studentId, {schedule_id});
+                if (claim == FastClaim::Claimed)
+                    seats->releaseKey(requestKey);
+                return claim == FastClaim::Replayed;
+            }
+            seats->waitDurable(seats->submit(schedule_id, studentId, requestKey));
+            cohortCache->adjustSeats(schedule_id, 1);
+            recordWrite(AuditOp::Enroll, studentId, course_code + " #" + std::to_string(schedule_id));
+            return true;
+        }
+        // The seat is taken by bumping course_schedule.seats_taken only while it is
+        // below the course limit; the enrollment row goes in the same transaction.
+        TxOutcome outcome = transact([&] {
+            std::string query = SQL_TAKE_SEAT;
+            auto res = session.sql(query).bind(schedule_id).execute();
+            if (res.getAffectedItemsCount() == 0)
+                return false;
+            auto enrollments = db.getTable("enrollments");
+            enrollments.insert("student_id", "schedule_id").values(studentId, schedule_id).execute();
+            return true;
+        }, requestKey);
+        if (outcome != TxOutcome::Committed)
+            return outcome == TxOutcome::Replayed;
+        cohortCache->adjustSeats(schedule_id, 1);
+        recordWrite(AuditOp::Enroll, studentId, course_code + " #" + std::to_string(schedule_id));
+        return true;
+    }
+    struct SchedulePlan
+    {
+        std::vector<ScheduledCourse> sections;
+        int days, gapMinutes, minSeats;
+    };
+    // Best clash-free combinations of sections for the wanted course families
+    // (codes without the section letter), around the student's current
+    // timetable. Families with no open, eligible section go to `unavailable`.
+    std::vector<SchedulePlan> planSchedules(const std::string& studentId, const std::vector<std::string>& families, size_t keep,
+                                            uint64_t& complete, std::vector<std::string>& unavailable)
+    {
+        TRACE_FUNCTION("db");
+        ScheduleBuilder builder;
+        static const char* days[] = {"Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday", "Sunday"};
+        auto res = session.sql("SELECT timeslot_id, day_of_week, CAST(start_time AS CHAR), CAST(end_time AS CHAR) FROM timeslots").execute();
+        mysqlx::Row row;
+        while ((row = res.fetchOne()))
+        {
+            std::string day = row[1].get<std::string>();
+            int d = static_cast<int>(std::find(days, days + 7, day) - days);
+            builder.addTimeslot(row[0].get<int>(), d % 7, row[2].get<std::string>(), row[3].get<std::string>());
+        }
+        std::set<std::string> enrolledFamilies;
+        for (const auto& e : getEnrolledCourses(studentId))
+        {
+            builder.addBusy(e.timeslot_id);
+            enrolledFamilies.insert(courseFamily(e.course_code));
+        }
+
+        auto offered = getAvailableScheduledCourses(getStudentSemester(studentId), getStudentDegree(studentId));
+        std::vector<std::vector<ScheduledCourse>> groups;
+        std::set<std::string> grouped; // one section per family, however often it was asked for
+        for (const auto& family : families)
+        {
+            if (!grouped.insert(family).second)
+                continue;
+            std::vector<ScheduledCourse> sections;
+            std::vector<ScheduleBuilder::Option> options;
+            if (!enrolledFamilies.count(family))
+                for (const auto& sc : offered)
+                    if (courseFamily(sc.course_code) == family && sc.seats_taken < sc.max_students &&
+                        getMissingPrerequisites(studentId, sc.course_code).empty())
+                    {
+                        sections.push_back(sc);
+                        options.push_back({sc.schedule_id, sc.timeslot_id, sc.max_students - sc.seats_taken});
+                    }
+            if (sections.empty())
+            {
+                unavailable.push_back(family);
+                continue;
+            }
+            builder.addGroup(options);
+            groups.push_back(sections);
+        }
+
+        std::vector<SchedulePlan> plans;
+        for (const auto& p : builder.build(keep, complete))
+        {
+            SchedulePlan plan{{}, p.days, p.gapMinutes, p.minSeats};
+            for (size_t g = 0; g < groups.size(); ++g)
+                plan.sections.push_back(groups[g][p.picks[g]]);
+            plans.push_back(plan);
+        }
+        return plans;
+    }
+    // Enrolls in every section or none. Returns the first course that had no
+    // seat left, or "" on success. Throws if two sections share a family or
+    // the student already holds a section of one.
+    std::string enrollSchedule(const std::string& studentId, const std::vector<ScheduledCourse>& sections,
+                               const std::string& requestKey = "")
+    {
+        TRACE_FUNCTION("db");
+        std::set<std::string> families;
+        for (const auto& e : getEnrolledCourses(studentId))
+            families.insert(courseFamily(e.course_code));
+        for (const auto& sc : sections)
+            if (!families.insert(courseFamily(sc.course_code)).second)
+                throw std::runtime_error("Only one section of " + courseFamily(sc.course_code) + " can be taken");
+        std::string full;
+        if (seats && enrollScheduleFast(studentId, sections, requestKey, full))
+            return full;
+        TxOutcome outcome = transact([&] {
+            auto enrollments = db.getTable("enrollments");
+            for (const auto& sc : sections)
+            {
+                auto res = session.sql(SQL_TAKE_SEAT).bind(sc.schedule_id).execute();
+                if (res.getAffectedItemsCount() == 0)
+                {
+                    full = sc.course_code;
+                    return false;
+                }
+                enrollments.insert("student_id", "schedule_id").values(studentId, sc.schedule_id).execute();
+            }
+            return true;
+        }, requestKey);
+        if (outcome != TxOutcome::Committed)
+            return full;
+        for (const auto& sc : sections)
+        {
+            cohortCache->adjustSeats(sc.schedule_id, 1);
+            recordWrite(AuditOp::Enroll, studentId, sc.course_code + " #" + std::to_string(sc.schedule_id));
+        }
+        return "";
+    }
+    // Fast registration honours request keys as transact() does: a key still
+    // in the write-behind queue or already in idempotency_keys is a replay.
+    enum class FastClaim { None, Claimed, Replayed };
+    FastClaim claimFastRequest(const std::string& requestKey)
+    {
+        if (requestKey.empty())
+            return FastClaim::None;
+        if (!seats->claimKey(requestKey))
+            return FastClaim::Replayed;
+        auto res = session.sql("SELECT COUNT(*) FROM idempotency_keys WHERE request_key = ?").bind(requestKey).execute();
+        auto row = res.fetchOne();
+        if (row && row[0].get<int>() > 0)
+        {
+            seats->releaseKey(requestKey);
+            return FastClaim::Replayed;
+        }
+        return FastClaim::Claimed;
+    }
+    // All-or-nothing over the seat counters: seats already taken are given back
+    // when a later section is full. Returns false, leaving the work to the
+    // database path, if a section is not in the counters.
+    bool enrollScheduleFast(const std::string& studentId, const std::vector<ScheduledCourse>& sections,
+                            const std::string& requestKey, std::string& full)
+    {
+        for (const auto& sc : sections)
+            if (seats->timeslotOf(sc.schedule_id) < 0)
+                return false;
+        seats->check();
+        std::vector<int> ids;
+        for (const auto& sc : sections)
+            ids.push_back(sc.schedule_id);
+        if (!seats->hold(studentId, ids))
+            throw std::runtime_error("The schedule clashes with an enrollment still being registered");
+        FastClaim claim = claimFastRequest(requestKey);
+        if (claim == FastClaim::Replayed)
+        {
+            seats->unhold(studentId, ids);
+            return true;
+        }
+        size_t taken = 0;
+        for (; taken < sections.size(); ++taken)
+        {
+            auto r = seats->take(sections[taken].schedule_id);
+            if (r == SeatReservations::Taken)
+                continue;
+            for (size_t i = 0; i < taken; ++i)
+                seats->give(sections[i].schedule_id);
+            seats->unhold(studentId, ids);
+            if (claim == FastClaim::Claimed)
+                seats->releaseKey(requestKey);
+            full = sections[taken].course_code;
+            return true;
+        }
+        uint64_t last = 0;
+        for (const auto& sc : sections)
+            last = seats->submit(sc.schedule_id, studentId, requestKey);
+        seats->waitDurable(last);
+        for (const auto& sc : sections)
+        {
+            cohortCache->adjustSeats(sc.schedule_id, 1);
+            recordWrite(AuditOp::Enroll, studentId, sc.course_code + " #" + std::to_string(sc.schedule_id));
+        }
+        return true;
+    }
+    bool dropEnrollment(const std::string& studentId, int schedule_id)
+    {
+        TRACE_FUNCTION("db");
+        uint64_t removed = 0;
+        if (seats)
+            seats->sync(); // the row to drop may still be in the write-behind queue
+        transact([&] {
+            auto enrollments = db.getTable("enrollments");
+            auto res = enrollments.remove()
+                .where("student_id = :sid AND schedule_id = :scid")
+                .bind("sid", studentId)
+                .bind("scid", schedule_id)
+                .execute();
+            removed = res.getAffectedItemsCount();
+            if (removed > 0) {
+                session.sql("UPDATE course_schedule SET seats_taken = GREATEST(seats_taken - ?, 0) WHERE schedule_id = ?")
+                    .bind(removed, schedule_id).execute();
+            }
+            return true;
+        });
+        if (removed > 0)
+        {
+            if (seats)
+                for (uint64_t i = 0; i < removed; ++i)
+                    seats->give(schedule_id);
+            cohortCache->adjustSeats(schedule_id, -static_cast<int>(removed));
+            recordWrite(AuditOp::Drop, studentId, "#" + std::to_string(schedule_id));
+        }
+        return removed > 0;
+    }
+    std::vector<ScheduledCourse> getEnrolledCourses(const std::string& studentId)
+    {
+        TRACE_FUNCTION("db");
+        mysqlx::Session& rs = reader();
+        return fetchAll(rs.sql(SQL_ENROLLED_COURSES).bind(studentId).execute(), TIMETABLE_ROW);
+    }
+
+    typedef ScheduledCourse TimetableEntry;
+    std::vector<TimetableEntry> getStudentTimetable(const std::string& studentId)
+    {
+        return getEnrolledCourses(studentId);
+    }
+
+    // Faculty specific methods
+    std::vector<std::string> getFacultyCourses(int facultyId)
+    {
+        TRACE_FUNCTION("db");
+        mysqlx::Session& rs = reader();
+        return fetchAll(rs.sql(SQL_FACULTY_COURSES).bind(facultyId).execute(), SingleColumn<std::string>());
+    }
+
+    struct StudentInfo
+    {
+        std::string student_id;
+        std::string first_name;
+        std::string last_name;
+        std::string email;
+        int semester;
+        std::string degree;
+    };
+    // Column order of SQL_ENROLLED_STUDENTS.
+    static constexpr auto STUDENT_ROW = rowMap(&StudentInfo::student_id, &StudentInfo::first_name, &StudentInfo::last_name,
+                                               &StudentInfo::email, &StudentInfo::semester, &StudentInfo::degree);
+
+    std::vector<StudentInfo> getEnrolledStudentsInCourse(const std::string& course_code)
+    {
+        TRACE_FUNCTION("db");
+        mysqlx::Session& rs = reader();
+        return fetchAll(rs.sql(SQL_ENROLLED_STUDENTS).bind(course_code).execute(), STUDENT_ROW);
+    }
+    std::vector<StudentInfo> getStudents(size_t limit)
+    {
+        TRACE_FUNCTION("db");
+        return fetchAll(reader().sql("SELECT student_id, first_name, last_name, email, semester, degree FROM students ORDER BY student_id LIMIT ?")
+                            .bind(static_cast<int>(std::min<size_t>(limit, INT_MAX))).execute(),
+                        STUDENT_ROW);
+    }
+
+    // Keyset pagination: each page starts strictly after the last key of the
+    // previous one, so paging stays cheap and stable however deep it goes and
+    // while rows are added or removed. Filters left empty are not applied.
+    struct ListFilter
+    {
+        std::string department, day, building;
+    };
+    template <typename T, typename Key>
+    struct Page
+    {
+        std::vector<T> rows;
+        Key next{}; // pass as `after` to fetch the following page
+        bool more = false;
+    };
+
+    Page<StudentInfo, std::string> getEnrolledStudentsPage(const std::string& course_code, const std::string& after, size_t pageSize)
+    {
+        TRACE_FUNCTION("db");
+        mysqlx::Session& rs = reader();
+        Page<StudentInfo, std::string> page;
+        auto res = rs.sql(std::string(SQL_ENROLLED_STUDENTS) + " AND s.student_id > ? ORDER BY s.student_id LIMIT ?")
+            .bind(course_code).bind(after).bind(static_cast<int>(pageSize + 1)).execute();
+        fillPage(std::move(res), pageSize, page.rows, page.more, STUDENT_ROW);
+        if (!page.rows.empty())
+            page.next = page.rows.back().student_id;
+        return page;
+    }
+
+    std::vector<ScheduledCourse> getFacultyTimetable(int facultyId)
+    {
+        TRACE_FUNCTION("db");
+        mysqlx::Session& rs = reader();
+        return fetchAll(rs.sql(SQL_FACULTY_TIMETABLE).bind(facultyId).execute(), TIMETABLE_ROW);
+    }
+
+    void addMarks(const std::string& course_code, const std::string& student_id, const std::string& assignment_name, int total_marks, int obtained_marks,
+                  const std::string& requestKey = "")
+    {
+        TRACE_FUNCTION("db");
+        try {
+            std::string query = "INSERT INTO marks (course_code, student_id, assignment_name, total_marks, obtained_marks) VALUES (?, ?, ?, ?, ?) "
+                                "ON DUPLICATE KEY UPDATE total_marks = VALUES(total_marks), obtained_marks = VALUES(obtained_marks)";
+            if (transact([&] {
+                    session.sql(query).bind(course_code, student_id, assignment_name, total_marks, obtained_marks).execute();
+                    return true;
+                }, requestKey) != TxOutcome::Committed)
+                return;
+            grading.applyMarks(student_id, course_code, assignment_name, total_marks, obtained_marks);
+            recordWrite(AuditOp::MarksAdd, student_id, course_code + "/" + assignment_name,
+                        std::to_string(obtained_marks) + "/" + std::to_string(total_marks));
+        }
+        catch (const mysqlx::Error& err) {
+            std::cout << "Error adding marks: " << err.what() << std::endl;
+        }
+    }
+
+    void updateMarks(const std::string& course_code, const std::string& student_id, const std::string& assignment_name, int obtained_marks,
+                     const std::string& requestKey = "")
+    {
+        TRACE_FUNCTION("db");
+        try {
+            std::string query = "UPDATE marks SET obtained_marks = ? WHERE course_code = ? AND student_id = ? AND assignment_name = ?";
+            if (transact([&] {
+                    session.sql(query).bind(obtained_marks, course_code, student_id, assignment_name).execute();
+                    return true;
+                }, requestKey) != TxOutcome::Committed)
+                return;
+            grading.applyObtained(student_id, course_code, assignment_name, obtained_marks);
+            recordWrite(AuditOp::MarksUpdate, student_id, course_code + "/" + assignment_name,
+                        "obtained=" + std::to_string(obtained_marks));
+        }
+        catch (const mysqlx::Error& err) {
+            std::cout << "Error updating marks: " << err.what() << std::endl;
+        }
+    }
+
+    std::vector<std::string> getAssignmentsForCourse(const std::string& course_code) {
+        TRACE_FUNCTION("db");
+        return fetchAll(session.sql(SQL_COURSE_ASSIGNMENTS).bind(course_code).execute(), SingleColumn<std::string>());
+    }
+
+    struct AssignmentMark
+    {
+        std::string student_id;
+        int total_marks = 0, obtained_marks = 0;
+    };
+    // Column order of SQL_ASSIGNMENT_MARKS.
+    static constexpr auto ASSIGNMENT_MARK_ROW =
+        rowMap(&AssignmentMark::student_id, &AssignmentMark::total_marks, &AssignmentMark::obtained_marks);
+    std::vector<AssignmentMark> getStudentMarksForAssignment(const std::string& course_code, const std::string& assignment_name) {
+        TRACE_FUNCTION("db");
+        return fetchAll(session.sql(SQL_ASSIGNMENT_MARKS).bind(course_code, assignment_name).execute(), ASSIGNMENT_MARK_ROW);
+    }
+
+    // Percentage scores, one per student: a single assignment, or the whole
+    // course when assignment_name is empty.
+    std::vector<std::pair<std::string, double>> getScores(const std::string& course_code, const std::string& assignment_name)
+    {
+        TRACE_FUNCTION("db");
+        mysqlx::Session& rs = reader();
+        if (assignment_name.empty())
+            return fetchAll(rs.sql(SQL_COURSE_SCORES).bind(course_code).execute(), pairColumns<std::string, double>());
+        std::vector<std::pair<std::string, double>> scores;
+        for (const auto& m : fetchAll(rs.sql(SQL_ASSIGNMENT_MARKS).bind(course_code, assignment_name).execute(), ASSIGNMENT_MARK_ROW))
+            if (m.total_marks > 0)
+                scores.emplace_back(m.student_id, 100.0 * m.obtained_marks / m.total_marks);
+        return scores;
+    }
+    // Course-level statistics for every course of a department, one query.
+    std::vector<std::pair<std::string, GradeStats::Summary>> getDepartmentGradeStats(const std::string& department)
+    {
+        TRACE_FUNCTION("db");
+        mysqlx::Session& rs = reader();
+        std::vector<std::pair<std::string, GradeStats::Summary>> result;
+        std::string course;
+        std::vector<double> scores;
+        for (const auto& s : fetchAll(rs.sql(SQL_DEPARTMENT_SCORES).bind(department).execute(), pairColumns<std::string, double>()))
+        {
+            if (s.first != course && !scores.empty())
+            {
+                result.emplace_back(course, GradeStats::compute(scores));
+                scores.clear();
+            }
+            course = s.first;
+            scores.push_back(s.second);
+        }
+        if (!scores.empty())
+            result.emplace_back(course, GradeStats::compute(scores));
+        return result;
+    }
+
+    int getTotalEnrolledStudents(const std::string& course_code)
+    {
+        TRACE_FUNCTION("db");
+        // A course is scheduled once (getUnscheduledCourses hides scheduled ones),
+        // so its seat counter equals the number of distinct students.
+        std::string query = SQL_COURSE_SEATS_TAKEN;
+        auto res = session.sql(query).bind(course_code).execute();
+        auto row = res.fetchOne();
+        return row ? row[0].get<int>() : 0;
+    }
+
+    struct SeatDrift
+    {
+        int schedule_id;
+        std::string course_code;
+        int recorded, actual;
+    };
+    static constexpr auto SEAT_DRIFT_ROW =
+        rowMap(&SeatDrift::schedule_id, &SeatDrift::course_code, &SeatDrift::recorded, &SeatDrift::actual);
+    // Compares every seats_taken counter with the enrollments it stands for and,
+    // if repair is set, rewrites the drifted ones from a fresh count.
+    std::vector<SeatDrift> reconcileSeatCounters(bool repair)
+    {
+        TRACE_FUNCTION("db");
+        refuseDuringFastRegistration("Reconciling seat counters");
+        std::vector<SeatDrift> drift;
+        transact([&] {
+            drift.clear();
+            std::string query =
+                "SELECT cs.schedule_id, cs.course_code, cs.seats_taken, COUNT(e.schedule_id) "
+                "FROM course_schedule cs "
+                "LEFT JOIN enrollments e ON e.schedule_id = cs.schedule_id "
+                "GROUP BY cs.schedule_id, cs.course_code, cs.seats_taken "
+                "HAVING cs.seats_taken <> COUNT(e.schedule_id) "
+                "FOR UPDATE";
+            drift = fetchAll(session.sql(query).execute(), SEAT_DRIFT_ROW);
+            if (repair) {
+                for (const auto& d : drift)
+                    session.sql("UPDATE course_schedule SET seats_taken = ? WHERE schedule_id = ?")
+                        .bind(d.actual, d.schedule_id).execute();
+            }
+            return true;
+        });
+        if (repair && !drift.empty())
+            cohortCache->clear();
+        if (repair)
+            for (const auto& d : drift)
+                recordWrite(AuditOp::SeatRepair, d.course_code, "#" + std::to_string(d.schedule_id),
+                            std::to_string(d.recorded) + "->" + std::to_string(d.actual));
+        return drift;
+    }
+
+    int getNextFacultyId()
+    {
+        TRACE_FUNCTION("db");
+        std::string query = "SELECT MAX(faculty_id) FROM faculty";
+        auto res = session.sql(query).execute();
+        auto row = res.fetchOne();
+        int nextId = 1;
+        if (row && !row[0].isNull())
+        {
+            nextId = row[0].get<int>() + 1;
+        }
+        return nextId;
+    }
+    void addStudent(const std::string& id, const std::string& fname, const std::string& lname, const std::string& email, const std::string& degree, int semester)
+    {
+        TRACE_FUNCTION("db");
+        transact([&] {
+            auto students = db.getTable("students");
+            students.insert("student_id", "first_name", "last_name", "email", "degree", "semester", "password")
+                .values(id, fname, lname, email, degree, semester, "bnu") // password defaults to "bnu"
+                .execute();
+            return true;
+        });
+        if (peopleLoaded)
+            people.add(PeopleIndex::StudentEntry, id, 0, fname, lname, email);
+        recordWrite(AuditOp::StudentAdd, id, degree, "semester=" + std::to_string(semester));
+    }
+    void removeStudent(const std::string& id)
+    {
+        TRACE_FUNCTION("db");
+        refuseDuringFastRegistration("Removing a student");
+        // Give back the student's seats before their enrollments go with them.
+        transact([&] {
+            session.sql("UPDATE course_schedule cs JOIN enrollments e ON e.schedule_id = cs.schedule_id "
+                        "SET cs.seats_taken = GREATEST(cs.seats_taken - 1, 0) WHERE e.student_id = ?")
+                .bind(id).execute();
+            session.sql("DELETE FROM enrollments WHERE student_id = ?").bind(id).execute();
+            auto students = db.getTable("students");
+            students.remove().where("student_id = :sid").bind("sid", id).execute();
+            return true;
+        });
+        invalidateCompletedCourses(id);
+        grading.forgetStudent(id);
+        people.remove(PeopleIndex::StudentEntry, id);
+        cohortCache->clear();
+        recordWrite(AuditOp::StudentRemove, id);
+    }
+    void addFaculty(int faculty_id, const std::string& fname, const std::string& lname, const std::string& email, const std::string& degree, const std::string& qualification, const std::string& expertise_sub, const std::string& designation)
+    {
+        TRACE_FUNCTION("db");
+        transact([&] {
+            auto faculty = db.getTable("faculty");
+            faculty.insert("faculty_id", "first_name", "last_name", "email", "degree", "qualification", "expertise_sub", "designation", "password")
+                .values(faculty_id, fname, lname, email, degree, qualification, expertise_sub, designation, "faculty_scit")
+                .execute();
+            return true;
+        });
+        if (peopleLoaded)
+            people.add(PeopleIndex::FacultyEntry, email, faculty_id, fname, lname, email);
+        recordWrite(AuditOp::FacultyAdd, email, std::to_string(faculty_id));
+    }
+    void removeFaculty(int faculty_id)
+    {
+        TRACE_FUNCTION("db");
+        transact([&] {
+            auto faculty = db.getTable("faculty");
+            faculty.remove().where("faculty_id = :fid").bind("fid", faculty_id).execute();
+            return true;
+        });
+        people.removeFaculty(faculty_id);
+        cohortCache->clear();
+        recordWrite(AuditOp::FacultyRemove, std::to_string(faculty_id));
+    }
+    struct UtilisationRow
+    {
+        std::string id, label;
+        int capacity;       // rooms only
+        size_t booked;
+        double utilisation; // booked / timeslots
+        double seatFill;    // rooms only: seats taken / capacity over booked slots
+        std::vector<std::string> idleSlots;
+    };
+    struct OccupancyReport
+    {
+        std::vector<std::string> slots;
+        std::vector<size_t> roomsBusy, facultyBusy; // per slot
+        std::vector<UtilisationRow> rooms, faculty;
+        double roomUtilisation = 0, facultyUtilisation = 0, seatFill = 0;
+        size_t roomDoubleBookings = 0, facultyDoubleBookings = 0;
+        double millis = 0;
+    };
+    // Campus-wide room and faculty usage, built from one pass over course_schedule.
+    OccupancyReport getOccupancyReport()
+    {
+        TRACE_FUNCTION("db");
+        mysqlx::Session& rs = reader();
+        auto start = std::chrono::steady_clock::now();
+        OccupancyReport report;
+        std::unordered_map<int, size_t> slotIndex;
+        auto res = rs.sql("SELECT timeslot_id, CONCAT(day_of_week, ' ', start_time, '-', end_time) FROM timeslots ORDER BY timeslot_id").execute();
+        mysqlx::Row row;
+        while ((row = res.fetchOne()))
+        {
+            slotIndex[row[0].get<int>()] = report.slots.size();
+            report.slots.push_back(row[1].get<std::string>());
+        }
+        std::unordered_map<std::string, size_t> roomIndex;
+        res = rs.sql("SELECT room_id, CONCAT(room_number, ' ', building), capacity FROM classrooms ORDER BY room_id").execute();
+        while ((row = res.fetchOne()))
+        {
+            roomIndex[row[0].get<std::string>()] = report.rooms.size();
+            report.rooms.push_back({row[0].get<std::string>(), row[1].get<std::string>(), row[2].get<int>(), 0, 0, 0, {}});
+        }
+        std::unordered_map<int, size_t> facultyIndex;
+        res = rs.sql("SELECT faculty_id, CONCAT(first_name, ' ', last_name) FROM faculty ORDER BY faculty_id").execute();
+        while ((row = res.fetchOne()))
+        {
+            facultyIndex[row[0].get<int>()] = report.faculty.size();
+            report.faculty.push_back({std::to_string(row[0].get<int>()), row[1].get<std::string>(), 0, 0, 0, 0, {}});
+        }
+
+        OccupancyMatrix roomGrid(report.rooms.size(), report.slots.size());
+        OccupancyMatrix facultyGrid(report.faculty.size(), report.slots.size());
+        std::vector<long long> seatsTaken(report.rooms.size(), 0);
+        res = rs.sql("SELECT room_id, faculty_id, timeslot_id, seats_taken FROM course_schedule").execute();
+        while ((row = res.fetchOne()))
+        {
+            auto slot = slotIndex.find(row[2].get<int>());
+            if (slot == slotIndex.end())
+                continue;
+            auto room = roomIndex.find(row[0].get<std::string>());
+            if (room != roomIndex.end())
+            {
+                if (!roomGrid.book(room->second, slot->second))
+                    ++report.roomDoubleBookings;
+                seatsTaken[room->second] += row[3].get<int>();
+            }
+            auto fac = facultyIndex.find(row[1].get<int>());
+            if (fac != facultyIndex.end() && !facultyGrid.book(fac->second, slot->second))
+                ++report.facultyDoubleBookings;
+        }
+
+        long long offered = 0, taken = 0;
+        for (size_t i = 0; i < report.rooms.size(); ++i)
+        {
+            auto& r = report.rooms[i];
+            r.booked = roomGrid.booked(i);
+            r.utilisation = roomGrid.utilisation(i);
+            long long seats = static_cast<long long>(r.capacity) * r.booked;
+            r.seatFill = seats ? double(seatsTaken[i]) / seats : 0.0;
+            offered += seats;
+            taken += seatsTaken[i];
+            for (size_t s : roomGrid.idleSlots(i))
+                r.idleSlots.push_back(report.slots[s]);
+        }
+        for (size_t i = 0; i < report.faculty.size(); ++i)
+        {
+            auto& f = report.faculty[i];
+            f.booked = facultyGrid.booked(i);
+            f.utilisation = facultyGrid.utilisation(i);
+            for (size_t s : facultyGrid.idleSlots(i))
+                f.idleSlots.push_back(report.slots[s]);
+        }
+        report.roomsBusy = roomGrid.slotLoad();
+        report.facultyBusy = facultyGrid.slotLoad();
+        report.roomUtilisation = roomGrid.utilisation();
+        report.facultyUtilisation = facultyGrid.utilisation();
+        report.seatFill = offered ? double(taken) / offered : 0.0;
+        report.millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return report;
+    }
+    // Prefix and typo-tolerant lookup by id, name or email. kind < 0 searches
+    // students and faculty together.
+    std::vector<PeopleIndex::Match> searchPeople(const std::string& query, size_t limit = 10, int kind = -1)
+    {
+        ensurePeopleIndex();
+        return people.search(query, limit, kind);
+    }
+    // Returns the prerequisite cycle the course would create, or "" if none.
+    std::string findPrerequisiteCycle(const std::string& code, const std::string& prereq)
+    {
+        ensurePrerequisites();
+        return prerequisites.findCycle(code, prereq);
+    }
+    bool addCourse(const std::string& code, const std::string& name, int credits, int sem, const std::string& dept, int max, const std::string& prereq)
+    {
+        TRACE_FUNCTION("db");
+        if (!findPrerequisiteCycle(code, prereq).empty())
+            return false;
+        transact([&] {
+            auto courses = db.getTable("courses");
+            courses.insert("course_code", "course_name", "credits", "semester", "department", "max_students", "prerequisites")
+                .values(code, name, credits, sem, dept, max, prereq)
+                .execute();
+            return true;
+        });
+        prerequisites.setCourse(code, prereq);
+        if (grading.hasCatalogue()) // otherwise loaded whole on first use
+            grading.setCourse(code, {name, credits, sem});
+        recordWrite(AuditOp::CourseAdd, code, dept, "prerequisites=" + prereq);
+        return true;
+    }
+    void removeCourse(const std::string& code)
+    {
+        TRACE_FUNCTION("db");
+        refuseDuringFastRegistration("Removing a course");
+        transact([&] {
+            auto courses = db.getTable("courses");
+            courses.remove().where("course_code = :ccode").bind("ccode", code).execute();
+            return true;
+        });
+        if (prerequisitesLoaded)
+            prerequisites.removeCourse(code);
+        grading.removeCourse(code);
+        cohortCache->invalidateIf([&](const ScheduledCourse& sc) { return sc.course_code == code; });
+        recordWrite(AuditOp::CourseRemove, code);
+    }
+    void addClassroom(const std::string& id, const std::string& building, const std::string& number, int capacity, const std::string& room_type)
+    {
+        TRACE_FUNCTION("db");
+        transact([&] {
+            auto classrooms = db.getTable("classrooms");
+            classrooms.insert("room_id", "building", "room_number", "capacity", "room_type")
+                .values(id, building, number, capacity, room_type)
+                .execute();
+            return true;
+        });
+        recordWrite(AuditOp::ClassroomAdd, id, building + " " + number, "capacity=" + std::to_string(capacity));
+    }
+    void removeClassroom(const std::string& id)
+    {
+        TRACE_FUNCTION("db");
+        transact([&] {
+            auto classrooms = db.getTable("classrooms");
+            classrooms.remove().where("room_id = :rid").bind("rid", id).execute();
+            return true;
+        });
+        cohortCache->clear();
+        recordWrite(AuditOp::ClassroomRemove, id);
+    }
+    void addTimeslot(const std::string& day, const std::string& start, const std::string& end)
+    {
+        TRACE_FUNCTION("db");
+        transact([&] {
+            auto timeslots = db.getTable("timeslots");
+            timeslots.insert("day_of_week", "start_time", "end_time")
+                .values(day, start, end)
+                .execute();
+            return true;
+        });
+        recordWrite(AuditOp::TimeslotAdd, day, start + "-" + end);
+    }
+    void removeTimeslot(int timeslot_id)
+    {
+        TRACE_FUNCTION("db");
+        transact([&] {
+            auto timeslots = db.getTable("timeslots");
+            timeslots.remove().where("timeslot_id = :tid").bind("tid", timeslot_id).execute();
+            return true;
+        });
+        cohortCache->clear();
+        recordWrite(AuditOp::TimeslotRemove, std::to_string(timeslot_id));
+    }
+    std::vector<std::pair<std::string, std::string>> getUnscheduledCourses()
+    {
+        TRACE_FUNCTION("db");
+        return fetchAll(session.sql(SQL_UNSCHEDULED_COURSES).execute(), pairColumns<std::string, std::string>());
+    }
+    Page<std::pair<std::string, std::string>, std::string> getUnscheduledCoursesPage(const std::string& after, size_t pageSize, const ListFilter& filter)
+    {
+        TRACE_FUNCTION("db");
+        Page<std::pair<std::string, std::string>, std::string> page;
+        std::string sql = "SELECT c.course_code, c.course_name FROM courses c WHERE c.course_code > ? "
+                          "AND NOT EXISTS (SELECT 1 FROM course_schedule cs WHERE cs.course_code = c.course_code)";
+        std::vector<mysqlx::Value> params = {after};
+        addFilter(sql, params, "c.department", filter.department);
+        sql += " ORDER BY c.course_code LIMIT ?";
+        params.emplace_back(static_cast<int>(pageSize + 1));
+        fillPage(runBound(reader(), sql, params), pageSize, page.rows, page.more, pairColumns<std::string, std::string>());
+        if (!page.rows.empty())
+            page.next = page.rows.back().first;
+        return page;
+    }
+    std::vector<std::pair<int, std::string>> getAllTimeslots()
+    {
+        TRACE_FUNCTION("db");
+        return fetchAll(session.sql("SELECT timeslot_id, CONCAT(day_of_week, ' ', start_time, '-', end_time) FROM timeslots").execute(),
+                        pairColumns<int, std::string>());
+    }
+    std::vector<std::pair<std::string, std::string>> getAvailableRooms(int timeslot_id)
+    {
+        TRACE_FUNCTION("db");
+        return fetchAll(session.sql(SQL_AVAILABLE_ROOMS).bind(timeslot_id).execute(), pairColumns<std::string, std::string>());
+    }
+    Page<std::pair<std::string, std::string>, std::string> getAvailableRoomsPage(int timeslot_id, const std::string& after, size_t pageSize, const ListFilter& filter)
+    {
+        TRACE_FUNCTION("db");
+        Page<std::pair<std::string, std::string>, std::string> page;
+        std::string sql = "SELECT cl.room_id, CONCAT(cl.room_number, ' ', cl.building) FROM classrooms cl WHERE cl.room_id > ? "
+                          "AND NOT EXISTS (SELECT 1 FROM course_schedule cs WHERE cs.timeslot_id = ? AND cs.room_id = cl.room_id)";
+        std::vector<mysqlx::Value> params = {after, timeslot_id};
+        addFilter(sql, params, "cl.building", filter.building);
+        sql += " ORDER BY cl.room_id LIMIT ?";
+        params.emplace_back(static_cast<int>(pageSize + 1));
+        fillPage(runBound(reader(), sql, params), pageSize, page.rows, page.more, pairColumns<std::string, std::string>());
+        if (!page.rows.empty())
+            page.next = page.rows.back().first;
+        return page;
+    }
+    std::vector<std::pair<int, std::string>> getAvailableFaculty(int timeslot_id)
+    {
+        TRACE_FUNCTION("db");
+        return fetchAll(session.sql(SQL_AVAILABLE_FACULTY).bind(timeslot_id).execute(), pairColumns<int, std::string>());
+    }
+    void addCourseSchedule(const std::string& course_code, int faculty_id, int timeslot_id, const std::string& room_id)
+    {
+        TRACE_FUNCTION("db");
+        transact([&] {
+            auto course_schedule = db.getTable("course_schedule");
+            course_schedule.insert("course_code", "faculty_id", "timeslot_id", "room_id")
+                .values(course_code, faculty_id, timeslot_id, room_id)
+                .execute();
+            return true;
+        });
+        auto course = session.sql("SELECT semester, department FROM courses WHERE course_code = ?").bind(course_code).execute().fetchOne();
+        if (course)
+            cohortCache->invalidate({course[0].get<int>(), course[1].get<std::string>()});
+        else
+            cohortCache->clear();
+        recordWrite(AuditOp::ScheduleAdd, course_code, room_id,
+                    "faculty=" + std::to_string(faculty_id) + " timeslot=" + std::to_string(timeslot_id));
+    }
+    struct ScheduledAssignment
+    {
+        int schedule_id;
+        std::string course_code, course_name, faculty_name, room, timeslot;
+    };
+    static constexpr auto SCHEDULED_ASSIGNMENT_ROW =
+        rowMap(&ScheduledAssignment::schedule_id, &ScheduledAssignment::course_code, &ScheduledAssignment::course_name,
+               &ScheduledAssignment::faculty_name, &ScheduledAssignment::room, &ScheduledAssignment::timeslot);
+    std::vector<ScheduledAssignment> getAllCourseSchedules()
+    {
+        TRACE_FUNCTION("db");
+        mysqlx::Session& rs = reader();
+        std::string query =
+            "SELECT cs.schedule_id, cs.course_code, c.course_name, CONCAT(f.first_name, ' ', f.last_name) AS faculty, "
+            "CONCAT(cl.room_number, ' ', cl.building) AS room, CONCAT(t.day_of_week, ' ', t.start_time, '-', t.end_time) AS timeslot "
+            "FROM course_schedule cs "
+            "JOIN courses c ON cs.course_code = c.course_code "
+            "JOIN faculty f ON cs.faculty_id = f.faculty_id "
+            "JOIN timeslots t ON cs.timeslot_id = t.timeslot_id "
+            "JOIN classrooms cl ON cs.room_id = cl.room_id";
+        return fetchAll(rs.sql(query).execute(), SCHEDULED_ASSIGNMENT_ROW);
+    }
+    Page<ScheduledAssignment, int> getCourseSchedulesPage(int after, size_t pageSize, const ListFilter& filter)
+    {
+        TRACE_FUNCTION("db");
+        Page<ScheduledAssignment, int> page;
+        std::string sql =
+            "SELECT cs.schedule_id, cs.course_code, c.course_name, CONCAT(f.first_name, ' ', f.last_name) AS faculty, "
+            "CONCAT(cl.room_number, ' ', cl.building) AS room, CONCAT(t.day_of_week, ' ', t.start_time, '-', t.end_time) AS timeslot "
+            "FROM course_schedule cs "
+            "JOIN courses c ON cs.course_code = c.course_code "
+            "JOIN faculty f ON cs.faculty_id = f.faculty_id "
+            "JOIN timeslots t ON cs.timeslot_id = t.timeslot_id "
+            "JOIN classrooms cl ON cs.room_id = cl.room_id "
+            "WHERE cs.schedule_id > ?";
+        std::vector<mysqlx::Value> params = {after};
+        addFilter(sql, params, "c.department", filter.department);
+        addFilter(sql, params, "t.day_of_week", filter.day);
+        addFilter(sql, params, "cl.building", filter.building);
+        sql += " ORDER BY cs.schedule_id LIMIT ?";
+        params.emplace_back(static_cast<int>(pageSize + 1));
+        fillPage(runBound(reader(), sql, params), pageSize, page.rows, page.more, SCHEDULED_ASSIGNMENT_ROW);
+        if (!page.rows.empty())
+            page.next = page.rows.back().schedule_id;
+        return page;
+    }
+    void removeCourseSchedule(int schedule_id)
+    {
+        TRACE_FUNCTION("db");
+        refuseDuringFastRegistration("Removing a course assignment");
+        transact([&] {
+            {
+                auto enrollments = db.getTable("enrollments");
+                enrollments.remove().where("schedule_id = :sid").bind("sid", schedule_id).execute();
+            }
+            {
+                auto course_schedule = db.getTable("course_schedule");
+                course_schedule.remove().where("schedule_id = :sid").bind("sid", schedule_id).execute();
+            }
+            return true;
+        });
+        cohortCache->invalidateIf([&](const ScheduledCourse& sc) { return sc.schedule_id == schedule_id; });
+        recordWrite(AuditOp::ScheduleRemove, "#" + std::to_string(schedule_id));
+    }
+    bool isAdminPasswordCorrect(const std::string& password)
+    {
+        return password == "admin123";
+    }
+
+    // Marks related methods
+    struct Mark {
+        std::string assignment_name;
+        int total_marks;
+        int obtained_marks;
+        std::string course_name;
+    };
+    // Column order of SQL_STUDENT_MARKS.
+    static constexpr auto MARK_ROW = rowMap(&Mark::assignment_name, &Mark::total_marks, &Mark::obtained_marks, &Mark::course_name);
+    std::vector<Mark> getStudentMarks(const std::string& student_id, const std::string& course_code = "")
+    {
+        TRACE_FUNCTION("db");
+        mysqlx::Session& rs = reader();
+        std::string query = SQL_STUDENT_MARKS;
+
+        if (!course_code.empty()) {
+            query += " AND m.course_code = ?";
+        }
+
+        query += " ORDER BY m.assignment_name";
+        mysqlx::SqlStatement stmt = rs.sql(query).bind(student_id);
+        if (!course_code.empty()) {
+            stmt.bind(course_code);
+        }
+        return fetchAll(stmt.execute(), MARK_ROW);
+    }
+    std::vector<std::string> getStudentCourses(const std::string& student_id)
+    {
+        TRACE_FUNCTION("db");
+        mysqlx::Session& rs = reader();
+        return fetchAll(rs.sql(SQL_STUDENT_COURSES).bind(student_id).execute(), SingleColumn<std::string>());
+    }
+
+    // Grades and GPA
+    // Column order of SQL_STUDENT_MARK_ROWS; the student is the bound one.
+    static constexpr auto STUDENT_MARK_ROW =
+        rowMap(&GradingEngine::MarkRow::course_code, &GradingEngine::MarkRow::assignment_name,
+               &GradingEngine::MarkRow::total_marks, &GradingEngine::MarkRow::obtained_marks);
+    // Column order of SQL_ALL_MARK_ROWS.
+    static constexpr auto GRADING_MARK_ROW =
+        rowMap(&GradingEngine::MarkRow::student_id, &GradingEngine::MarkRow::course_code, &GradingEngine::MarkRow::assignment_name,
+               &GradingEngine::MarkRow::total_marks, &GradingEngine::MarkRow::obtained_marks);
+    static constexpr const char* SQL_ALL_MARK_ROWS =
+        "SELECT student_id, course_code, assignment_name, total_marks, obtained_marks FROM marks "
+        "UNION ALL "
+        "SELECT student_id, course_code, assignment_name, total_marks, obtained_marks FROM marks_history";
+    GradingEngine::Transcript getTranscript(const std::string& student_id)
+    {
+        TRACE_FUNCTION("db");
+        mysqlx::Session& rs = reader();
+        ensureGradingCatalogue();
+        if (!grading.hasStudent(student_id))
+        {
+            std::vector<GradingEngine::MarkRow> rows =
+                fetchAll(rs.sql(SQL_STUDENT_MARK_ROWS).bind(student_id, student_id).execute(), STUDENT_MARK_ROW);
+            for (auto& r : rows)
+                r.student_id = student_id;
+            ensureArchives();
+            for (const auto& archive : archives)
+                for (const auto& m : archive->marksForStudent(student_id))
+                    rows.push_back({student_id, m.course_code, m.assignment_name, m.total_marks, m.obtained_marks});
+            grading.load(student_id, rows);
+        }
+        return grading.transcript(student_id);
+    }
+    // Rebuilds every student's aggregates from one pass over marks; returns the
+    // number of students graded.
+    size_t recomputeAllGrades(unsigned threads)
+    {
+        TRACE_FUNCTION("db");
+        ensureGradingCatalogue();
+        std::vector<GradingEngine::MarkRow> rows = fetchAll(session.sql(SQL_ALL_MARK_ROWS).execute(), GRADING_MARK_ROW);
+        ensureArchives();
+        for (const auto& archive : archives)
+            archive->forEachMark([&](const TermArchive::Mark& m) {
+                rows.push_back({m.student_id, m.course_code, m.assignment_name, m.total_marks, m.obtained_marks});
+            });
+        grading.recomputeAll(rows, threads);
+        return grading.studentCount();
+    }
+    // End-of-semester cohort operations. Each runs as a few set-based statements
+    // in one transaction and reports (step, rows affected) once it commits;
+    // counts from an attempt that was rolled back and retried are not shown.
+    typedef std::function<void(const std::string&, uint64_t)> Progress;
+    typedef std::vector<std::pair<std::string, uint64_t>> StepCounts;
+    static void reportSteps(const StepCounts& counts, const Progress& progress)
+    {
+        for (const auto& c : counts)
+            progress(c.first, c.second);
+    }
+
+    // Moves this term's enrollments and marks into the history tables, records
+    // passed courses in completed_courses, and resets the seat counters.
+    void archiveTerm(const std::string& term, const Progress& progress)
+    {
+        TRACE_FUNCTION("db");
+        refuseDuringFastRegistration("Archiving the term");
+        StepCounts counts;
+        transact([&] {
+            counts.clear();
+            auto step = [&](const char* name, mysqlx::SqlStatement stmt) {
+                counts.emplace_back(name, stmt.execute().getAffectedItemsCount());
+            };
+            step("enrollments archived", session.sql(
+                "INSERT INTO enrollment_history (term, student_id, course_code, faculty_id, timeslot_id, room_id) "
+                "SELECT ?, e.student_id, cs.course_code, cs.faculty_id, cs.timeslot_id, cs.room_id "
+                "FROM enrollments e JOIN course_schedule cs ON e.schedule_id = cs.schedule_id").bind(term));
+            step("courses completed", session.sql(
+                "INSERT IGNORE INTO completed_courses (student_id, course_code) "
+                "SELECT student_id, course_code FROM marks GROUP BY student_id, course_code "
+                "HAVING SUM(obtained_marks) * 2 >= SUM(total_marks)"));
+            step("marks archived", session.sql(
+                "INSERT INTO marks_history (term, course_code, student_id, assignment_name, total_marks, obtained_marks) "
+                "SELECT ?, course_code, student_id, assignment_name, total_marks, obtained_marks FROM marks").bind(term));
+            step("marks cleared", session.sql("DELETE FROM marks"));
+            step("enrollments cleared", session.sql("DELETE FROM enrollments"));
+            step("seat counters reset", session.sql("UPDATE course_schedule SET seats_taken = 0 WHERE seats_taken <> 0"));
+            step("request keys expired", session.sql("DELETE FROM idempotency_keys WHERE created_at < NOW() - INTERVAL 1 DAY"));
+            return true;
+        });
+        reportSteps(counts, progress);
+        cohortCache->clear();
+        recordWrite(AuditOp::TermArchive, term);
+        invalidateCompletedCourses();
+        grading.forgetStudents();
+    }
+    // Moves final-semester students to alumni. Refused while any of them has
+    // marks in the current term (archiveTerm first), since deleting the
+    // student would cascade them away. Their seats are given back before
+    // their enrollments go, as in removeStudent; someone already in alumni
+    // keeps their row there.
+    void graduateStudents(const Progress& progress)
+    {
+        TRACE_FUNCTION("db");
+        refuseDuringFastRegistration("Graduating students");
+        StepCounts counts;
+        int ungraded = 0;
+        TxOutcome outcome = transact([&] {
+            counts.clear();
+            auto row = session.sql("SELECT COUNT(DISTINCT m.student_id) FROM marks m "
+                                   "JOIN students s ON m.student_id = s.student_id WHERE s.semester >= 8").execute().fetchOne();
+            ungraded = row ? row[0].get<int>() : 0;
+            if (ungraded > 0)
+                return false;
+            counts.emplace_back("seats released", session.sql(
+                "UPDATE course_schedule cs JOIN (SELECT e.schedule_id, COUNT(*) AS n FROM enrollments e "
+                "JOIN students s ON e.student_id = s.student_id WHERE s.semester >= 8 GROUP BY e.schedule_id) g "
+                "ON cs.schedule_id = g.schedule_id SET cs.seats_taken = GREATEST(cs.seats_taken - g.n, 0)")
+                .execute().getAffectedItemsCount());
+            counts.emplace_back("enrollments removed", session.sql(
+                "DELETE e FROM enrollments e JOIN students s ON e.student_id = s.student_id WHERE s.semester >= 8")
+                .execute().getAffectedItemsCount());
+            counts.emplace_back("students graduated", session.sql(
+                "INSERT IGNORE INTO alumni (student_id, first_name, last_name, email, degree) "
+                "SELECT student_id, first_name, last_name, email, degree FROM students WHERE semester >= 8")
+                .execute().getAffectedItemsCount());
+            counts.emplace_back("students removed", session.sql("DELETE FROM students WHERE semester >= 8").execute().getAffectedItemsCount());
+            return true;
+        });
+        if (outcome == TxOutcome::Aborted)
+            throw std::runtime_error(std::to_string(ungraded) + " graduating student(s) still have marks this term; "
+                                     "archive the term first");
+        reportSteps(counts, progress);
+        cohortCache->clear();
+        recordWrite(AuditOp::Graduate, "semester 8");
+        invalidateCompletedCourses();
+        grading.forgetStudents();
+        peopleLoaded = false;
+    }
+    void promoteStudents(const Progress& progress)
+    {
+        TRACE_FUNCTION("db");
+        StepCounts counts;
+        transact([&] {
+            counts.clear();
+            counts.emplace_back("students promoted", session.sql("UPDATE students SET semester = semester + 1 WHERE semester < 8")
+                .execute().getAffectedItemsCount());
+            return true;
+        });
+        reportSteps(counts, progress);
+        recordWrite(AuditOp::Promote, "all students");
+    }
+    // Removes every course assignment together with any enrollments left on it.
+    void clearSchedule(const Progress& progress)
+    {
+        TRACE_FUNCTION("db");
+        refuseDuringFastRegistration("Clearing the schedule");
+        StepCounts counts;
+        transact([&] {
+            counts.clear();
+            counts.emplace_back("enrollments cleared", session.sql("DELETE FROM enrollments").execute().getAffectedItemsCount());
+            counts.emplace_back("assignments cleared", session.sql("DELETE FROM course_schedule").execute().getAffectedItemsCount());
+            return true;
+        });
+        reportSteps(counts, progress);
+        cohortCache->clear();
+        recordWrite(AuditOp::ScheduleClear, "all assignments");
+    }
+
+    // Term archive: closed terms leave enrollment_history/marks_history for a
+    // columnar file per term under archiveDir.
+    struct ArchivedTerm
+    {
+        std::string term;
+        size_t enrollments, marks;
+    };
+    // Column orders of the history SELECTs in archiveTermToDisk.
+    static constexpr auto ARCHIVE_ENROLLMENT_ROW =
+        rowMap(&TermArchive::Enrollment::student_id, &TermArchive::Enrollment::course_code, &TermArchive::Enrollment::faculty_id,
+               &TermArchive::Enrollment::timeslot_id, &TermArchive::Enrollment::room_id);
+    static constexpr auto ARCHIVE_MARK_ROW =
+        rowMap(&TermArchive::Mark::student_id, &TermArchive::Mark::course_code, &TermArchive::Mark::assignment_name,
+               &TermArchive::Mark::total_marks, &TermArchive::Mark::obtained_marks);
+    // Writes the term's history rows to <archiveDir>/<term>.scar (see
+    // archiveFileName), verifies the file, then deletes the rows. Returns zero
+    // counts if the term has no rows.
+    ArchivedTerm archiveTermToDisk(const std::string& term)
+    {
+        TRACE_FUNCTION("db");
+        std::vector<TermArchive::Enrollment> enrollments =
+            fetchAll(session.sql("SELECT student_id, course_code, faculty_id, timeslot_id, room_id "
+                                 "FROM enrollment_history WHERE term = ?").bind(term).execute(), ARCHIVE_ENROLLMENT_ROW);
+        std::vector<TermArchive::Mark> marks =
+            fetchAll(session.sql("SELECT student_id, course_code, assignment_name, total_marks, obtained_marks "
+                                 "FROM marks_history WHERE term = ?").bind(term).execute(), ARCHIVE_MARK_ROW);
+        if (enrollments.empty() && marks.empty())
+            return {term, 0, 0};
+        size_t newEnrollments = enrollments.size(), newMarks = marks.size();
+
+        std::filesystem::create_directories(archiveDir);
+        std::string path = archiveDir + "/" + archiveFileName(term);
+        // Rows archived for the term earlier are kept: the file is rewritten
+        // with them and the new ones. A file of another term is never replaced.
+        if (std::filesystem::exists(path))
+        {
+            TermArchive existing(path);
+            if (existing.term() != term)
+                throw std::runtime_error(path + " already holds term " + existing.term());
+            existing.forEachEnrollment([&](const TermArchive::Enrollment& e) { enrollments.push_back(e); });
+            existing.forEachMark([&](const TermArchive::Mark& m) { marks.push_back(m); });
+        }
+        std::string tmp = path + ".tmp";
+        TermArchive::write(tmp, term, enrollments, marks);
+        {
+            TermArchive written(tmp);
+            if (written.term() != term || written.enrollmentCount() != enrollments.size() || written.markCount() != marks.size())
+                throw std::runtime_error("Archive verification failed for " + tmp);
+        }
+        std::filesystem::rename(tmp, path);
+        std::unique_ptr<TermArchive> archive(new TermArchive(path));
+
+        transact([&] {
+            session.sql("DELETE FROM enrollment_history WHERE term = ?").bind(term).execute();
+            session.sql("DELETE FROM marks_history WHERE term = ?").bind(term).execute();
+            return true;
+        });
+
+        ensureArchives();
+        archives.erase(std::remove_if(archives.begin(), archives.end(),
+                                      [&](const std::unique_ptr<TermArchive>& a) { return a->term() == term; }),
+                       archives.end());
+        archives.push_back(std::move(archive));
+        grading.forgetStudents();
+        recordWrite(AuditOp::TermToDisk, term, path);
+        return {term, newEnrollments, newMarks};
+    }
+    // Term names are free text; bytes other than letters, digits, '-' and
+    // '_' are written as %XX so that no two terms share a file.
+    static std::string archiveFileName(const std::string& term)
+    {
+        static const char* hex = "0123456789ABCDEF";
+        std::string file;
+        for (char ch : term)
+        {
+            unsigned char c = static_cast<unsigned char>(ch);
+            if (std::isalnum(c) || c == '-' || c == '_')
+                file += ch;
+            else
+            {
+                file += '%';
+                file += hex[c >> 4];
+                file += hex[c & 15];
+            }
+        }
+        return file + ".scar";
+    }
+    std::vector<ArchivedTerm> getArchivedTerms()
+    {
+        ensureArchives();
+        std::vector<ArchivedTerm> result;
+        for (const auto& a : archives)
+            result.push_back({a->term(), a->enrollmentCount(), a->markCount()});
+        std::sort(result.begin(), result.end(), [](const ArchivedTerm& a, const ArchivedTerm& b) { return a.term < b.term; });
+        return result;
+    }
+    std::map<std::string, int> getArchivedCourseEnrollments(const std::string& term)
+    {
+        ensureArchives();
+        for (const auto& a : archives)
+            if (a->term() == term)
+                return a->enrollmentsPerCourse();
+        return {};
+    }
+
+    // Schema migrations
+    struct Migration
+    {
+        int version;
+        std::string name;
+        bool applied; // applied by this run rather than already present
+    };
+    // Applies every Schema/V<version>__<name>.sql not yet recorded in
+    // schema_migrations, in version order. Throws if an applied script was edited.
+    std::vector<Migration> migrate(const std::string& dir)
+    {
+        TRACE_FUNCTION("db");
+        session.sql("CREATE TABLE IF NOT EXISTS schema_migrations ("
+                    "version INT NOT NULL PRIMARY KEY, name VARCHAR(100) NOT NULL, "
+                    "checksum CHAR(16) NOT NULL, applied_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP)").execute();
+        std::map<int, std::string> applied;
+        {
+            auto res = session.sql("SELECT version, checksum FROM schema_migrations").execute();
+            mysqlx::Row row;
+            while ((row = res.fetchOne()))
+                applied[row[0].get<int>()] = row[1].get<std::string>();
+        }
+
+        std::map<int, std::filesystem::path> files;
+        for (const auto& entry : std::filesystem::directory_iterator(dir))
+        {
+            std::string file = entry.path().filename().string();
+            size_t sep = file.find("__");
+            if (file.size() < 2 || file[0] != 'V' || sep == std::string::npos || entry.path().extension() != ".sql")
+                continue;
+            files[std::stoi(file.substr(1, sep - 1))] = entry.path();
+        }
+
+        std::vector<Migration> result;
+        for (const auto& f : files)
+        {
+            std::ifstream in(f.second);
+            std::string script((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            std::string checksum = fnv1aHex(script);
+            std::string stem = f.second.stem().string();
+            std::string name = stem.substr(stem.find("__") + 2);
+            auto it = applied.find(f.first);
+            if (it != applied.end())
+            {
+                if (it->second != checksum)
+                    throw std::runtime_error("Migration V" + std::to_string(f.first) + " was modified after it was applied");
+                result.push_back({f.first, name, false});
+                continue;
+            }
+            // DDL commits implicitly in MySQL, so a script cannot be rolled back; a
+            // failure stops the run with the version unrecorded.
+            for (const auto& statement : splitSqlStatements(script))
+                session.sql(statement).execute();
+            session.sql("INSERT INTO schema_migrations (version, name, checksum) VALUES (?, ?, ?)")
+                .bind(f.first, name, checksum).execute();
+            result.push_back({f.first, name, true});
+        }
+        return result;
+    }
+
+    // Builds an exam timetable for every scheduled course from current
+    // enrollments and classroom capacities. Nothing is written until
+    // saveExamSchedule.
+    ExamScheduler::Result planExams(unsigned threads, std::chrono::milliseconds budget)
+    {
+        TRACE_FUNCTION("db");
+        mysqlx::Session& rs = reader();
+        ExamScheduler scheduler;
+        auto res = rs.sql("SELECT room_id, capacity FROM classrooms ORDER BY room_id").execute();
+        mysqlx::Row row;
+        while ((row = res.fetchOne()))
+            scheduler.addRoom(row[0].get<std::string>(), row[1].get<int>());
+        res = rs.sql("SELECT DISTINCT course_code FROM course_schedule ORDER BY course_code").execute();
+        while ((row = res.fetchOne()))
+            scheduler.addCourse(row[0].get<std::string>());
+        res = rs.sql("SELECT cs.course_code, e.student_id FROM enrollments e "
+                          "JOIN course_schedule cs ON e.schedule_id = cs.schedule_id").execute();
+        while ((row = res.fetchOne()))
+            scheduler.addEnrollment(row[0].get<std::string>(), row[1].get<std::string>());
+        return scheduler.solve(threads, budget);
+    }
+    // Replaces the exam timetable in one transaction.
+    void saveExamSchedule(const ExamScheduler::Result& plan)
+    {
+        TRACE_FUNCTION("db");
+        transact([&] {
+            session.sql("DELETE FROM exam_schedule").execute();
+            auto exams = db.getTable("exam_schedule");
+            for (size_t i = 0; i < plan.sittings.size(); i += 500)
+            {
+                auto insert = exams.insert("course_code", "exam_slot", "room_id", "seats");
+                for (size_t j = i; j < plan.sittings.size() && j < i + 500; ++j)
+                {
+                    const auto& s = plan.sittings[j];
+                    insert.values(s.course_code, s.slot, s.room_id, s.seats);
+                }
+                insert.execute();
+            }
+            return true;
+        });
+        recordWrite(AuditOp::ExamSchedule, "all courses", std::to_string(plan.sittings.size()) + " sittings",
+                    std::to_string(plan.slots) + " slots");
+    }
+
+    // Parallel sections share the code without the section letter:
+    // "CS202A" -> "CS202", and labs, whose codes end in L, "CS202LA" -> "CS202L".
+    // A lab with a single section ("CS602L") is its own family, apart from the
+    // lectures, as in the prerequisites column ("CS102L").
+    static std::string courseFamily(const std::string& code)
+    {
+        size_t digits = code.size();
+        while (digits > 0 && std::isalpha(static_cast<unsigned char>(code[digits - 1])))
+            --digits;
+        if (digits == 0 || !std::isdigit(static_cast<unsigned char>(code[digits - 1])))
+            return code;
+        std::string suffix = code.substr(digits);
+        if (suffix.size() == 1 && suffix != "L")
+            return code.substr(0, digits);
+        if (suffix.size() == 2 && suffix[0] == 'L')
+            return code.substr(0, digits + 1);
+        return code;
+    }
+    struct SectionPlan
+    {
+        std::vector<SectionBalancer::Section> sections;
+        std::vector<SectionBalancer::Move> moves;
+    };
+    // Works out a clash-free reassignment that evens out the sections of a
+    // course family. Students with marks in their section stay put.
+    SectionPlan planSectionBalance(const std::string& family)
+    {
+        TRACE_FUNCTION("db");
+        SectionBalancer balancer;
+        std::string pattern = family + "_";
+        std::map<int, size_t> sectionOf;     // schedule_id -> section
+        auto res = session.sql("SELECT cs.schedule_id, cs.course_code, cs.timeslot_id, c.max_students FROM course_schedule cs "
+                               "JOIN courses c ON cs.course_code = c.course_code WHERE cs.course_code LIKE ? ORDER BY cs.course_code")
+                       .bind(pattern).execute();
+        mysqlx::Row row;
+        std::vector<int> sectionSlot;
+        while ((row = res.fetchOne()))
+        {
+            std::string code = row[1].get<std::string>();
+            if (courseFamily(code) != family || code == family)
+                continue;
+            size_t sec = balancer.addSection(row[0].get<int>(), code, row[3].get<int>());
+            sectionOf[row[0].get<int>()] = sec;
+            sectionSlot.push_back(row[2].get<int>());
+        }
+        if (sectionOf.size() < 2)
+            return {balancer.getSections(), {}};
+
+        std::map<std::string, std::vector<size_t>> current;
+        res = session.sql("SELECT e.student_id, e.schedule_id FROM enrollments e "
+                          "JOIN course_schedule cs ON e.schedule_id = cs.schedule_id WHERE cs.course_code LIKE ?")
+                  .bind(pattern).execute();
+        while ((row = res.fetchOne()))
+        {
+            auto sec = sectionOf.find(row[1].get<int>());
+            if (sec != sectionOf.end())
+                current[row[0].get<std::string>()].push_back(sec->second);
+        }
+        std::map<std::string, std::vector<int>> busy; // timeslots taken by the student's other courses
+        res = session.sql("SELECT e.student_id, cs.timeslot_id, cs.schedule_id FROM enrollments e "
+                          "JOIN course_schedule cs ON e.schedule_id = cs.schedule_id "
+                          "WHERE e.student_id IN (SELECT e2.student_id FROM enrollments e2 "
+                          "JOIN course_schedule cs2 ON e2.schedule_id = cs2.schedule_id WHERE cs2.course_code LIKE ?)")
+                  .bind(pattern).execute();
+        while ((row = res.fetchOne()))
+            if (!sectionOf.count(row[2].get<int>()))
+                busy[row[0].get<std::string>()].push_back(row[1].get<int>());
+        std::set<std::string> marked;
+        res = session.sql("SELECT DISTINCT student_id, course_code FROM marks WHERE course_code LIKE ?").bind(pattern).execute();
+        while ((row = res.fetchOne()))
+            marked.insert(row[0].get<std::string>() + "|" + row[1].get<std::string>());
+
+        for (const auto& st : current)
+        {
+            size_t sec = st.second.front();
+            if (st.second.size() > 1 || marked.count(st.first + "|" + balancer.getSections()[sec].course_code))
+            {
+                for (size_t s : st.second)
+                    balancer.pin(s);
+                continue;
+            }
+            const auto& slots = busy[st.first];
+            std::vector<size_t> allowed;
+            for (size_t other = 0; other < sectionSlot.size(); ++other)
+                if (other == sec || std::find(slots.begin(), slots.end(), sectionSlot[other]) == slots.end())
+                    allowed.push_back(other);
+            if (allowed.size() == 1)
+                balancer.pin(sec);
+            else
+                balancer.addStudent(st.first, sec, allowed);
+        }
+        auto moves = balancer.solve();
+        return {balancer.getSections(), moves};
+    }
+    // Applies a plan from planSectionBalance in one transaction and returns
+    // the number of students moved. A student who dropped or changed section
+    // since the plan was made is skipped, and seat counts follow the moves
+    // actually made. Refused during fast registration, whose in-memory seat
+    // counters would not see the moves.
+    size_t applySectionBalance(const SectionPlan& plan)
+    {
+        TRACE_FUNCTION("db");
+        refuseDuringFastRegistration("Balancing sections");
+        if (plan.moves.empty())
+            return 0;
+        std::vector<size_t> moved;
+        std::map<int, int> delta; // schedule_id -> seats gained
+        transact([&] {
+            moved.clear();
+            delta.clear();
+            for (size_t i = 0; i < plan.moves.size(); ++i)
+            {
+                const auto& m = plan.moves[i];
+                int from = plan.sections[m.from].schedule_id, to = plan.sections[m.to].schedule_id;
+                auto res = session.sql("UPDATE enrollments SET schedule_id = ? WHERE student_id = ? AND schedule_id = ?")
+                    .bind(to).bind(m.student_id).bind(from).execute();
+                if (res.getAffectedItemsCount() == 0)
+                    continue;
+                moved.push_back(i);
+                --delta[from];
+                ++delta[to];
+            }
+            for (const auto& d : delta)
+                if (d.second != 0)
+                    session.sql("UPDATE course_schedule SET seats_taken = GREATEST(seats_taken + ?, 0) WHERE schedule_id = ?")
+                        .bind(d.second).bind(d.first).execute();
+            return true;
+        });
+        for (const auto& d : delta)
+            if (d.second != 0)
+                cohortCache->adjustSeats(d.first, d.second);
+        for (size_t i : moved)
+        {
+            const auto& m = plan.moves[i];
+            recordWrite(AuditOp::SectionMove, m.student_id, plan.sections[m.from].course_code,
+                        "to " + plan.sections[m.to].course_code);
+        }
+        return moved.size();
+    }
+
+    // Column orders of the SELECTs in readSnapshotContents.
+    static constexpr auto SNAPSHOT_COURSE_ROW =
+        rowMap(&Snapshot::Course::code, &Snapshot::Course::name, &Snapshot::Course::department, &Snapshot::Course::prerequisites,
+               &Snapshot::Course::credits, &Snapshot::Course::semester, &Snapshot::Course::max_students);
+    static constexpr auto SNAPSHOT_ROOM_ROW =
+        rowMap(&Snapshot::Room::room_id, &Snapshot::Room::building, &Snapshot::Room::room_number, &Snapshot::Room::room_type,
+               &Snapshot::Room::capacity);
+    static constexpr auto SNAPSHOT_TIMESLOT_ROW =
+        rowMap(&Snapshot::Timeslot::timeslot_id, &Snapshot::Timeslot::day, &Snapshot::Timeslot::start, &Snapshot::Timeslot::end);
+    static constexpr auto SNAPSHOT_FACULTY_ROW =
+        rowMap(&Snapshot::Member::id, &Snapshot::Member::first_name, &Snapshot::Member::last_name, &Snapshot::Member::email,
+               &Snapshot::Member::degree);
+    static constexpr auto SNAPSHOT_STUDENT_ROW =
+        rowMap(&Snapshot::Member::id, &Snapshot::Member::first_name, &Snapshot::Member::last_name, &Snapshot::Member::email,
+               &Snapshot::Member::degree, &Snapshot::Member::semester);
+    static constexpr auto SNAPSHOT_SECTION_ROW =
+        rowMap(&Snapshot::Section::schedule_id, &Snapshot::Section::course_code, &Snapshot::Section::faculty_id,
+               &Snapshot::Section::timeslot_id, &Snapshot::Section::room_id, &Snapshot::Section::seats_taken);
+    // Dumps reference tables, the schedule and enrollments to a snapshot file.
+    Snapshot::Contents readSnapshotContents()
+    {
+        TRACE_FUNCTION("db");
+        mysqlx::Session& rs = reader();
+        Snapshot::Contents c;
+        c.courses = fetchAll(rs.sql("SELECT course_code, course_name, department, COALESCE(prerequisites, ''), credits, semester, max_students "
+                                    "FROM courses").execute(), SNAPSHOT_COURSE_ROW);
+        c.rooms = fetchAll(rs.sql("SELECT room_id, building, room_number, COALESCE(room_type, ''), capacity FROM classrooms").execute(),
+                           SNAPSHOT_ROOM_ROW);
+        c.timeslots = fetchAll(rs.sql("SELECT timeslot_id, day_of_week, CAST(start_time AS CHAR), CAST(end_time AS CHAR) "
+                                      "FROM timeslots ORDER BY timeslot_id").execute(), SNAPSHOT_TIMESLOT_ROW);
+        c.faculty = fetchAll(rs.sql("SELECT CAST(faculty_id AS CHAR), first_name, last_name, email, COALESCE(degree, '') FROM faculty").execute(),
+                             SNAPSHOT_FACULTY_ROW);
+        c.students = fetchAll(rs.sql("SELECT student_id, first_name, last_name, email, degree, semester FROM students").execute(),
+                              SNAPSHOT_STUDENT_ROW);
+        c.sections = fetchAll(rs.sql("SELECT schedule_id, course_code, faculty_id, timeslot_id, room_id, seats_taken FROM course_schedule").execute(),
+                              SNAPSHOT_SECTION_ROW);
+        c.enrollments = fetchAll(rs.sql("SELECT student_id, schedule_id FROM enrollments").execute(), pairColumns<std::string, int>());
+        return c;
+    }
+    void writeSnapshot(const std::string& path)
+    {
+        Snapshot::write(path, readSnapshotContents());
+    }
+    // Preloads the search index, grading catalogue and prerequisite graph
+    // from a snapshot instead of querying for them on first use.
+    void warmFrom(const Snapshot& snapshot)
+    {
+        people.clear();
+        for (const auto& s : snapshot.members("s."))
+            people.add(PeopleIndex::StudentEntry, s.id, 0, s.first_name, s.last_name, s.email);
+        for (const auto& f : snapshot.members("f."))
+            people.add(PeopleIndex::FacultyEntry, f.email, std::stoi(f.id), f.first_name, f.last_name, f.email);
+        peopleLoaded = true;
+
+        std::vector<std::pair<std::string, std::string>> prereqs;
+        for (const auto& c : snapshot.courses())
+        {
+            grading.setCourse(c.code, {c.name, c.credits, c.semester});
+            prereqs.emplace_back(c.code, c.prerequisites);
+        }
+        for (const auto& cycle : prerequisites.rebuild(prereqs))
+            std::cerr << "Ignoring cyclic prerequisite: " << cycle << std::endl;
+        prerequisitesLoaded = true;
+    }
+
+    struct PlanProblem
+    {
+        std::string query, table, access;
+    };
+    // EXPLAINs every hot query with sample parameters and reports each table it
+    // reads with a full scan (access type ALL). Small reference tables a query
+    // legitimately lists in full are exempt per query.
+    std::vector<PlanProblem> checkQueryPlans()
+    {
+        TRACE_FUNCTION("db");
+        struct Check
+        {
+            const char* name;
+            std::string sql;
+            std::vector<mysqlx::Value> sample;
+            std::vector<std::string> scannable;
+        };
+        const std::vector<std::string> reference = {"timeslots", "classrooms"};
+        const std::vector<Check> checks = {
+            {"getAvailableScheduledCourses", SQL_AVAILABLE_SCHEDULED_COURSES, {2, "Computer Science"}, {}},
+            {"isAlreadyEnrolled", "SELECT COUNT(*) FROM enrollments WHERE student_id = ? AND schedule_id = ?", {"F2021-009", 1}, {}},
+            {"hasClash", SQL_HAS_CLASH, {"F2021-009", 1}, {}},
+            {"getMissingPrerequisites", SQL_COMPLETED_COURSES, {"F2021-009"}, {}},
+            {"addEnrollment", SQL_TAKE_SEAT, {1}, {}},
+            {"getEnrolledCourses", SQL_ENROLLED_COURSES, {"F2021-009"}, {}},
+            {"getFacultyCourses", SQL_FACULTY_COURSES, {1}, {}},
+            {"getEnrolledStudentsInCourse", SQL_ENROLLED_STUDENTS, {"CS202A"}, {}},
+            {"getFacultyTimetable", SQL_FACULTY_TIMETABLE, {1}, {}},
+            {"getAssignmentsForCourse", SQL_COURSE_ASSIGNMENTS, {"CS202A"}, {}},
+            {"getStudentMarksForAssignment", SQL_ASSIGNMENT_MARKS, {"CS202A", "Midterm"}, {}},
+            {"getCourseScores", SQL_COURSE_SCORES, {"CS202A"}, {}},
+            {"getDepartmentGradeStats", SQL_DEPARTMENT_SCORES, {"Computer Science"}, {}},
+            {"getTotalEnrolledStudents", SQL_COURSE_SEATS_TAKEN, {"CS202A"}, {}},
+            {"getUnscheduledCourses", SQL_UNSCHEDULED_COURSES, {}, {"courses"}},
+            {"getAvailableRooms", SQL_AVAILABLE_ROOMS, {1}, {}},
+            {"getAvailableFaculty", SQL_AVAILABLE_FACULTY, {1}, {"faculty"}},
+            {"getStudentMarks", std::string(SQL_STUDENT_MARKS) + " AND m.course_code = ? ORDER BY m.assignment_name", {"F2021-009", "CS202A"}, {}},
+            {"getStudentCourses", SQL_STUDENT_COURSES, {"F2021-009"}, {}},
+            {"getTranscript", SQL_STUDENT_MARK_ROWS, {"F2021-009", "F2021-009"}, {}},
+        };
+
+        std::vector<PlanProblem> problems;
+        for (const auto& check : checks)
+        {
+            mysqlx::SqlStatement stmt = session.sql("EXPLAIN " + check.sql);
+            for (const auto& v : check.sample)
+                stmt.bind(v);
+            auto res = stmt.execute();
+            int tableCol = -1, typeCol = -1;
+            const auto& cols = res.getColumns();
+            for (unsigned i = 0; i < res.getColumnCount(); ++i)
+            {
+                std::string label = cols[i].getColumnLabel();
+                if (label == "table") tableCol = i;
+                if (label == "type") typeCol = i;
+            }
+            if (tableCol < 0 || typeCol < 0)
+                continue;
+            mysqlx::Row row;
+            while ((row = res.fetchOne()))
+            {
+                if (row[tableCol].isNull() || row[typeCol].isNull())
+                    continue;
+                std::string table = row[tableCol].get<std::string>();
+                std::string access = row[typeCol].get<std::string>();
+                if (access != "ALL" || table.front() == '<')
+                    continue;
+                // EXPLAIN reports aliases; map the ones used in the queries above.
+                static const std::map<std::string, std::string> aliases = {
+                    {"cs", "course_schedule"}, {"c", "courses"}, {"f", "faculty"}, {"t", "timeslots"},
+                    {"cl", "classrooms"}, {"e", "enrollments"}, {"s", "students"}, {"m", "marks"}};
+                auto alias = aliases.find(table);
+                std::string base = alias == aliases.end() ? table : alias->second;
+                if (std::find(reference.begin(), reference.end(), base) != reference.end() ||
+                    std::find(check.scannable.begin(), check.scannable.end(), base) != check.scannable.end())
+                    continue;
+                problems.push_back({check.name, base, access});
+            }
+        }
+        return problems;
+    }
+
+    std::vector<std::pair<std::string, GradingEngine::Transcript>> getCohortTranscripts()
+    {
+        std::vector<std::pair<std::string, GradingEngine::Transcript>> result;
+        for (const auto& id : grading.studentIds())
+            result.emplace_back(id, grading.transcript(id));
+        std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        return result;
+    }
+};
+
+// Routes calls across several Database instances, one per shard, split by
+// department (courses.department, students.degree). Per-student, per-faculty
+// and per-course calls go to the owning shard. Reports fan out to every shard
+// in parallel and are merged here. The layout comes from Config/shards.conf.
+class ShardRouter
+{
+public:
+    struct ShardSpec
+    {
+        std::string name, endpoint, schema;
+    };
+    struct Layout
+    {
+        std::vector<ShardSpec> shards;
+        std::map<std::string, std::string> routes; // department or degree -> shard
+        std::string defaultShard;
+    };
+
+    //   shard <name> <host[:port]> [schema]
+    //   route <department or degree> <shard>   the key may contain spaces; the
+    //                                          last word is the shard
+    //   default <shard>              (the first shard if omitted)
+    static Layout readLayout(const std::string& path)
+    {
+        Layout layout;
+        std::ifstream in(path);
+        std::string line;
+        for (int lineNo = 1; std::getline(in, line); ++lineNo)
+        {
+            std::string text = line.substr(0, line.find('#'));
+            std::istringstream words(text);
+            std::string verb, a, b, c;
+            if (!(words >> verb))
+                continue;
+            if (verb == "route")
+            {
+                // "route Computer Science computing": everything between the
+                // verb and the last word is the key, optionally in quotes.
+                std::string rest = text.substr(text.find(verb) + verb.size());
+                size_t end = rest.find_last_not_of(" \t\r");
+                size_t split = end == std::string::npos ? end : rest.find_last_of(" \t", end);
+                size_t keyEnd = split == std::string::npos ? split : rest.find_last_not_of(" \t", split);
+                size_t keyBegin = rest.find_first_not_of(" \t");
+                if (keyEnd == std::string::npos || keyBegin > keyEnd)
+                    throw std::runtime_error(path + ":" + std::to_string(lineNo) + ": cannot parse \"" + line + "\"");
+                std::string key = rest.substr(keyBegin, keyEnd - keyBegin + 1);
+                if (key.size() >= 2 && key.front() == '"' && key.back() == '"')
+                    key = key.substr(1, key.size() - 2);
+                layout.routes[key] = rest.substr(split + 1, end - split);
+                continue;
+            }
+            words >> a >> b >> c;
+            if (verb == "shard" && !b.empty())
+                layout.shards.push_back({a, b, c.empty() ? "project_db" : c});
+            else if (verb == "default" && !a.empty())
+                layout.defaultShard = a;
+            else
+                throw std::runtime_error(path + ":" + std::to_string(lineNo) + ": cannot parse \"" + line + "\"");
+        }
+        return layout;
+    }
+
+    ShardRouter(const Layout& layout, const std::string& user, const std::string& pass)
+    {
+        if (layout.shards.empty())
+            throw std::runtime_error("Shard layout has no shards");
+        for (const auto& spec : layout.shards)
+        {
+            index[spec.name] = shards.size();
+            Shard shard{spec.name, std::unique_ptr<Database>(new Database(spec.endpoint, user, pass, spec.schema))};
+            shard.db->setArchiveDir("Archive/" + spec.name);
+            shards.push_back(std::move(shard));
+        }
+        fallback = layout.defaultShard.empty() ? 0 : shardIndex(layout.defaultShard);
+        for (const auto& r : layout.routes)
+            routes[r.first] = shardIndex(r.second);
+    }
+
+    size_t size() const
+    {
+        return shards.size();
+    }
+    const std::string& name(size_t i) const
+    {
+        return shards[i].name;
+    }
+    Database& shard(size_t i)
+    {
+        return *shards[i].db;
+    }
+    Database& defaultShard()
+    {
+        return *shards[fallback].db;
+    }
+    void setActor(const std::string& who)
+    {
+        for (auto& s : shards)
+            s.db->setActor(who);
+    }
+
+    // Unrouted departments live on the default shard. New students and
+    // courses are written here, by degree and department respectively.
+    Database& forDepartment(const std::string& department)
+    {
+        auto it = routes.find(department);
+        return *shards[it == routes.end() ? fallback : it->second].db;
+    }
+    // Where a student, faculty member or course lives is found by asking
+    // every shard once; the answer is cached, and a cached shard that no
+    // longer has the key (removed, possibly re-added elsewhere) is dropped
+    // and the shards asked again. Unknown keys fall back to the default
+    // shard, where the lookup then fails as it would unsharded.
+    Database& forStudent(const std::string& studentId)
+    {
+        return locate(studentHome, studentId, [&](Database& db) { return db.studentExists(studentId); });
+    }
+    Database& forFaculty(const std::string& email)
+    {
+        return locate(facultyHome, email, [&](Database& db) { return db.facultyExists(email); });
+    }
+    Database& forCourse(const std::string& code)
+    {
+        return locate(courseHome, code, [&](Database& db) { return db.courseExists(code); });
+    }
+    // Called after a removal so the next lookup is not sent to the old shard.
+    void forgetStudent(const std::string& studentId)
+    {
+        studentHome.erase(studentId);
+    }
+    void forgetCourse(const std::string& code)
+    {
+        courseHome.erase(code);
+    }
+
+    // Runs f on every shard at once, one thread each, and returns the results
+    // in shard order. Each Database is only touched by its own thread.
+    template <typename F>
+    auto scatter(F f) -> std::vector<decltype(f(std::declval<Database&>()))>
+    {
+        typedef decltype(f(std::declval<Database&>())) R;
+        std::vector<std::optional<R>> partial(shards.size());
+        std::vector<std::exception_ptr> errors(shards.size());
+        std::vector<std::thread> pool;
+        for (size_t i = 0; i < shards.size(); ++i)
+            pool.emplace_back([&, i] {
+                try {
+                    partial[i] = f(*shards[i].db);
+                }
+                catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            });
+        for (auto& t : pool)
+            t.join();
+        for (const auto& e : errors)
+            if (e)
+                std::rethrow_exception(e);
+        std::vector<R> results;
+        results.reserve(shards.size());
+        for (auto& p : partial)
+            results.push_back(std::move(*p));
+        return results;
+    }
+
+    std::vector<Database::TableCounts> getTableCounts()
+    {
+        return scatter([](Database& db) { return db.getTableCounts(); });
+    }
+    // Closest matches over all shards, tagged with the shard they came from.
+    std::vector<std::pair<std::string, PeopleIndex::Match>> searchPeople(const std::string& query, size_t limit = 10)
+    {
+        auto parts = scatter([&](Database& db) { return db.searchPeople(query, limit); });
+        std::vector<std::pair<std::string, PeopleIndex::Match>> merged;
+        for (size_t i = 0; i < parts.size(); ++i)
+            for (auto& m : parts[i])
+                merged.emplace_back(shards[i].name, std::move(m));
+        std::stable_sort(merged.begin(), merged.end(), [](const std::pair<std::string, PeopleIndex::Match>& a,
+                                                          const std::pair<std::string, PeopleIndex::Match>& b) {
+            return a.second.distance < b.second.distance;
+        });
+        if (merged.size() > limit)
+            merged.resize(limit);
+        return merged;
+    }
+    std::vector<std::pair<std::string, GradingEngine::Transcript>> getCohortTranscripts()
+    {
+        std::vector<std::pair<std::string, GradingEngine::Transcript>> merged;
+        for (auto& part : scatter([](Database& db) { return db.getCohortTranscripts(); }))
+            merged.insert(merged.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+        std::sort(merged.begin(), merged.end(), [](const std::pair<std::string, GradingEngine::Transcript>& a,
+                                                   const std::pair<std::string, GradingEngine::Transcript>& b) {
+            return a.first < b.first;
+        });
+        return merged;
+    }
+
+private:
+    struct Shard
+    {
+        std::string name;
+        std::unique_ptr<Database> db;
+    };
+    std::vector<Shard> shards;
+    std::unordered_map<std::string, size_t> index, routes;
+    std::unordered_map<std::string, size_t> studentHome, facultyHome, courseHome;
+    size_t fallback = 0;
+
+    size_t shardIndex(const std::string& shardName) const
+    {
+        auto it = index.find(shardName);
+        if (it == index.end())
+            throw std::runtime_error("Unknown shard " + shardName);
+        return it->second;
+    }
+    template <typename Has>
+    Database& locate(std::unordered_map<std::string, size_t>& cache, const std::string& key, Has has)
+    {
+        auto it = cache.find(key);
+        if (it != cache.end())
+        {
+            if (has(*shards[it->second].db))
+                return *shards[it->second].db;
+            cache.erase(it);
+        }
+        auto found = scatter(has);
+        for (size_t i = 0; i < found.size(); ++i)
+            if (found[i])
+            {
+                cache[key] = i;
+                return *shards[i].db;
+            }
+        return *shards[fallback].db;
+    }
+};
+
+inline void printGradeSummary(const GradeStats::Summary& s)
+{
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Students: " << s.count << "   Mean: " << s.mean << "%   Std dev: " << s.stddev << "\n";
+    std::cout << "Min: " << s.min << "   P10: " << s.p10 << "   P25: " << s.p25 << "   Median: " << s.median
+              << "   P75: " << s.p75 << "   P90: " << s.p90 << "   Max: " << s.max << "\n";
+    size_t peak = *std::max_element(s.histogram, s.histogram + GradeStats::BINS);
+    for (int b = GradeStats::BINS - 1; b >= 0; --b)
+    {
+        std::cout << std::right << std::setw(3) << b * 10 << "-" << std::left << std::setw(4) << (b == GradeStats::BINS - 1 ? 100 : b * 10 + 9)
+                  << std::string(peak ? s.histogram[b] * 40 / peak : 0, '#') << " " << s.histogram[b] << "\n";
+    }
+    std::cout << std::defaultfloat << std::right;
+}
+
+// Builds a whole table in one buffer and writes it with a single write(2),
+// rather than a setw and flush per cell. Column widths come from the data.
+// The same rows render as padded text for the terminal or as CSV/TSV for
+// exports.
+class TableRenderer
+{
+public:
+    enum Format { Text, Csv, Tsv };
+
+    explicit TableRenderer(std::vector<std::string> headers)
+        : headers(std::move(headers))
+    {}
+    void reserve(size_t rows)
+    {
+        cells.reserve(rows * headers.size());
+        colors.reserve(rows);
+    }
+    // `color` applies to the whole row in text mode.
+    void addRow(std::vector<std::string> row, const char* color = "")
+    {
+        row.resize(headers.size());
+        for (auto& cell : row)
+            cells.push_back(std::move(cell));
+        colors.push_back(color);
+    }
+    size_t size() const
+    {
+        return colors.size();
+    }
+    bool empty() const
+    {
+        return colors.empty();
+    }
+
+    static std::string number(double value, int precision)
+    {
+        char buf[32];
+        int n = std::snprintf(buf, sizeof buf, "%.*f", precision, value);
+        return std::string(buf, n > 0 ? n : 0);
+    }
+
+    // Rows [first, first + count) with the header. Text widths are computed
+    // over every row so that pages of the same table line up.
+    std::string render(Format format, size_t first = 0, size_t count = SIZE_MAX) const
+    {
+        size_t cols = headers.size();
+        size_t last = first + std::min(count, size() - std::min(first, size()));
+        std::string out;
+        if (format != Text)
+        {
+            char sep = format == Csv ? ',' : '\t';
+            size_t bytes = 0;
+            for (size_t i = first * cols; i < last * cols; ++i)
+                bytes += cells[i].size() + 3;
+            out.reserve(bytes + 64 * cols);
+            appendDelimited(out, headers.data(), cols, format, sep);
+            for (size_t r = first; r < last; ++r)
+                appendDelimited(out, &cells[r * cols], cols, format, sep);
+            return out;
+        }
+        std::vector<size_t> widths(cols);
+        for (size_t c = 0; c < cols; ++c)
+            widths[c] = displayWidth(headers[c]);
+        for (size_t i = 0; i < cells.size(); ++i)
+            widths[i % cols] = std::max(widths[i % cols], displayWidth(cells[i]));
+        size_t line = 0;
+        for (size_t w : widths)
+            line += w + GAP;
+        out.reserve((last - first + 1) * (line + sizeof(CYAN) + sizeof(RESET) + 1));
+        appendPadded(out, headers.data(), widths, CYAN);
+        for (size_t r = first; r < last; ++r)
+            appendPadded(out, &cells[r * cols], widths, colors[r]);
+        return out;
+    }
+    void print(size_t first = 0, size_t count = SIZE_MAX) const
+    {
+        std::cout.flush();
+        writeAll(STDOUT_FILENO, render(Text, first, count));
+    }
+    // Prints pageSize rows at a time, asking before each further page.
+    void page(size_t pageSize) const
+    {
+        for (size_t first = 0; first < size(); first += pageSize)
+        {
+            print(first, pageSize);
+            if (first + pageSize >= size())
+                break;
+            std::cout << "Rows " << first + 1 << "-" << first + pageSize << " of " << size() << ". n for next page, 0 to stop: ";
+            std::string input;
+            std::cin >> input;
+            if (input != "n")
+                break;
+        }
+    }
+    bool writeFile(const std::string& path, Format format) const
+    {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            return false;
+        bool ok = writeAll(fd, render(format));
+        return ::close(fd) == 0 && ok;
+    }
+
+private:
+    static const size_t GAP = 2;
+    std::vector<std::string> headers;
+    std::vector<std::string> cells; // row-major, headers.size() per row
+    std::vector<const char*> colors;
+
+    // Terminal columns taken by UTF-8 text, ignoring wide characters.
+    static size_t displayWidth(const std::string& s)
+    {
+        size_t n = 0;
+        for (unsigned char ch : s)
+            n += (ch & 0xC0) != 0x80;
+        return n;
+    }
+    static void appendPadded(std::string& out, const std::string* row, const std::vector<size_t>& widths, const char* color)
+    {
+        out += color;
+        for (size_t c = 0; c < widths.size(); ++c)
+        {
+            out += row[c];
+            if (c + 1 < widths.size())
+                out.append(widths[c] - displayWidth(row[c]) + GAP, ' ');
+        }
+        if (*color)
+            out += RESET;
+        out += '\n';
+    }
+    // CSV quotes fields holding a separator, quote or line break (RFC 4180);
+    // TSV has no quoting, so tabs and line breaks become spaces.
+    static void appendDelimited(std::string& out, const std::string* row, size_t cols, Format format, char sep)
+    {
+        for (size_t c = 0; c < cols; ++c)
+        {
+            if (c)
+                out += sep;
+            const std::string& cell = row[c];
+            if (format == Tsv)
+            {
+                for (char ch : cell)
+                    out += ch == '\t' || ch == '\n' || ch == '\r' ? ' ' : ch;
+            }
+            else if (cell.find_first_of(",\"\r\n") == std::string::npos)
+                out += cell;
+            else
+            {
+                out += '"';
+                for (char ch : cell)
+                {
+                    if (ch == '"')
+                        out += '"';
+                    out += ch;
+                }
+                out += '"';
+            }
+        }
+        out += '\n';
+    }
+    static bool writeAll(int fd, const std::string& data)
+    {
+        for (size_t done = 0; done < data.size();)
+        {
+            ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            done += n;
+        }
+        return true;
+    }
+};
+
+class Student : public Person
+{
+    Database& db;
+
+public:
+    Student(Database& db, const std::string& id, const std::string& name, const std::string& email)
+        : Person(id, name, email), db(db)
+    {}
+    void menu() override
+    {
+        int choice;
+        do
+        {
+            std::cout << CYAN << "\n--- Student Menu ---\n" << RESET;
+            std::cout << "1. Add Course\n";
+            std::cout << "2. Drop Course\n";
+            std::cout << "3. View Timetable\n";
+            std::cout << "4. View Teachers\n";
+            std::cout << "5. View Classroom Details\n";
+            std::cout << "6. Export Timetable\n";
             std::cout << "7. Change Password\n";
             std::cout << "8. View Marks\n";
+            std::cout << "9. View Transcript\n";
+            std::cout << "10. Schedule Builder\n";
             std::cout << "0. Logout\n";
             std::cout << "Choice: ";
             std::cin >> choice;
@@ -729,6 +6925,12 @@ public:
             case 8:
                 viewMarks();
                 break;
+            case 9:
+                viewTranscript();
+                break;
+            case 10:
+                buildSchedule();
+                break;
             case 0:
                 std::cout << "Logging out...\n";
                 break;
@@ -740,6 +6942,7 @@ public:
     std::string getRole() const override { return "Student"; }
     void addCourse()
     {
+        TRACE_FUNCTION("student");
         int sem = db.getStudentSemester(id);
         std::string deg = db.getStudentDegree(id);
         auto courses = db.getAvailableScheduledCourses(sem, deg);
@@ -768,18 +6971,113 @@ public:
             std::cout << "Already enrolled in this course.\n";
             return;
         }
+        for (const auto& e : db.getEnrolledCourses(id))
+            if (Database::courseFamily(e.course_code) == Database::courseFamily(sc.course_code))
+            {
+                std::cout << "Already enrolled in " << e.course_code << ", another section of this course.\n";
+                return;
+            }
         if (db.hasClash(id, sc.timeslot_id))
         {
             std::cout << "Course timeslot clashes with your existing courses.\n";
             return;
         }
+        auto missing = db.getMissingPrerequisites(id, sc.course_code);
+        if (!missing.empty())
+        {
+            std::cout << "Missing prerequisites:";
+            for (const auto& code : missing)
+                std::cout << " " << code;
+            std::cout << "\n";
+            return;
+        }
         if (db.addEnrollment(id, sc.schedule_id))
             std::cout << "Enrolled successfully.\n";
         else
             std::cout << "Course full or error occurred.\n";
     }
+    void buildSchedule()
+    {
+        TRACE_FUNCTION("student");
+        auto courses = db.getAvailableScheduledCourses(db.getStudentSemester(id), db.getStudentDegree(id));
+        std::vector<std::pair<std::string, std::string>> families; // family, course name
+        for (const auto& sc : courses)
+        {
+            std::string family = Database::courseFamily(sc.course_code);
+            if (std::find_if(families.begin(), families.end(), [&](const std::pair<std::string, std::string>& f) { return f.first == family; }) == families.end())
+                families.emplace_back(family, sc.course_name);
+        }
+        if (families.empty())
+        {
+            std::cout << "No scheduled courses for your degree/semester.\n";
+            return;
+        }
+        std::cout << "Courses offered:\n";
+        for (size_t i = 0; i < families.size(); ++i)
+            std::cout << i + 1 << ". " << families[i].first << " - " << families[i].second << std::endl;
+        std::cout << "Enter the numbers of the courses you want, separated by spaces: ";
+        std::string line;
+        std::cin >> std::ws;
+        std::getline(std::cin, line);
+        std::istringstream in(line);
+        std::vector<std::string> wanted;
+        int n;
+        while (in >> n)
+            if (n >= 1 && n <= (int)families.size())
+                wanted.push_back(families[n - 1].first);
+        if (wanted.empty())
+        {
+            std::cout << "No courses selected.\n";
+            return;
+        }
+
+        uint64_t complete = 0;
+        std::vector<std::string> unavailable;
+        std::vector<Database::SchedulePlan> plans;
+        try {
+            plans = db.planSchedules(id, wanted, 5, complete, unavailable);
+        }
+        catch (const std::runtime_error& ex) {
+            std::cout << "Cannot build a schedule: " << ex.what() << "\n";
+            return;
+        }
+        for (const auto& family : unavailable)
+            std::cout << YELLOW << family << ": already taken, full, or prerequisites missing - left out.\n" << RESET;
+        if (plans.empty())
+        {
+            std::cout << "No clash-free combination of the remaining courses exists.\n";
+            return;
+        }
+        std::cout << complete << " clash-free combination(s) checked; best " << plans.size() << ":\n";
+        for (size_t p = 0; p < plans.size(); ++p)
+        {
+            std::cout << CYAN << "\nOption " << p + 1 << ": " << plans[p].days << " day(s) on campus, "
+                      << plans[p].gapMinutes << " min of gaps, at least " << plans[p].minSeats << " seat(s) left\n" << RESET;
+            for (const auto& sc : plans[p].sections)
+                std::cout << "  " << std::left << std::setw(10) << sc.course_code << std::setw(11) << sc.day
+                          << sc.start_time << "-" << sc.end_time << " | " << sc.room_number << " " << sc.building << std::right << "\n";
+        }
+        std::cout << "Enroll in option (0 to cancel): ";
+        int choice;
+        std::cin >> choice;
+        if (choice < 1 || choice > (int)plans.size())
+            return;
+        std::string full;
+        try {
+            full = db.enrollSchedule(id, plans[choice - 1].sections);
+        }
+        catch (const std::runtime_error& ex) {
+            std::cout << ex.what() << "; nothing was changed.\n";
+            return;
+        }
+        if (full.empty())
+            std::cout << "Enrolled in " << plans[choice - 1].sections.size() << " course(s).\n";
+        else
+            std::cout << full << " filled up in the meantime; nothing was changed.\n";
+    }
     void dropCourse()
     {
+        TRACE_FUNCTION("student");
         auto enrolled = db.getEnrolledCourses(id);
         if (enrolled.empty())
         {
@@ -805,25 +7103,26 @@ public:
     }
     void viewTimetable()
     {
+        TRACE_FUNCTION("student");
         auto tt = db.getStudentTimetable(id);
         if (tt.empty())
         {
             std::cout << "No enrolled courses.\n";
             return;
         }
-        std::cout << CYAN << std::left << std::setw(10) << "Course" << std::setw(50) << "Name" << std::setw(15) << "Day"
-            << std::setw(12) << "Start" << std::setw(12) << "End" << std::setw(10) << "Room"
-            << std::setw(10) << "Bldg" << std::setw(20) << "Teacher" << RESET << std::endl;
-        for (size_t i = 0; i < tt.size(); ++i)
-        {
-            const auto& t = tt[i];
-            std::cout << std::setw(10) << t.course_code << std::setw(50) << t.course_name << std::setw(15) << t.day
-                << std::setw(12) << t.start_time << std::setw(12) << t.end_time << std::setw(10) << t.room_number
-                << std::setw(10) << t.building << std::setw(20) << t.faculty_name << std::endl;
-        }
+        timetableTable(tt).print();
+    }
+    static TableRenderer timetableTable(const std::vector<Database::TimetableEntry>& tt)
+    {
+        TableRenderer table({"Course", "Name", "Day", "Start", "End", "Room", "Bldg", "Teacher"});
+        table.reserve(tt.size());
+        for (const auto& t : tt)
+            table.addRow({t.course_code, t.course_name, t.day, t.start_time, t.end_time, t.room_number, t.building, t.faculty_name});
+        return table;
     }
     void viewTeachers()
     {
+        TRACE_FUNCTION("student");
         auto tt = db.getStudentTimetable(id);
         std::cout << "Your Teachers:\n";
         for (size_t i = 0; i < tt.size(); ++i)
@@ -845,6 +7144,7 @@ public:
     }
     void viewClassroomDetails()
     {
+        TRACE_FUNCTION("student");
         auto tt = db.getStudentTimetable(id);
         std::cout << "Your Classrooms:\n";
         for (size_t i = 0; i < tt.size(); ++i)
@@ -866,20 +7166,16 @@ public:
     }
     void exportTimetable()
     {
-        auto tt = db.getStudentTimetable(id);
-        std::ofstream out(id + "_timetable.csv");
-        out << "Course,Name,Day,Start,End,Room,Bldg,Teacher\n";
-        for (size_t i = 0; i < tt.size(); ++i)
-        {
-            const auto& t = tt[i];
-            out << t.course_code << "," << t.course_name << "," << t.day << "," << t.start_time << ","
-                << t.end_time << "," << t.room_number << "," << t.building << "," << t.faculty_name << "\n";
-        }
-        out.close();
-        std::cout << "Timetable exported to " << id << "_timetable.csv\n";
+        TRACE_FUNCTION("student");
+        std::string path = id + "_timetable.csv";
+        if (timetableTable(db.getStudentTimetable(id)).writeFile(path, TableRenderer::Csv))
+            std::cout << "Timetable exported to " << path << "\n";
+        else
+            std::cout << "Could not write " << path << "\n";
     }
     void changePassword()
     {
+        TRACE_FUNCTION("student");
         std::string oldPwd, newPwd;
         std::cout << "Enter current password: ";
         std::cin >> oldPwd;
@@ -897,6 +7193,7 @@ public:
     }
     void viewMarks()
     {
+    TRACE_FUNCTION("student");
     auto courses = db.getStudentCourses(id);
     if (courses.empty())
     {
@@ -935,44 +7232,51 @@ public:
     }
 
     std::cout << "\n" << CYAN << "Your Marks:" << RESET << "\n";
-    std::cout << CYAN << std::left << std::setw(25) << "Assignment"
-              << std::setw(15) << "Marks"
-              << std::setw(12) << "Percentage\n";
-    std::cout << std::string(50, '-') << RESET << "\n";
-
+    TableRenderer table({"Assignment", "Marks", "Percentage"});
+    table.reserve(marks.size());
     for (const auto& mark : marks)
     {
         double percentage = (static_cast<double>(mark.obtained_marks) / mark.total_marks) * 100;
-
-        // Apply color based on percentage BEFORE printing
-        std::string color = RESET;
-        if (percentage >= 80) {
-            color = GREEN;
-        } else if (percentage >= 50) {
-            color = YELLOW;
-        } else if (percentage < 50) {
-            color = RED;
-        }
-
-        // Create the marks string
-        std::string marks_str = std::to_string(mark.obtained_marks) + "/" + std::to_string(mark.total_marks);
-
-        // Print the entire line with color
-        std::ostringstream percStream;
-        percStream << std::fixed << std::setprecision(2) << static_cast<float>(percentage);
-
-        std::cout << color << std::left << std::setw(25) << mark.assignment_name
-                  << std::setw(15) << marks_str
-                  << std::setw(12) << (percStream.str() + "%") << RESET << "\n";
-
+        const char* color = percentage >= 80 ? GREEN : percentage >= 50 ? YELLOW : RED;
+        table.addRow({mark.assignment_name,
+                      std::to_string(mark.obtained_marks) + "/" + std::to_string(mark.total_marks),
+                      TableRenderer::number(percentage, 2) + "%"}, color);
     }
+    table.print();
     std::cout << "\n";
     }
+    void viewTranscript()
+    {
+        TRACE_FUNCTION("student");
+        auto t = db.getTranscript(id);
+        if (t.courses.empty())
+        {
+            std::cout << "No graded courses yet.\n";
+            return;
+        }
+        for (size_t i = 0; i < t.courses.size();)
+        {
+            int semester = t.courses[i].semester;
+            TableRenderer table({"Course", "Name", "Credits", "Percent", "Grade"});
+            for (; i < t.courses.size() && t.courses[i].semester == semester; ++i)
+            {
+                const auto& c = t.courses[i];
+                table.addRow({c.course_code, c.course_name, std::to_string(c.credits), TableRenderer::number(c.percentage(), 2),
+                              c.grade().letter});
+            }
+            std::cout << "\n" << CYAN << "Semester " << semester << RESET << "\n";
+            table.print();
+            std::cout << "Semester GPA: " << std::fixed << std::setprecision(2) << t.semester_gpa[semester] << "\n";
+        }
+        std::cout << "\n" << GREEN << "CGPA: " << std::fixed << std::setprecision(2) << t.cgpa
+                  << " (" << t.credits << " credits)" << RESET << "\n";
+    }
 };
 
 class Faculty : public Person
 {
     Database& db;
+    static const size_t ROSTER_PAGE = 50;
 
 public:
     Faculty(Database& db, const std::string& id, const std::string& name, const std::string& email)
@@ -990,6 +7294,7 @@ public:
             std::cout << "4. Manage Marks\n";
             std::cout << "5. View Total Enrolled Students\n";
             std::cout << "6. Change Password\n";
+            std::cout << "7. Grade Statistics\n";
             std::cout << "0. Logout\n";
             std::cout << "Choice: ";
             std::cin >> choice;
@@ -1013,6 +7318,9 @@ public:
             case 6:
                 changePassword();
                 break;
+            case 7:
+                viewGradeStatistics();
+                break;
             case 0:
                 std::cout << "Logging out...\n";
                 break;
@@ -1025,6 +7333,7 @@ public:
 
     void viewEnrolledStudents()
     {
+        TRACE_FUNCTION("faculty");
         auto courses = db.getFacultyCourses(std::stoi(id));
         if (courses.empty())
         {
@@ -1062,58 +7371,53 @@ public:
             return a.first_name < b.first_name; // Sort by first name
         });
 
-        std::cout << CYAN << std::left << std::setw(12) << "Student ID" << std::setw(20) << "First Name"
-                  << std::setw(20) << "Last Name" << std::setw(25) << "Email" << std::setw(8) << "Sem"
-                  << std::setw(15) << "Degree" << RESET << std::endl;
-
+        TableRenderer table({"Student ID", "First Name", "Last Name", "Email", "Sem", "Degree"});
+        table.reserve(students.size());
         for (const auto& student : students)
-        {
-            std::cout << std::setw(12) << student.student_id << std::setw(20) << student.first_name
-                      << std::setw(20) << student.last_name << std::setw(25) << student.email
-                      << std::setw(8) << student.semester << std::setw(15) << student.degree << std::endl;
-        }
+            table.addRow({student.student_id, student.first_name, student.last_name, student.email,
+                          std::to_string(student.semester), student.degree});
+        table.page(ROSTER_PAGE);
     }
 
     void viewTimetable()
     {
+        TRACE_FUNCTION("faculty");
         auto tt = db.getFacultyTimetable(std::stoi(id));
         if (tt.empty())
         {
             std::cout << "No classes scheduled.\n";
             return;
         }
-        std::cout << CYAN << std::left << std::setw(10) << "Course" << std::setw(50) << "Name" << std::setw(15) << "Day"
-            << std::setw(12) << "Start" << std::setw(12) << "End" << std::setw(10) << "Room"
-            << std::setw(10) << "Bldg" << RESET << std::endl;
+        timetableTable(tt).print();
+    }
+    static TableRenderer timetableTable(const std::vector<Database::ScheduledCourse>& tt)
+    {
+        TableRenderer table({"Course", "Name", "Day", "Start", "End", "Room", "Bldg"});
+        table.reserve(tt.size());
         for (const auto& t : tt)
-        {
-            std::cout << std::setw(10) << t.course_code << std::setw(50) << t.course_name << std::setw(15) << t.day
-                << std::setw(12) << t.start_time << std::setw(12) << t.end_time << std::setw(10) << t.room_number
-                << std::setw(10) << t.building << std::endl;
-        }
+            table.addRow({t.course_code, t.course_name, t.day, t.start_time, t.end_time, t.room_number, t.building});
+        return table;
     }
 
     void exportTimetable()
     {
+        TRACE_FUNCTION("faculty");
         auto tt = db.getFacultyTimetable(std::stoi(id));
         if (tt.empty())
         {
             std::cout << "No classes to export.\n";
             return;
         }
-        std::ofstream out("faculty_" + id + "_timetable.csv");
-        out << "Course,Name,Day,Start,End,Room,Bldg\n";
-        for (const auto& t : tt)
-        {
-            out << t.course_code << "," << t.course_name << "," << t.day << "," << t.start_time << ","
-                << t.end_time << "," << t.room_number << "," << t.building << "\n";
-        }
-        out.close();
-        std::cout << "Timetable exported to faculty_" << id << "_timetable.csv\n";
+        std::string path = "faculty_" + id + "_timetable.csv";
+        if (timetableTable(tt).writeFile(path, TableRenderer::Csv))
+            std::cout << "Timetable exported to " << path << "\n";
+        else
+            std::cout << "Could not write " << path << "\n";
     }
 
     void changePassword()
     {
+        TRACE_FUNCTION("faculty");
         std::string oldPwd, newPwd;
         std::cout << "Enter current password: ";
         std::cin >> oldPwd;
@@ -1131,6 +7435,7 @@ public:
     }
 
     void manageMarks() {
+        TRACE_FUNCTION("faculty");
         while (true) {
             std::cout << CYAN << "\n--- Marks Management ---\n" << RESET;
             std::cout << "1. Add Marks for Students\n";
@@ -1159,6 +7464,7 @@ public:
     }
 
     void addMarks() {
+        TRACE_FUNCTION("faculty");
         auto courses = db.getFacultyCourses(std::stoi(id));
         if (courses.empty()) {
             std::cout << "You are not assigned to any courses.\n";
@@ -1210,7 +7516,7 @@ public:
         for (const auto& student : students) {
             bool has_marks = false;
             for (const auto& mark : existing_marks) {
-                if (mark.first == student.student_id) {
+                if (mark.student_id == student.student_id) {
                     has_marks = true;
                     break;
                 }
@@ -1262,6 +7568,7 @@ public:
     }
 
     void editMarks() {
+        TRACE_FUNCTION("faculty");
         auto courses = db.getFacultyCourses(std::stoi(id));
         if (courses.empty()) {
             std::cout << "You are not assigned to any courses.\n";
@@ -1330,11 +7637,11 @@ public:
 
             for (size_t i = 0; i < marks.size(); ++i) {
                 const auto& mark = marks[i];
-                auto student_info = student_names[mark.first];
+                auto student_info = student_names[mark.student_id];
                 std::cout << std::setw(5) << i + 1
-                          << std::setw(15) << mark.first
+                          << std::setw(15) << mark.student_id
                           << std::setw(25) << (student_info.first + " " + student_info.second)
-                          << std::setw(15) << (std::to_string(mark.second.second) + "/" + std::to_string(mark.second.first))
+                          << std::setw(15) << (std::to_string(mark.obtained_marks) + "/" + std::to_string(mark.total_marks))
                           << "\n";
             }
 
@@ -1352,20 +7659,20 @@ public:
             }
 
             const auto& selected_mark = marks[student_choice - 1];
-            auto student_info = student_names[selected_mark.first];
+            auto student_info = student_names[selected_mark.student_id];
             int new_marks;
 
             std::cout << "Current marks for " << student_info.first << " " << student_info.second
-                      << ": " << selected_mark.second.second << "/" << selected_mark.second.first << "\n";
+                      << ": " << selected_mark.obtained_marks << "/" << selected_mark.total_marks << "\n";
             std::cout << "Enter new obtained marks: ";
             std::cin >> new_marks;
 
-            if (new_marks < 0 || new_marks > selected_mark.second.first) {
-                std::cout << "Marks must be between 0 and " << selected_mark.second.first << "\n";
+            if (new_marks < 0 || new_marks > selected_mark.total_marks) {
+                std::cout << "Marks must be between 0 and " << selected_mark.total_marks << "\n";
                 continue;
             }
 
-            db.updateMarks(course_code, selected_mark.first, assignment_name, new_marks);
+            db.updateMarks(course_code, selected_mark.student_id, assignment_name, new_marks);
             std::cout << "Marks updated successfully.\n";
 
             // Refresh the marks list
@@ -1375,6 +7682,7 @@ public:
 
     void viewTotalEnrolledStudents()
     {
+        TRACE_FUNCTION("faculty");
         auto courses = db.getFacultyCourses(std::stoi(id));
         if (courses.empty())
         {
@@ -1397,15 +7705,82 @@ public:
                       << std::setw(15) << total_students << std::endl;
         }
     }
+
+    void viewGradeStatistics()
+    {
+        TRACE_FUNCTION("faculty");
+        auto courses = db.getFacultyCourses(std::stoi(id));
+        if (courses.empty())
+        {
+            std::cout << "You are not assigned to any courses.\n";
+            return;
+        }
+        std::cout << "\nYour courses:\n";
+        for (size_t i = 0; i < courses.size(); ++i)
+            std::cout << i + 1 << ". " << courses[i] << std::endl;
+        std::cout << "Select course: ";
+        int course_choice;
+        std::cin >> course_choice;
+        if (course_choice < 1 || course_choice > (int)courses.size())
+        {
+            std::cout << "Invalid choice.\n";
+            return;
+        }
+        std::string course_code = courses[course_choice - 1].substr(0, courses[course_choice - 1].find(" - "));
+
+        auto assignments = db.getAssignmentsForCourse(course_code);
+        std::cout << "0. Whole course\n";
+        for (size_t i = 0; i < assignments.size(); ++i)
+            std::cout << i + 1 << ". " << assignments[i] << std::endl;
+        std::cout << "Select assignment: ";
+        int assignment_choice;
+        std::cin >> assignment_choice;
+        if (assignment_choice < 0 || assignment_choice > (int)assignments.size())
+        {
+            std::cout << "Invalid choice.\n";
+            return;
+        }
+        std::string assignment = assignment_choice ? assignments[assignment_choice - 1] : "";
+
+        auto scores = db.getScores(course_code, assignment);
+        if (scores.empty())
+        {
+            std::cout << "No marks recorded yet.\n";
+            return;
+        }
+        std::vector<double> values;
+        for (const auto& sc : scores)
+            values.push_back(sc.second);
+        auto stats = GradeStats::compute(values);
+
+        std::cout << CYAN << "\n" << course_code << " - " << (assignment.empty() ? "whole course" : assignment) << "\n" << RESET;
+        printGradeSummary(stats);
+
+        std::vector<size_t> order(scores.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return values[a] > values[b]; });
+        std::cout << CYAN << std::left << std::setw(6) << "Rank" << std::setw(15) << "Student ID" << std::setw(10) << "Score%"
+                  << std::setw(8) << "z" << RESET << "\n";
+        std::cout << std::fixed << std::setprecision(2);
+        for (size_t r = 0; r < order.size(); ++r)
+        {
+            size_t i = order[r];
+            std::cout << std::setw(6) << r + 1 << std::setw(15) << scores[i].first << std::setw(10) << values[i]
+                      << std::setw(8) << stats.z[i] << (stats.outlier[i] ? RED " outlier" RESET : "") << "\n";
+        }
+        std::cout << std::defaultfloat << std::right;
+    }
 };
 
 class Admin : public Person
 {
     Database& db;
+    ShardRouter* shards; // null unless Config/shards.conf lists shards
 
 public:
-    Admin(Database& db, const std::string& id, const std::string& name, const std::string& email)
-        : Person(id, name, email), db(db)
+    Admin(Database& db, const std::string& id, const std::string& name, const std::string& email, ShardRouter* shards = nullptr)
+        : Person(id, name, email), db(db), shards(shards)
     {}
     void menu() override
     {
@@ -1427,6 +7802,23 @@ public:
             std::cout << "12. Remove Course Assignment\n";
             std::cout << "13. Reset Student Password\n";
             std::cout << "14. Reset Faculty Password\n";
+            std::cout << "15. Recompute Cohort GPAs\n";
+            std::cout << "16. Reconcile Seat Counters\n";
+            std::cout << "17. End-of-Semester Rollover\n";
+            std::cout << "18. Term Archive\n";
+            std::cout << "19. Audit Trail\n";
+            std::cout << "20. Search People\n";
+            std::cout << "21. Utilisation Report\n";
+            std::cout << "22. Generate Exam Timetable\n";
+            std::cout << "23. Balance Sections\n";
+            std::cout << "24. Department Grade Statistics\n";
+            std::cout << "25. Write Snapshot\n";
+            std::cout << "26. Replica Status\n";
+            std::cout << "27. Transaction Statistics\n";
+            std::cout << "28. Shard Overview\n";
+            std::cout << "29. Cohort Cache Statistics\n";
+            std::cout << "30. Seat Reservation Statistics\n";
+            std::cout << "31. Tracing\n";
             std::cout << "0. Logout\n";
             std::cout << "Choice: ";
             std::cin >> choice;
@@ -1474,6 +7866,57 @@ public:
             case 14:
                 resetFacultyPassword();
                 break;
+            case 15:
+                recomputeCohortGpas();
+                break;
+            case 16:
+                reconcileSeatCounters();
+                break;
+            case 17:
+                semesterRollover();
+                break;
+            case 18:
+                termArchive();
+                break;
+            case 19:
+                viewAuditTrail();
+                break;
+            case 20:
+                searchPeople();
+                break;
+            case 21:
+                utilisationReport();
+                break;
+            case 22:
+                generateExamTimetable();
+                break;
+            case 23:
+                balanceSections();
+                break;
+            case 24:
+                departmentGradeStatistics();
+                break;
+            case 25:
+                writeSnapshot();
+                break;
+            case 26:
+                replicaStatus();
+                break;
+            case 27:
+                transactionStatistics();
+                break;
+            case 28:
+                shardOverview();
+                break;
+            case 29:
+                cohortCacheStatistics();
+                break;
+            case 30:
+                seatReservationStatistics();
+                break;
+            case 31:
+                tracing();
+                break;
             case 0:
                 std::cout << "Logging out...\n";
                 break;
@@ -1483,8 +7926,18 @@ public:
         } while (choice != 0);
     }
     std::string getRole() const override { return "Admin"; }
+    // Seat-changing admin work waits until fast registration is over; its
+    // in-memory counters would not see it.
+    bool blockedByFastRegistration(const std::string& what)
+    {
+        if (!db.fastRegistration())
+            return false;
+        std::cout << what << " is not allowed while fast registration is on.\n";
+        return true;
+    }
     void addStudent()
     {
+        TRACE_FUNCTION("admin");
         std::string id, fname, lname, email, degree;
         int semester;
         std::cout << "Student ID: ";
@@ -1501,19 +7954,88 @@ public:
         std::getline(std::cin, degree);
         std::cout << "Semester: ";
         std::cin >> semester;
-        db.addStudent(id, fname, lname, email, degree, semester); // Will set password to "bnu"
+        Database& home = shards ? shards->forDepartment(degree) : db;
+        home.addStudent(id, fname, lname, email, degree, semester); // Will set password to "bnu"
         std::cout << "Student added (default password 'bnu').\n";
     }
+    // Reads an id, name or email and resolves it through the search index,
+    // asking the admin to choose when the query is not an exact key.
+    bool pickPerson(PeopleIndex::Kind kind, const std::string& prompt, PeopleIndex::Entry& picked)
+    {
+        std::string query;
+        std::cout << prompt;
+        std::cin >> std::ws;
+        std::getline(std::cin, query);
+        auto matches = db.searchPeople(query, 10, kind);
+        if (matches.empty())
+        {
+            std::cout << "No match for '" << query << "'.\n";
+            return false;
+        }
+        for (const auto& m : matches)
+        {
+            std::string key = m.entry.key;
+            if (m.distance == 0 && std::equal(key.begin(), key.end(), query.begin(), query.end(),
+                    [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); }))
+            {
+                picked = m.entry;
+                return true;
+            }
+        }
+        printMatches(matches);
+        int idx;
+        std::cout << "Choose (0 to cancel): ";
+        std::cin >> idx;
+        if (idx < 1 || idx > static_cast<int>(matches.size()))
+            return false;
+        picked = matches[idx - 1].entry;
+        return true;
+    }
+    void printMatches(const std::vector<PeopleIndex::Match>& matches)
+    {
+        std::cout << std::left << std::setw(4) << "#" << std::setw(9) << "Type" << std::setw(28) << "ID/Email"
+                  << std::setw(24) << "Name" << "Email\n";
+        for (size_t i = 0; i < matches.size(); ++i)
+        {
+            const auto& e = matches[i].entry;
+            std::cout << std::left << std::setw(4) << i + 1 << std::setw(9) << (e.kind == PeopleIndex::StudentEntry ? "Student" : "Faculty")
+                      << std::setw(28) << (e.kind == PeopleIndex::StudentEntry ? e.key : std::to_string(e.faculty_id))
+                      << std::setw(24) << e.name << e.email
+                      << (matches[i].distance ? "  (~" + std::to_string(matches[i].distance) + ")" : "") << "\n";
+        }
+    }
+    void searchPeople()
+    {
+        TRACE_FUNCTION("admin");
+        std::string query;
+        std::cout << "Search (id, name or email): ";
+        std::cin >> std::ws;
+        std::getline(std::cin, query);
+        auto start = std::chrono::steady_clock::now();
+        auto matches = db.searchPeople(query, 20);
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        if (matches.empty())
+            std::cout << "No matches.\n";
+        else
+            printMatches(matches);
+        std::cout << matches.size() << " result(s) in " << micros << " us.\n";
+    }
     void removeStudent()
     {
-        std::string id;
-        std::cout << "Student ID to remove: ";
-        std::cin >> id;
-        db.removeStudent(id);
-        std::cout << "Student removed.\n";
+        TRACE_FUNCTION("admin");
+        if (blockedByFastRegistration("Removing a student"))
+            return;
+        PeopleIndex::Entry student;
+        if (!pickPerson(PeopleIndex::StudentEntry, "Student to remove (ID, name or email): ", student))
+            return;
+        (shards ? shards->forStudent(student.key) : db).removeStudent(student.key);
+        if (shards)
+            shards->forgetStudent(student.key);
+        std::cout << "Student " << student.key << " (" << student.name << ") removed.\n";
     }
     void addFaculty()
     {
+        TRACE_FUNCTION("admin");
         int faculty_id;
         std::string fname, lname, email, degree, qualification, expertise_sub, designation;
         std::cout << "Faculty ID: ";
@@ -1540,213 +8062,1356 @@ public:
     }
     void removeFaculty()
     {
+        TRACE_FUNCTION("admin");
         int id;
         std::cout << "Faculty ID to remove: ";
         std::cin >> id;
         db.removeFaculty(id);
         std::cout << "Faculty removed.\n";
     }
-    void addCourse()
+    void addCourse()
+    {
+        TRACE_FUNCTION("admin");
+        std::string code, name, dept, prereq;
+        int sem, max, credits;
+        std::cout << "Course code: ";
+        std::cin >> code;
+        std::cin.ignore();
+        std::cout << "Course name: ";
+        std::getline(std::cin, name);
+        std::cout << "Credits: ";
+        std::cin >> credits;
+        std::cout << "Semester: ";
+        std::cin >> sem;
+        std::cin.ignore();
+        std::cout << "Department: ";
+        std::getline(std::cin, dept);
+        std::cout << "Max students: ";
+        std::cin >> max;
+        std::cin.ignore();
+        std::cout << "Prerequisites: ";
+        std::getline(std::cin, prereq);
+        Database& home = shards ? shards->forDepartment(dept) : db;
+        std::string cycle = home.findPrerequisiteCycle(code, prereq);
+        if (!cycle.empty())
+        {
+            std::cout << "Prerequisites would form a cycle: " << cycle << "\n";
+            return;
+        }
+        home.addCourse(code, name, credits, sem, dept, max, prereq);
+        std::cout << "Course added.\n";
+    }
+    void removeCourse()
+    {
+        TRACE_FUNCTION("admin");
+        if (blockedByFastRegistration("Removing a course"))
+            return;
+        std::string code;
+        std::cout << "Course code to remove: ";
+        std::cin >> code;
+        (shards ? shards->forCourse(code) : db).removeCourse(code);
+        if (shards)
+            shards->forgetCourse(code);
+        std::cout << "Course removed.\n";
+    }
+    void addClassroom()
+    {
+        TRACE_FUNCTION("admin");
+        std::string id, number, building, room_type;
+        int capacity;
+        std::cout << "Room ID: ";
+        std::cin >> id;
+        std::cout << "Room number: ";
+        std::cin >> number;
+        std::cout << "Building: ";
+        std::cin >> building;
+        std::cout << "Capacity: ";
+        std::cin >> capacity;
+        std::cout << "Room type: ";
+        std::cin >> room_type;
+        db.addClassroom(id, building, number, capacity, room_type);
+        std::cout << "Classroom added.\n";
+    }
+    void removeClassroom()
+    {
+        TRACE_FUNCTION("admin");
+        std::string id;
+        std::cout << "Room ID to remove: ";
+        std::cin >> id;
+        db.removeClassroom(id);
+        std::cout << "Classroom removed.\n";
+    }
+    void addTimeslot()
+    {
+        TRACE_FUNCTION("admin");
+        std::string day, start, end;
+        std::cout << "Day of week: ";
+        std::cin >> day;
+        std::cout << "Start time (HH:MM:SS): ";
+        std::cin >> start;
+        std::cout << "End time (HH:MM:SS): ";
+        std::cin >> end;
+        db.addTimeslot(day, start, end);
+        std::cout << "Timeslot added.\n";
+    }
+    void removeTimeslot()
+    {
+        TRACE_FUNCTION("admin");
+        int id;
+        std::cout << "Timeslot ID to remove: ";
+        std::cin >> id;
+        db.removeTimeslot(id);
+        std::cout << "Timeslot removed.\n";
+    }
+    static const size_t PAGE_SIZE = 20;
+
+    // Asks for optional listing filters; a blank answer means "any".
+    Database::ListFilter readFilter(bool department, bool day, bool building)
+    {
+        Database::ListFilter filter;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        if (department)
+        {
+            std::cout << "Department (blank for any): ";
+            std::getline(std::cin, filter.department);
+        }
+        if (day)
+        {
+            std::cout << "Day (blank for any): ";
+            std::getline(std::cin, filter.day);
+        }
+        if (building)
+        {
+            std::cout << "Building (blank for any): ";
+            std::getline(std::cin, filter.building);
+        }
+        return filter;
+    }
+    // Shows a keyset-paginated listing one page at a time and lets the admin
+    // move forward/back or pick a row. Returns false if nothing was picked.
+    template <typename T, typename Key, typename Fetch, typename Print>
+    bool pickFromPages(const std::string& what, std::vector<std::string> headers, Fetch fetch, Print cells, T& picked)
+    {
+        std::vector<Key> starts = {Key{}};
+        for (;;)
+        {
+            auto page = fetch(starts.back());
+            if (page.rows.empty() && starts.size() == 1)
+            {
+                std::cout << "No " << what << ".\n";
+                return false;
+            }
+            std::cout << CYAN << "\n" << what << " (page " << starts.size() << ")\n" << RESET;
+            TableRenderer table(headers);
+            table.reserve(page.rows.size());
+            for (size_t i = 0; i < page.rows.size(); ++i)
+            {
+                std::vector<std::string> row = cells(page.rows[i]);
+                row.insert(row.begin(), std::to_string(i + 1));
+                table.addRow(std::move(row));
+            }
+            table.print();
+            std::cout << "Number to select" << (page.more ? ", n for next" : "") << (starts.size() > 1 ? ", p for previous" : "")
+                      << ", 0 to cancel: ";
+            std::string input;
+            std::cin >> input;
+            if (input == "n" && page.more)
+                starts.push_back(page.next);
+            else if (input == "p" && starts.size() > 1)
+                starts.pop_back();
+            else
+            {
+                int idx = std::atoi(input.c_str());
+                if (idx == 0)
+                    return false;
+                if (idx >= 1 && idx <= static_cast<int>(page.rows.size()))
+                {
+                    picked = page.rows[idx - 1];
+                    return true;
+                }
+                std::cout << "Invalid selection.\n";
+            }
+        }
+    }
+    void assignCourseSchedule()
+    {
+        TRACE_FUNCTION("admin");
+        typedef std::pair<std::string, std::string> Option;
+        Database::ListFilter filter = readFilter(true, false, false);
+        Option course;
+        if (!pickFromPages<Option, std::string>("unassigned courses", {"#", "Course", "Name"},
+                [&](const std::string& after) { return db.getUnscheduledCoursesPage(after, PAGE_SIZE, filter); },
+                [](const Option& o) { return std::vector<std::string>{o.first, o.second}; }, course))
+            return;
+        auto timeslots = db.getAllTimeslots();
+        int f, t;
+        std::cout << "Timeslots:\n";
+        for (size_t i = 0; i < timeslots.size(); ++i)
+            std::cout << i + 1 << ". " << timeslots[i].second << std::endl;
+        std::cout << "Select timeslot: ";
+        std::cin >> t;
+        if (t < 1 || t >(int)timeslots.size())
+        {
+            std::cout << "Invalid selection.\n";
+            return;
+        }
+        auto availableFaculty = db.getAvailableFaculty(timeslots[t - 1].first);
+        if (availableFaculty.empty())
+        {
+            std::cout << "No available faculty for this timeslot.\n";
+            return;
+        }
+        std::cout << "Faculty:\n";
+        for (size_t i = 0; i < availableFaculty.size(); ++i)
+            std::cout << i + 1 << ". " << availableFaculty[i].second << std::endl;
+        std::cout << "Select faculty: ";
+        std::cin >> f;
+        if (f < 1 || f >(int)availableFaculty.size())
+        {
+            std::cout << "Invalid selection.\n";
+            return;
+        }
+        int timeslot_id = timeslots[t - 1].first;
+        Database::ListFilter roomFilter = readFilter(false, false, true);
+        Option room;
+        if (!pickFromPages<Option, std::string>("available rooms for this timeslot", {"#", "Room"},
+                [&](const std::string& after) { return db.getAvailableRoomsPage(timeslot_id, after, PAGE_SIZE, roomFilter); },
+                [](const Option& o) { return std::vector<std::string>{o.second}; }, room))
+            return;
+        db.addCourseSchedule(
+            course.first,
+            availableFaculty[f - 1].first,
+            timeslot_id,
+            room.first);
+        std::cout << "Assignment completed.\n";
+    }
+    void removeCourseAssignment()
+    {
+        TRACE_FUNCTION("admin");
+        if (blockedByFastRegistration("Removing a course assignment"))
+            return;
+        Database::ListFilter filter = readFilter(true, true, true);
+        Database::ScheduledAssignment chosen;
+        if (!pickFromPages<Database::ScheduledAssignment, int>("assigned courses", {"#", "Course", "Name", "Teacher", "Room", "Timeslot"},
+                [&](int after) { return db.getCourseSchedulesPage(after, PAGE_SIZE, filter); },
+                [](const Database::ScheduledAssignment& a) {
+                    return std::vector<std::string>{a.course_code, a.course_name, a.faculty_name, a.room, a.timeslot};
+                }, chosen))
+            return;
+        db.removeCourseSchedule(chosen.schedule_id);
+        std::cout << "Assignment removed.\n";
+    }
+    void resetStudentPassword()
+    {
+        TRACE_FUNCTION("admin");
+        PeopleIndex::Entry student;
+        if (!pickPerson(PeopleIndex::StudentEntry, "Student to reset password (ID, name or email): ", student))
+            return;
+        if (db.resetStudentPassword(student.key))
+            std::cout << "Password reset to 'bnu'.\n";
+        else
+            std::cout << "Student not found or failed to reset password.\n";
+    }
+    void resetFacultyPassword()
+    {
+        TRACE_FUNCTION("admin");
+        PeopleIndex::Entry faculty;
+        if (!pickPerson(PeopleIndex::FacultyEntry, "Faculty to reset password (email or name): ", faculty))
+            return;
+        std::string email = faculty.key;
+        if (db.facultyExists(email))
+        {
+            if (db.resetFacultyPassword(email))
+                std::cout << "Password reset to 'faculty_scit'.\n";
+            else
+                std::cout << "Failed to reset password.\n";
+        }
+        else
+        {
+            std::cout << "Faculty not found.\n";
+        }
+    }
+    void recomputeCohortGpas()
+    {
+        TRACE_FUNCTION("admin");
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        size_t graded = 0;
+        std::vector<std::pair<std::string, GradingEngine::Transcript>> cohort;
+        if (shards)
+        {
+            unsigned perShard = std::max<unsigned>(1, threads / shards->size());
+            for (size_t n : shards->scatter([&](Database& shard) { return shard.recomputeAllGrades(perShard); }))
+                graded += n;
+            cohort = shards->getCohortTranscripts();
+        }
+        else
+        {
+            graded = db.recomputeAllGrades(threads);
+            cohort = db.getCohortTranscripts();
+        }
+        TableRenderer table({"Student", "Credits", "CGPA"});
+        table.reserve(cohort.size());
+        double sum = 0;
+        for (const auto& s : cohort)
+        {
+            table.addRow({s.first, std::to_string(s.second.credits), TableRenderer::number(s.second.cgpa, 2)});
+            sum += s.second.cgpa;
+        }
+        table.writeFile("cohort_gpa.csv", TableRenderer::Csv);
+        std::cout << "Graded " << graded << " students on " << threads << " threads";
+        if (!cohort.empty())
+            std::cout << ", mean CGPA " << std::fixed << std::setprecision(2) << sum / cohort.size();
+        std::cout << ".\nExported to cohort_gpa.csv\n";
+    }
+    void reconcileSeatCounters()
+    {
+        TRACE_FUNCTION("admin");
+        if (blockedByFastRegistration("Reconciling seat counters"))
+            return;
+        auto drift = db.reconcileSeatCounters(false);
+        if (drift.empty())
+        {
+            std::cout << "All seat counters match enrollments.\n";
+            return;
+        }
+        std::cout << CYAN << std::left << std::setw(12) << "Schedule" << std::setw(12) << "Course"
+                  << std::setw(10) << "Counter" << std::setw(10) << "Actual" << RESET << "\n";
+        for (const auto& d : drift)
+            std::cout << std::setw(12) << d.schedule_id << std::setw(12) << d.course_code
+                      << std::setw(10) << d.recorded << std::setw(10) << d.actual << "\n";
+        std::cout << "Repair " << drift.size() << " counter(s)? (y/n): ";
+        char answer;
+        std::cin >> answer;
+        if (answer != 'y' && answer != 'Y')
+            return;
+        drift = db.reconcileSeatCounters(true);
+        std::cout << "Repaired " << drift.size() << " counter(s).\n";
+    }
+    void semesterRollover()
+    {
+        TRACE_FUNCTION("admin");
+        if (blockedByFastRegistration("Semester rollover"))
+            return;
+        std::cout << CYAN << "\n--- End-of-Semester Rollover ---\n" << RESET;
+        std::cout << "1. Archive and Clear Enrollments\n";
+        std::cout << "2. Graduate Semester-8 Students\n";
+        std::cout << "3. Promote All Students\n";
+        std::cout << "4. Clear Course Schedule\n";
+        std::cout << "5. Full Rollover (1-4 in order)\n";
+        std::cout << "0. Back\n";
+        std::cout << "Choice: ";
+        int choice;
+        std::cin >> choice;
+        if (choice < 1 || choice > 5)
+            return;
+        std::string term;
+        if (choice == 1 || choice == 5)
+        {
+            std::cout << "Term label for the archive (e.g. Fall2024): ";
+            std::cin >> term;
+        }
+        std::cout << "This cannot be undone. Continue? (y/n): ";
+        char answer;
+        std::cin >> answer;
+        if (answer != 'y' && answer != 'Y')
+            return;
+        auto progress = [](const std::string& step, uint64_t rows) {
+            std::cout << "  " << std::left << std::setw(24) << step << rows << " row(s)" << std::endl;
+        };
+        if (choice == 1 || choice == 5)
+            db.archiveTerm(term, progress);
+        if (choice == 2 || choice == 5)
+        {
+            try {
+                db.graduateStudents(progress);
+            }
+            catch (const std::runtime_error& ex) {
+                std::cout << RED << "Graduation refused: " << ex.what() << RESET << "\n";
+                return;
+            }
+        }
+        if (choice == 3 || choice == 5)
+            db.promoteStudents(progress);
+        if (choice == 4 || choice == 5)
+            db.clearSchedule(progress);
+        std::cout << GREEN << "Rollover step(s) completed." << RESET << "\n";
+    }
+    void termArchive()
+    {
+        TRACE_FUNCTION("admin");
+        std::cout << CYAN << "\n--- Term Archive ---\n" << RESET;
+        std::cout << "1. Move Closed Term to Disk\n";
+        std::cout << "2. List Archived Terms\n";
+        std::cout << "3. Course Enrollments for an Archived Term\n";
+        std::cout << "0. Back\n";
+        std::cout << "Choice: ";
+        int choice;
+        std::cin >> choice;
+        if (choice == 1)
+        {
+            std::string term;
+            std::cout << "Term label (as given at rollover): ";
+            std::cin >> term;
+            auto a = db.archiveTermToDisk(term);
+            if (a.enrollments == 0 && a.marks == 0)
+                std::cout << "No history rows for term " << term << ".\n";
+            else
+                std::cout << "Archived " << a.enrollments << " enrollments and " << a.marks << " marks for " << term << ".\n";
+        }
+        else if (choice == 2)
+        {
+            auto terms = db.getArchivedTerms();
+            if (terms.empty())
+            {
+                std::cout << "No archived terms.\n";
+                return;
+            }
+            std::cout << CYAN << std::left << std::setw(15) << "Term" << std::setw(15) << "Enrollments" << std::setw(10) << "Marks" << RESET << "\n";
+            for (const auto& t : terms)
+                std::cout << std::setw(15) << t.term << std::setw(15) << t.enrollments << std::setw(10) << t.marks << "\n";
+        }
+        else if (choice == 3)
+        {
+            std::string term;
+            std::cout << "Term label: ";
+            std::cin >> term;
+            auto counts = db.getArchivedCourseEnrollments(term);
+            if (counts.empty())
+            {
+                std::cout << "No archived enrollments for " << term << ".\n";
+                return;
+            }
+            std::cout << CYAN << std::left << std::setw(12) << "Course" << std::setw(10) << "Students" << RESET << "\n";
+            for (const auto& c : counts)
+                std::cout << std::setw(12) << c.first << std::setw(10) << c.second << "\n";
+        }
+    }
+    void utilisationReport()
+    {
+        TRACE_FUNCTION("admin");
+        auto report = db.getOccupancyReport();
+        std::cout << CYAN << "\n--- Utilisation (" << report.rooms.size() << " rooms, " << report.faculty.size()
+                  << " faculty, " << report.slots.size() << " timeslots) ---\n" << RESET;
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "Room utilisation:    " << report.roomUtilisation * 100 << "%\n";
+        std::cout << "Faculty utilisation: " << report.facultyUtilisation * 100 << "%\n";
+        std::cout << "Seat fill:           " << report.seatFill * 100 << "%\n";
+        if (report.roomDoubleBookings || report.facultyDoubleBookings)
+            std::cout << RED << "Double bookings: " << report.roomDoubleBookings << " room, "
+                      << report.facultyDoubleBookings << " faculty\n" << RESET;
+
+        std::cout << CYAN << "\n" << std::left << std::setw(27) << "Timeslot" << std::setw(8) << "Rooms" << "Faculty\n" << RESET;
+        for (size_t s = 0; s < report.slots.size(); ++s)
+            std::cout << std::setw(27) << report.slots[s] << std::setw(8) << report.roomsBusy[s] << report.facultyBusy[s] << "\n";
+
+        std::cout << CYAN << "\n" << std::setw(10) << "Room" << std::setw(20) << "Location" << std::setw(6) << "Cap"
+                  << std::setw(8) << "Booked" << std::setw(8) << "Used%" << std::setw(8) << "Fill%" << RESET << "\n";
+        for (const auto& r : report.rooms)
+            std::cout << std::setw(10) << r.id << std::setw(20) << r.label << std::setw(6) << r.capacity
+                      << std::setw(8) << r.booked << std::setw(8) << r.utilisation * 100 << std::setw(8) << r.seatFill * 100 << "\n";
+
+        std::cout << CYAN << "\n" << std::setw(10) << "Faculty" << std::setw(26) << "Name" << std::setw(8) << "Booked"
+                  << std::setw(8) << "Used%" << RESET << "\n";
+        for (const auto& f : report.faculty)
+            std::cout << std::setw(10) << f.id << std::setw(26) << f.label << std::setw(8) << f.booked
+                      << std::setw(8) << f.utilisation * 100 << "\n";
+        std::cout << std::defaultfloat << std::right;
+        std::cout << "Built in " << report.millis << " ms.\n";
+
+        std::string id;
+        std::cout << "Room or faculty ID for idle slots (- to skip): ";
+        std::cin >> id;
+        for (const auto* rows : {&report.rooms, &report.faculty})
+            for (const auto& r : *rows)
+                if (r.id == id)
+                {
+                    std::cout << r.label << " is free in " << r.idleSlots.size() << " slot(s):\n";
+                    for (const auto& slot : r.idleSlots)
+                        std::cout << "  " << slot << "\n";
+                    return;
+                }
+    }
+    void generateExamTimetable()
+    {
+        TRACE_FUNCTION("admin");
+        int seconds;
+        std::cout << "Time budget in seconds: ";
+        std::cin >> seconds;
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        auto plan = db.planExams(threads, std::chrono::seconds(std::max(1, seconds)));
+        std::cout << CYAN << "\n--- Exam Timetable ---\n" << RESET;
+        std::cout << "Courses:            " << plan.slot.size() << " (" << plan.edges << " conflicting pairs)\n";
+        std::cout << "Exam slots:         " << plan.slots << " (lower bound " << plan.lowerBound << ")\n";
+        std::cout << "Back-to-back exams: " << plan.backToBack << " student pair(s)\n";
+        std::cout << "Busiest slot seats: " << plan.peakSeats << "\n";
+        std::cout << "Search:             " << plan.runs << " run(s) on " << threads << " thread(s), "
+                  << std::fixed << std::setprecision(0) << plan.millis << std::defaultfloat << " ms\n";
+        for (const auto& code : plan.unseated)
+            std::cout << RED << code << " could not seat every student in its slot.\n" << RESET;
+        if (plan.slots == 0)
+            return;
+
+        std::cout << CYAN << std::left << std::setw(6) << "Slot" << std::setw(12) << "Course" << std::setw(10) << "Room" << "Seats\n" << RESET;
+        auto sittings = plan.sittings;
+        std::stable_sort(sittings.begin(), sittings.end(), [](const ExamScheduler::Sitting& a, const ExamScheduler::Sitting& b) { return a.slot < b.slot; });
+        for (const auto& s : sittings)
+            std::cout << std::setw(6) << s.slot << std::setw(12) << s.course_code << std::setw(10) << s.room_id << s.seats << "\n";
+        std::cout << std::right;
+
+        char answer;
+        std::cout << "Save this timetable (replaces the current one)? (y/n): ";
+        std::cin >> answer;
+        if (answer != 'y' && answer != 'Y')
+            return;
+        db.saveExamSchedule(plan);
+        std::cout << "Exam timetable saved.\n";
+    }
+    void balanceSections()
+    {
+        TRACE_FUNCTION("admin");
+        if (blockedByFastRegistration("Balancing sections"))
+            return;
+        std::string code;
+        std::cout << "Course (any section, e.g. CS202A or CS202LB): ";
+        std::cin >> code;
+        auto plan = db.planSectionBalance(Database::courseFamily(code));
+        if (plan.sections.size() < 2)
+        {
+            std::cout << "No parallel sections are scheduled for " << Database::courseFamily(code) << ".\n";
+            return;
+        }
+        std::cout << CYAN << std::left << std::setw(12) << "Section" << std::setw(10) << "Limit" << std::setw(10) << "Fixed"
+                  << std::setw(10) << "Now" << "Balanced\n" << RESET;
+        for (const auto& sec : plan.sections)
+            std::cout << std::setw(12) << sec.course_code << std::setw(10) << sec.capacity << std::setw(10) << sec.pinned
+                      << std::setw(10) << sec.before << sec.after << "\n";
+        std::cout << std::right;
+        if (plan.moves.empty())
+        {
+            std::cout << "Sections are already as even as clashes allow.\n";
+            return;
+        }
+        for (const auto& m : plan.moves)
+            std::cout << "  " << m.student_id << ": " << plan.sections[m.from].course_code << " -> " << plan.sections[m.to].course_code << "\n";
+        char answer;
+        std::cout << "Move " << plan.moves.size() << " student(s)? (y/n): ";
+        std::cin >> answer;
+        if (answer != 'y' && answer != 'Y')
+            return;
+        size_t moved = db.applySectionBalance(plan);
+        std::cout << "Sections balanced: " << moved << " of " << plan.moves.size() << " student(s) moved";
+        if (moved < plan.moves.size())
+            std::cout << " (the rest changed section since the plan was made)";
+        std::cout << ".\n";
+    }
+    void departmentGradeStatistics()
     {
-        std::string code, name, dept, prereq;
-        int sem, max, credits;
-        std::cout << "Course code: ";
-        std::cin >> code;
-        std::cin.ignore();
-        std::cout << "Course name: ";
-        std::getline(std::cin, name);
-        std::cout << "Credits: ";
-        std::cin >> credits;
-        std::cout << "Semester: ";
-        std::cin >> sem;
-        std::cin.ignore();
+        TRACE_FUNCTION("admin");
+        std::string department;
         std::cout << "Department: ";
-        std::getline(std::cin, dept);
-        std::cout << "Max students: ";
-        std::cin >> max;
-        std::cin.ignore();
-        std::cout << "Prerequisites: ";
-        std::getline(std::cin, prereq);
-        db.addCourse(code, name, credits, sem, dept, max, prereq);
-        std::cout << "Course added.\n";
-    }
-    void removeCourse()
-    {
+        std::cin >> std::ws;
+        std::getline(std::cin, department);
+        auto stats = db.getDepartmentGradeStats(department);
+        if (stats.empty())
+        {
+            std::cout << "No marks recorded for " << department << ".\n";
+            return;
+        }
+        std::cout << CYAN << std::left << std::setw(12) << "Course" << std::setw(8) << "N" << std::setw(8) << "Mean"
+                  << std::setw(8) << "SD" << std::setw(8) << "P10" << std::setw(8) << "Median" << std::setw(8) << "P90"
+                  << "Outliers" << RESET << "\n";
+        std::cout << std::fixed << std::setprecision(1);
+        for (const auto& c : stats)
+        {
+            const auto& s = c.second;
+            std::cout << std::setw(12) << c.first << std::setw(8) << s.count << std::setw(8) << s.mean << std::setw(8) << s.stddev
+                      << std::setw(8) << s.p10 << std::setw(8) << s.median << std::setw(8) << s.p90
+                      << std::count(s.outlier.begin(), s.outlier.end(), 1) << "\n";
+        }
+        std::cout << std::defaultfloat << std::right;
         std::string code;
-        std::cout << "Course code to remove: ";
+        std::cout << "Course for distribution (- to skip): ";
         std::cin >> code;
-        db.removeCourse(code);
-        std::cout << "Course removed.\n";
+        for (const auto& c : stats)
+            if (c.first == code)
+                printGradeSummary(c.second);
     }
-    void addClassroom()
+    void writeSnapshot()
     {
-        std::string id, number, building, room_type;
-        int capacity;
-        std::cout << "Room ID: ";
-        std::cin >> id;
-        std::cout << "Room number: ";
-        std::cin >> number;
-        std::cout << "Building: ";
-        std::cin >> building;
-        std::cout << "Capacity: ";
-        std::cin >> capacity;
-        std::cout << "Room type: ";
-        std::cin >> room_type;
-        db.addClassroom(id, building, number, capacity, room_type);
-        std::cout << "Classroom added.\n";
+        TRACE_FUNCTION("admin");
+        auto start = std::chrono::steady_clock::now();
+        db.writeSnapshot(SNAPSHOT_PATH);
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Snapshot written to " << SNAPSHOT_PATH << " in " << ms << " ms ("
+                  << std::filesystem::file_size(SNAPSHOT_PATH) / 1024 << " KiB).\n";
     }
-    void removeClassroom()
+    void replicaStatus()
     {
-        std::string id;
-        std::cout << "Room ID to remove: ";
-        std::cin >> id;
-        db.removeClassroom(id);
-        std::cout << "Classroom removed.\n";
+        TRACE_FUNCTION("admin");
+        uint64_t primaryReads = 0;
+        auto replicas = db.getReplicaStatus(primaryReads);
+        if (replicas.empty())
+            std::cout << "No replicas configured; all reads use the primary.\n";
+        else
+        {
+            std::cout << std::left << std::setw(24) << "Replica" << std::setw(10) << "Lag (s)"
+                      << std::setw(12) << "Caught up" << "Reads\n";
+            for (const auto& r : replicas)
+                std::cout << std::setw(24) << r.name << std::setw(10) << (r.lag < 0 ? std::string("down") : std::to_string(static_cast<int>(r.lag)))
+                          << std::setw(12) << (r.caughtUp ? "yes" : "no") << r.reads << "\n";
+        }
+        std::cout << "Reads served by the primary: " << primaryReads << "\n";
     }
-    void addTimeslot()
+    void shardOverview()
     {
-        std::string day, start, end;
-        std::cout << "Day of week: ";
-        std::cin >> day;
-        std::cout << "Start time (HH:MM:SS): ";
-        std::cin >> start;
-        std::cout << "End time (HH:MM:SS): ";
-        std::cin >> end;
-        db.addTimeslot(day, start, end);
-        std::cout << "Timeslot added.\n";
+        TRACE_FUNCTION("admin");
+        if (!shards)
+        {
+            std::cout << "Sharding is not configured (see Config/shards.conf).\n";
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        auto counts = shards->getTableCounts();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        TableRenderer table({"Shard", "Students", "Faculty", "Courses", "Sections", "Enrollments"});
+        Database::TableCounts total{0, 0, 0, 0, 0};
+        for (size_t i = 0; i < counts.size(); ++i)
+        {
+            const auto& c = counts[i];
+            table.addRow({shards->name(i), std::to_string(c.students), std::to_string(c.faculty), std::to_string(c.courses),
+                          std::to_string(c.sections), std::to_string(c.enrollments)});
+            total = {total.students + c.students, total.faculty + c.faculty, total.courses + c.courses,
+                     total.sections + c.sections, total.enrollments + c.enrollments};
+        }
+        table.addRow({"total", std::to_string(total.students), std::to_string(total.faculty), std::to_string(total.courses),
+                      std::to_string(total.sections), std::to_string(total.enrollments)}, GREEN);
+        table.print();
+        std::cout << "Gathered from " << counts.size() << " shards in " << ms << " ms.\n";
+
+        std::string query;
+        std::cout << "Search people on all shards (- to skip): ";
+        std::cin >> query;
+        if (query == "-")
+            return;
+        TableRenderer found({"Shard", "Kind", "ID / email", "Name"});
+        for (const auto& m : shards->searchPeople(query))
+            found.addRow({m.first, m.second.entry.kind == PeopleIndex::StudentEntry ? "student" : "faculty",
+                          m.second.entry.key, m.second.entry.name});
+        if (found.empty())
+            std::cout << "No matches.\n";
+        else
+            found.print();
     }
-    void removeTimeslot()
+    void cohortCacheStatistics()
     {
-        int id;
-        std::cout << "Timeslot ID to remove: ";
-        std::cin >> id;
-        db.removeTimeslot(id);
-        std::cout << "Timeslot removed.\n";
+        TRACE_FUNCTION("admin");
+        auto stats = db.getCohortCacheStats();
+        uint64_t lookups = stats.hits + stats.misses + stats.coalesced;
+        std::cout << std::left << std::setw(28) << "Cached cohorts" << stats.entries << "\n"
+                  << std::setw(28) << "Lookups" << lookups << "\n"
+                  << std::setw(28) << "Hits" << stats.hits << " (" << TableRenderer::number(lookups ? 100.0 * stats.hits / lookups : 0, 1) << "%)\n"
+                  << std::setw(28) << "Misses (queries)" << stats.misses << "\n"
+                  << std::setw(28) << "Coalesced into a query" << stats.coalesced << "\n"
+                  << std::setw(28) << "Invalidations" << stats.invalidations << "\n";
     }
-    void assignCourseSchedule()
+    void tracing()
     {
-        auto courses = db.getUnscheduledCourses();
-        if (courses.empty())
+        auto status = Tracer::status();
+        std::cout << "Tracing is " << (status.on ? GREEN "on" RESET : "off") << ": " << status.events << " span(s) from "
+                  << status.threads << " thread(s)";
+        if (status.dropped)
+            std::cout << ", " << RED << status.dropped << " dropped (buffer full)" << RESET;
+        if (AllocationCounter::enabled())
+            std::cout << ", counting allocations";
+        std::cout << "\n1. Start a new trace\n2. Start a new trace counting allocations\n3. Stop and export to " << TRACE_PATH
+                  << "\n4. Summary (latency and allocations per span)\n0. Back\nChoice: ";
+        int choice;
+        std::cin >> choice;
+        if (choice == 1 || choice == 2)
         {
-            std::cout << "All courses are already assigned. Remove an assignment to reassign.\n";
-            return;
+            AllocationCounter::enable(choice == 2);
+            Tracer::start();
+            std::cout << "Tracing started.\n";
         }
-        auto timeslots = db.getAllTimeslots();
-        int c, f, t, r;
-        std::cout << "Courses:\n";
-        for (size_t i = 0; i < courses.size(); ++i)
-            std::cout << i + 1 << ". " << courses[i].second << std::endl;
-        std::cout << "Select course: ";
-        std::cin >> c;
-        std::cout << "Timeslots:\n";
-        for (size_t i = 0; i < timeslots.size(); ++i)
-            std::cout << timeslots[i].first << " - " << timeslots[i].second << std::endl;
-        std::cout << "Select timeslot: ";
-        std::cin >> t;
-        if (c < 1 || c >(int)courses.size() || t < 1 || t >(int)timeslots.size())
+        else if (choice == 4)
+            traceSummary();
+        else if (choice == 3)
         {
-            std::cout << "Invalid selection.\n";
-            return;
+            Tracer::stop();
+            AllocationCounter::enable(false);
+            try {
+                size_t events = Tracer::writeChromeTrace(TRACE_PATH);
+                std::cout << events << " event(s) written to " << TRACE_PATH << "; open it in ui.perfetto.dev.\n";
+            }
+            catch (const std::runtime_error& ex) {
+                std::cout << RED << ex.what() << RESET << "\n";
+            }
         }
-        auto availableFaculty = db.getAvailableFaculty(timeslots[t - 1].first);
-        if (availableFaculty.empty())
+    }
+    // Allocation columns include nested spans and read 0 unless counting was on.
+    void traceSummary()
+    {
+        auto spans = Tracer::summarize();
+        if (spans.empty())
         {
-            std::cout << "No available faculty for this timeslot.\n";
+            std::cout << "No spans recorded.\n";
             return;
         }
-        std::cout << "Faculty:\n";
-        for (size_t i = 0; i < availableFaculty.size(); ++i)
-            std::cout << i + 1 << ". " << availableFaculty[i].second << std::endl;
-        std::cout << "Select faculty: ";
-        std::cin >> f;
-        if (f < 1 || f >(int)availableFaculty.size())
+        TableRenderer table({"Span", "Calls", "Total ms", "Avg us", "Max ms", "Allocs/call", "Bytes/call"});
+        table.reserve(spans.size());
+        for (const auto& s : spans)
+            table.addRow({s.category + ": " + s.name, std::to_string(s.calls), TableRenderer::number(s.totalNs / 1e6, 2),
+                          TableRenderer::number(s.totalNs / 1e3 / s.calls, 1), TableRenderer::number(s.maxNs / 1e6, 2),
+                          TableRenderer::number(static_cast<double>(s.allocations) / s.calls, 1),
+                          TableRenderer::number(static_cast<double>(s.bytes) / s.calls, 0)});
+        table.print();
+    }
+    void seatReservationStatistics()
+    {
+        TRACE_FUNCTION("admin");
+        if (!db.fastRegistration())
         {
-            std::cout << "Invalid selection.\n";
+            std::cout << "Fast registration is off (start with --fast-registration).\n";
             return;
         }
-        auto rooms = db.getAvailableRooms(timeslots[t - 1].first);
-        if (rooms.empty())
+        auto stats = db.getSeatStats();
+        std::cout << std::left << std::setw(28) << "Seats taken" << stats.taken << "\n"
+                  << std::setw(28) << "Refused (section full)" << stats.full << "\n"
+                  << std::setw(28) << "Journalled" << stats.journalled << "\n"
+                  << std::setw(28) << "Applied to database" << stats.applied << " in " << stats.batches << " batches\n"
+                  << std::setw(28) << "Refused by the database" << stats.rejected
+                  << (stats.rejected ? "  (duplicate or clash; seat given back, see enroll-rejected in the audit trail)" : "") << "\n";
+    }
+    void transactionStatistics()
+    {
+        TRACE_FUNCTION("admin");
+        const auto& stats = db.getTransactionStats();
+        std::cout << std::left << std::setw(28) << "Committed" << stats.committed << "\n"
+                  << std::setw(28) << "Rolled back (no change)" << stats.aborted << "\n"
+                  << std::setw(28) << "Replayed request keys" << stats.replayed << "\n"
+                  << std::setw(28) << "Retries" << stats.retries << " (" << stats.deadlocks << " deadlocks, "
+                  << stats.lockTimeouts << " lock wait timeouts)\n"
+                  << std::setw(28) << "Failed" << stats.failed << "\n";
+    }
+    void viewAuditTrail()
+    {
+        TRACE_FUNCTION("admin");
+        std::string subject;
+        std::cout << "Student ID, faculty email or course code (- for everything): ";
+        std::cin >> subject;
+        auto events = db.getAuditTrail(subject == "-" ? "" : subject);
+        if (events.empty())
         {
-            std::cout << "No available rooms for this timeslot.\n";
+            std::cout << "No audit records.\n";
             return;
         }
-        std::cout << "Rooms:\n";
-        for (size_t i = 0; i < rooms.size(); ++i)
-            std::cout << i + 1 << ". " << rooms[i].second << std::endl;
-        std::cout << "Select room: ";
-        std::cin >> r;
-        if (r < 1 || r >(int)rooms.size())
+        for (const auto& e : events)
+            std::cout << AuditJournal::format(e) << "\n";
+    }
+};
+
+// Registration-day rehearsal. Virtual students are small state machines that
+// take the same Database calls as Student::addCourse, dropCourse and
+// viewTimetable, with lognormal think times between steps. Each worker
+// thread owns a connection and runs its share of students from an event
+// queue ordered by simulated time. Simulated time runs `speedup` times
+// faster than the wall clock; DB calls take their real time.
+class RegistrationSimulator
+{
+public:
+    struct Config
+    {
+        size_t students = 1000;
+        unsigned threads = 4;
+        double minutes = 30;     // simulated registration window
+        double speedup = 60;     // simulated seconds per wall-clock second
+        double thinkSeconds = 20; // mean think time between steps
+        unsigned target = 5;     // courses each student tries to get
+    };
+    typedef std::function<std::unique_ptr<Database>()> Connect;
+
+    RegistrationSimulator(const Config& config, Connect connect)
+        : config(config), connect(std::move(connect))
+    {}
+
+    void run(std::ostream& out)
+    {
+        std::vector<Database::StudentInfo> cohort;
         {
-            std::cout << "Invalid selection.\n";
+            auto db = connect();
+            cohort = db->getStudents(config.students);
+        }
+        if (cohort.empty())
+        {
+            out << "No students to simulate.\n";
             return;
         }
-        db.addCourseSchedule(
-            courses[c - 1].first,
-            availableFaculty[f - 1].first,
-            timeslots[t - 1].first,
-            rooms[r - 1].first);
-        std::cout << "Assignment completed.\n";
+        if (cohort.size() < config.students)
+            out << "Only " << cohort.size() << " students in the database; simulating those.\n";
+        unsigned threads = std::max(1u, std::min<unsigned>(config.threads, cohort.size()));
+        std::vector<Worker> workers(threads);
+        for (size_t i = 0; i < cohort.size(); ++i)
+        {
+            VirtualStudent vs;
+            vs.info = cohort[i];
+            workers[i % threads].students.push_back(vs);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t < threads; ++t)
+            pool.emplace_back(&RegistrationSimulator::runWorker, this, std::ref(workers[t]), start, 0x5eed + t);
+        for (auto& th : pool)
+            th.join();
+        double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        Worker total;
+        for (auto& w : workers)
+            total.merge(w);
+        report(out, total, cohort.size(), threads, wall);
     }
-    void removeCourseAssignment()
+
+private:
+    enum Step { Browse, Add, Timetable, Drop, STEPS };
+    static const char* stepName(int s)
+    {
+        static const char* names[] = {"browse", "add course", "timetable", "drop course"};
+        return names[s];
+    }
+    struct VirtualStudent
+    {
+        Database::StudentInfo info;
+        Step next = Browse;
+        std::vector<Database::ScheduledCourse> offered;
+        size_t enrolled = 0, attempts = 0;
+        bool leaving = false; // checks the timetable once more, then logs off
+    };
+    struct Minute
+    {
+        uint64_t ops = 0, adds = 0, full = 0, errors = 0;
+        std::vector<uint32_t> addMicros;
+    };
+    struct Worker
     {
-        auto assignments = db.getAllCourseSchedules();
-        if (assignments.empty())
+        std::vector<VirtualStudent> students;
+        std::vector<uint32_t> micros[STEPS]; // latency per completed step
+        uint64_t allocations[STEPS] = {}, allocatedBytes[STEPS] = {}; // with SCIT_TRACE_ALLOCS
+        std::vector<Minute> minutes;
+        uint64_t adds = 0, enrolled = 0, full = 0, errors = 0, finished = 0;
+        uint64_t retries = 0, deadlocks = 0, lockTimeouts = 0;
+        double maxLag = 0; // seconds the queue fell behind simulated time
+        std::string firstError;
+        CohortCache<Database::ScheduledCourse>::Stats cache; // shared by all workers; the latest read wins
+        SeatReservations::Stats seats;                        // likewise, with fast registration
+
+        void merge(Worker& w)
         {
-            std::cout << "No assigned courses.\n";
+            for (int s = 0; s < STEPS; ++s)
+            {
+                micros[s].insert(micros[s].end(), w.micros[s].begin(), w.micros[s].end());
+                allocations[s] += w.allocations[s];
+                allocatedBytes[s] += w.allocatedBytes[s];
+            }
+            if (minutes.size() < w.minutes.size())
+                minutes.resize(w.minutes.size());
+            for (size_t m = 0; m < w.minutes.size(); ++m)
+            {
+                minutes[m].ops += w.minutes[m].ops;
+                minutes[m].adds += w.minutes[m].adds;
+                minutes[m].full += w.minutes[m].full;
+                minutes[m].errors += w.minutes[m].errors;
+                minutes[m].addMicros.insert(minutes[m].addMicros.end(), w.minutes[m].addMicros.begin(), w.minutes[m].addMicros.end());
+            }
+            adds += w.adds;
+            enrolled += w.enrolled;
+            full += w.full;
+            errors += w.errors;
+            finished += w.finished;
+            retries += w.retries;
+            deadlocks += w.deadlocks;
+            lockTimeouts += w.lockTimeouts;
+            maxLag = std::max(maxLag, w.maxLag);
+            if (w.cache.hits + w.cache.misses > cache.hits + cache.misses)
+                cache = w.cache;
+            if (w.seats.applied > seats.applied)
+                seats = w.seats;
+            if (firstError.empty())
+                firstError = w.firstError;
+        }
+    };
+
+    Config config;
+    Connect connect;
+
+    void runWorker(Worker& w, std::chrono::steady_clock::time_point start, unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        // Arrivals bunch up when registration opens: exponential with a mean
+        // of a tenth of the window.
+        std::exponential_distribution<double> arrival(10.0 / (config.minutes * 60));
+        double sigma = 0.8;
+        std::lognormal_distribution<double> think(std::log(config.thinkSeconds) - sigma * sigma / 2, sigma);
+        std::uniform_real_distribution<double> coin(0, 1);
+        double end = config.minutes * 60;
+        w.minutes.resize(static_cast<size_t>(std::ceil(config.minutes)));
+
+        std::unique_ptr<Database> db;
+        try {
+            db = connect();
+        }
+        catch (const std::exception& ex) {
+            w.errors += w.students.size();
+            w.firstError = ex.what();
             return;
         }
-        for (size_t i = 0; i < assignments.size(); ++i)
-            std::cout << i + 1 << ". " << assignments[i].course_code << " - " << assignments[i].course_name
-            << " | " << assignments[i].faculty_name << " | " << assignments[i].room << " | " << assignments[i].timeslot << std::endl;
-        std::cout << "Select assignment to remove: ";
-        int idx;
-        std::cin >> idx;
-        if (idx < 1 || idx >(int)assignments.size())
+        typedef std::pair<double, size_t> Event; // simulated time, student
+        std::priority_queue<Event, std::vector<Event>, std::greater<Event>> queue;
+        for (size_t i = 0; i < w.students.size(); ++i)
+            queue.push({std::min(arrival(rng), end * 0.9), i});
+
+        while (!queue.empty() && queue.top().first < end)
         {
-            std::cout << "Invalid selection.\n";
-            return;
+            Event ev = queue.top();
+            queue.pop();
+            auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                   std::chrono::duration<double>(ev.first / config.speedup));
+            auto now = std::chrono::steady_clock::now();
+            if (due > now)
+                std::this_thread::sleep_until(due);
+            else
+                w.maxLag = std::max(w.maxLag, std::chrono::duration<double>(now - due).count() * config.speedup);
+
+            VirtualStudent& vs = w.students[ev.second];
+            Minute& minute = w.minutes[std::min(w.minutes.size() - 1, static_cast<size_t>(ev.first / 60))];
+            Step step = vs.next;
+            bool done = false;
+            AllocationCounter::Totals allocatedBefore = AllocationCounter::local();
+            auto t0 = std::chrono::steady_clock::now();
+            try {
+                db->setActor("student:" + vs.info.student_id);
+                done = perform(*db, vs, w, minute, rng, coin);
+                auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+                w.allocations[step] += AllocationCounter::local().allocations - allocatedBefore.allocations;
+                w.allocatedBytes[step] += AllocationCounter::local().bytes - allocatedBefore.bytes;
+                w.micros[step].push_back(static_cast<uint32_t>(us));
+                if (step == Add)
+                    minute.addMicros.push_back(static_cast<uint32_t>(us));
+            }
+            catch (const std::exception& ex) {
+                ++w.errors;
+                ++minute.errors;
+                if (w.firstError.empty())
+                    w.firstError = ex.what();
+                vs.next = Browse;
+            }
+            ++minute.ops;
+            if (done)
+                ++w.finished;
+            else
+                queue.push({ev.first + think(rng), ev.second});
         }
-        db.removeCourseSchedule(assignments[idx - 1].schedule_id);
-        std::cout << "Assignment removed.\n";
+        const auto& tx = db->getTransactionStats();
+        w.retries = tx.retries;
+        w.deadlocks = tx.deadlocks;
+        w.lockTimeouts = tx.lockTimeouts;
+        w.cache = db->getCohortCacheStats();
+        db->flushRegistrations();
+        w.seats = db->getSeatStats();
     }
-    void resetStudentPassword()
+
+    // Runs the student's next step and picks the one after it. Returns true
+    // once the student has logged off.
+    bool perform(Database& db, VirtualStudent& vs, Worker& w, Minute& minute, std::mt19937& rng,
+                 std::uniform_real_distribution<double>& coin)
     {
-        std::string studentId;
-        std::cout << "Enter Student ID to reset password: ";
-        std::cin >> studentId;
-        if (db.resetStudentPassword(studentId))
-            std::cout << "Password reset to 'bnu'.\n";
-        else
-            std::cout << "Student not found or failed to reset password.\n";
+        const std::string& id = vs.info.student_id;
+        switch (vs.next)
+        {
+        case Browse:
+            vs.offered = db.getAvailableScheduledCourses(vs.info.semester, vs.info.degree);
+            vs.next = vs.offered.empty() ? Timetable : Add;
+            return false;
+        case Add:
+        {
+            ++vs.attempts;
+            const auto& sc = vs.offered[std::uniform_int_distribution<size_t>(0, vs.offered.size() - 1)(rng)];
+            if (!db.isAlreadyEnrolled(id, sc.schedule_id) && !db.hasClash(id, sc.timeslot_id) &&
+                db.getMissingPrerequisites(id, sc.course_code).empty())
+            {
+                ++w.adds;
+                ++minute.adds;
+                if (db.addEnrollment(id, sc.schedule_id, Database::newRequestKey()))
+                {
+                    ++vs.enrolled;
+                    ++w.enrolled;
+                }
+                else
+                {
+                    ++w.full;
+                    ++minute.full;
+                }
+            }
+            vs.leaving = vs.enrolled >= config.target || vs.attempts >= 3 * config.target;
+            double r = coin(rng);
+            vs.next = vs.leaving || r < 0.25 ? Timetable : r < 0.3 ? Drop : Browse;
+            return false;
+        }
+        case Timetable:
+            db.getStudentTimetable(id);
+            vs.next = Browse;
+            return vs.leaving || vs.offered.empty();
+        case Drop:
+        {
+            auto enrolled = db.getEnrolledCourses(id);
+            if (!enrolled.empty())
+            {
+                const auto& sc = enrolled[std::uniform_int_distribution<size_t>(0, enrolled.size() - 1)(rng)];
+                if (db.dropEnrollment(id, sc.schedule_id) && vs.enrolled > 0)
+                    --vs.enrolled;
+            }
+            vs.next = Browse;
+            return false;
+        }
+        default:
+            return true;
+        }
     }
-    void resetFacultyPassword()
+
+    static std::string percentile(std::vector<uint32_t>& v, double p)
     {
-        std::string email;
-        std::cout << "Enter Faculty Email to reset password: ";
-        std::cin >> email;
-        if (db.facultyExists(email))
+        if (v.empty())
+            return "-";
+        size_t k = std::min(v.size() - 1, static_cast<size_t>(p * v.size()));
+        std::nth_element(v.begin(), v.begin() + k, v.end());
+        return TableRenderer::number(v[k] / 1000.0, 1);
+    }
+
+    void report(std::ostream& out, Worker& total, size_t students, unsigned threads, double wall)
+    {
+        uint64_t ops = 0;
+        for (int s = 0; s < STEPS; ++s)
+            ops += total.micros[s].size();
+        out << "\n" << CYAN << "Registration simulation" << RESET << ": " << students << " students on " << threads << " threads, "
+            << config.minutes << " simulated minutes in " << TableRenderer::number(wall, 1) << " s\n";
+        out << "Throughput: " << TableRenderer::number(ops / wall, 1) << " ops/s (" << ops << " ops), "
+            << total.finished << " students done, " << total.enrolled << " enrollments\n";
+        out << "Full sections: " << total.full << " of " << total.adds << " add attempts ("
+            << TableRenderer::number(total.adds ? 100.0 * total.full / total.adds : 0, 1) << "%)\n";
+        out << "Errors: " << total.errors << (total.firstError.empty() ? "" : " (first: " + total.firstError + ")") << "\n";
+        out << "Transaction retries: " << total.retries << " (" << total.deadlocks << " deadlocks, "
+            << total.lockTimeouts << " lock wait timeouts)\n";
+        uint64_t lookups = total.cache.hits + total.cache.misses + total.cache.coalesced;
+        out << "Cohort cache: " << TableRenderer::number(lookups ? 100.0 * total.cache.hits / lookups : 0, 1) << "% hits, "
+            << total.cache.coalesced << " coalesced misses, " << total.cache.misses << " queries\n";
+        if (total.seats.taken)
+            out << "Fast registration: " << total.seats.applied << " journalled enrollments applied in "
+                << total.seats.batches << " batches, " << total.seats.rejected << " refused by the database (duplicate or clash)\n";
+        out << "Scheduler lag: max " << TableRenderer::number(total.maxLag, 1) << " simulated s"
+            << (total.maxLag > config.thinkSeconds ? RED " (database cannot keep up at this speedup)" RESET : "") << "\n\n";
+        out.flush();
+
+        bool counted = AllocationCounter::enabled();
+        std::vector<std::string> headers = {"Step", "Count", "p50 ms", "p95 ms", "p99 ms", "max ms"};
+        if (counted)
+            headers.insert(headers.end(), {"Allocs/op", "Bytes/op"});
+        TableRenderer latency(headers);
+        for (int s = 0; s < STEPS; ++s)
         {
-            if (db.resetFacultyPassword(email))
-                std::cout << "Password reset to 'faculty_scit'.\n";
-            else
-                std::cout << "Failed to reset password.\n";
+            auto& v = total.micros[s];
+            std::string max = v.empty() ? "-" : TableRenderer::number(*std::max_element(v.begin(), v.end()) / 1000.0, 1);
+            std::vector<std::string> cells = {stepName(s), std::to_string(v.size()), percentile(v, 0.50), percentile(v, 0.95),
+                                              percentile(v, 0.99), max};
+            if (counted)
+                cells.insert(cells.end(), {TableRenderer::number(v.empty() ? 0 : static_cast<double>(total.allocations[s]) / v.size(), 1),
+                                           TableRenderer::number(v.empty() ? 0 : static_cast<double>(total.allocatedBytes[s]) / v.size(), 0)});
+            latency.addRow(cells);
         }
-        else
+        latency.print();
+
+        out << "\n";
+        out.flush();
+        TableRenderer timeline({"Minute", "Ops", "Adds", "Full %", "Errors", "Add p95 ms"});
+        for (size_t m = 0; m < total.minutes.size(); ++m)
         {
-            std::cout << "Faculty not found.\n";
+            auto& mm = total.minutes[m];
+            timeline.addRow({std::to_string(m + 1), std::to_string(mm.ops), std::to_string(mm.adds),
+                             TableRenderer::number(mm.adds ? 100.0 * mm.full / mm.adds : 0, 1), std::to_string(mm.errors),
+                             percentile(mm.addMicros, 0.95)}, mm.errors ? RED : "");
         }
+        timeline.print();
     }
 };
 
-int main()
+// Decode cost per row for a timetable-shaped result (SQL_ENROLLED_COURSES),
+// decoded by hand as the list methods used to and through the row map. The
+// rows are built in memory, so no database is needed.
+void benchRowMap(size_t rows, std::ostream& out)
+{
+    typedef Database::ScheduledCourse SC;
+    std::vector<mysqlx::Row> input(rows);
+    for (size_t i = 0; i < rows; ++i)
+    {
+        mysqlx::Row& r = input[i];
+        int n = static_cast<int>(i);
+        r.set(0, mysqlx::Value(n));
+        r.set(1, mysqlx::Value("CS" + std::to_string(100 + n % 400) + "A"));
+        r.set(2, mysqlx::Value(std::string("Data Structures and Algorithms")));
+        r.set(3, mysqlx::Value(std::string("Computer Science")));
+        r.set(4, mysqlx::Value(1 + n % 8));
+        r.set(5, mysqlx::Value(n % 60));
+        r.set(6, mysqlx::Value(std::string("Ayesha Rehman")));
+        r.set(7, mysqlx::Value(n % 40));
+        r.set(8, mysqlx::Value(std::string("Wednesday")));
+        r.set(9, mysqlx::Value(std::string("09:30:00")));
+        r.set(10, mysqlx::Value(std::string("11:00:00")));
+        r.set(11, mysqlx::Value("R" + std::to_string(n % 90)));
+        r.set(12, mysqlx::Value(std::string("204")));
+        r.set(13, mysqlx::Value(std::string("Academic Block")));
+    }
+    auto byHand = [](mysqlx::Row& row) {
+        return SC{row[0].get<int>(), row[1].get<std::string>(), row[2].get<std::string>(), row[3].get<std::string>(),
+                  row[4].get<int>(), row[5].get<int>(), row[7].get<int>(), row[6].get<std::string>(),
+                  row[8].get<std::string>(), row[9].get<std::string>(), row[10].get<std::string>(),
+                  row[11].get<std::string>(), row[12].get<std::string>(), row[13].get<std::string>()};
+    };
+    // Best of five passes; the checksum keeps the decoded rows live.
+    auto time = [&](auto decode, uint64_t& checksum) {
+        double best = 0;
+        for (int pass = 0; pass < 5; ++pass)
+        {
+            std::vector<SC> decoded;
+            decoded.reserve(rows);
+            auto start = std::chrono::steady_clock::now();
+            for (auto& row : input)
+                decoded.push_back(decode(row));
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            best = pass == 0 ? ns : std::min(best, ns);
+            for (const auto& sc : decoded)
+                checksum += sc.timeslot_id + sc.faculty_name.size() + sc.building.size();
+        }
+        return best / std::max<size_t>(rows, 1);
+    };
+    uint64_t handSum = 0, mapSum = 0;
+    double hand = time(byHand, handSum);
+    double mapped = time(Database::TIMETABLE_ROW, mapSum);
+    TableRenderer table({"Decoder", "ns/row"});
+    table.addRow({"by hand (row[i].get<T>())", TableRenderer::number(hand, 1)});
+    table.addRow({"RowMap", TableRenderer::number(mapped, 1)});
+    out << rows << " rows of " << Database::TIMETABLE_ROW.COLUMNS << " columns\n";
+    out.flush();
+    table.print();
+    if (handSum != mapSum)
+        out << RED << "Decoders disagree (checksum " << handSum << " vs " << mapSum << ")" << RESET << "\n";
+}
+
+// Read-only timetable and room lookups served from a snapshot, for a
+// terminal with no database access.
+void runKiosk(const Snapshot& snap)
+{
+    std::map<int, Snapshot::Timeslot> slots;
+    for (const auto& t : snap.timeslots())
+        slots[t.timeslot_id] = t;
+    std::map<std::string, Snapshot::Room> rooms;
+    for (const auto& r : snap.rooms())
+        rooms[r.room_id] = r;
+    std::map<std::string, Snapshot::Course> courses;
+    for (const auto& c : snap.courses())
+        courses[c.code] = c;
+    std::map<std::string, std::string> facultyNames;
+    for (const auto& f : snap.members("f."))
+        facultyNames[f.id] = f.first_name + " " + f.last_name;
+    auto sections = snap.sections();
+    std::map<int, Snapshot::Section> byId;
+    for (const auto& s : sections)
+        byId[s.schedule_id] = s;
+
+    auto print = [&](const Snapshot::Section& s) {
+        const auto& t = slots[s.timeslot_id];
+        const auto& r = rooms[s.room_id];
+        std::cout << std::left << std::setw(10) << s.course_code << std::setw(30) << courses[s.course_code].name
+                  << std::setw(11) << t.day << std::setw(18) << (t.start + "-" + t.end)
+                  << std::setw(16) << (r.room_number + " " + r.building) << facultyNames[std::to_string(s.faculty_id)]
+                  << std::right << "\n";
+    };
+    char when[32];
+    std::time_t created = snap.created();
+    std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M", std::localtime(&created));
+
+    int choice;
+    do
+    {
+        std::cout << CYAN << "\n--- SCIT Kiosk (data as of " << when << ") ---\n" << RESET;
+        std::cout << "1. Student Timetable\n";
+        std::cout << "2. Room Timetable\n";
+        std::cout << "3. Free Rooms in a Timeslot\n";
+        std::cout << "4. Course Sections\n";
+        std::cout << "0. Exit\n";
+        std::cout << "Choice: ";
+        if (!(std::cin >> choice))
+            break;
+        std::string key;
+        if (choice == 1)
+        {
+            std::cout << "Student ID: ";
+            std::cin >> key;
+            auto ids = snap.scheduleIdsForStudent(key);
+            if (ids.empty())
+                std::cout << "No enrollments found.\n";
+            for (int id : ids)
+                if (byId.count(id))
+                    print(byId[id]);
+        }
+        else if (choice == 2)
+        {
+            std::cout << "Room ID: ";
+            std::cin >> key;
+            for (const auto& s : sections)
+                if (s.room_id == key)
+                    print(s);
+        }
+        else if (choice == 3)
+        {
+            for (const auto& t : slots)
+                std::cout << t.first << ". " << t.second.day << " " << t.second.start << "-" << t.second.end << "\n";
+            int slot;
+            std::cout << "Timeslot: ";
+            std::cin >> slot;
+            std::set<std::string> busy;
+            for (const auto& s : sections)
+                if (s.timeslot_id == slot)
+                    busy.insert(s.room_id);
+            for (const auto& r : rooms)
+                if (!busy.count(r.first))
+                    std::cout << std::left << std::setw(10) << r.first << std::setw(20) << (r.second.room_number + " " + r.second.building)
+                              << r.second.capacity << " seats" << std::right << "\n";
+        }
+        else if (choice == 4)
+        {
+            std::cout << "Course code (any section): ";
+            std::cin >> key;
+            std::string family = Database::courseFamily(key);
+            for (const auto& s : sections)
+                if (Database::courseFamily(s.course_code) == family)
+                {
+                    print(s);
+                    std::cout << "          " << s.seats_taken << "/" << courses[s.course_code].max_students << " seats taken\n";
+                }
+        }
+    } while (choice != 0);
+}
+
+int main(int argc, char* argv[])
 {
     std::string host = "127.0.0.1";
     std::string user = "root";
     std::string pass = "Sufian312";
     std::string dbname = "project_db";
+    std::string mode = argc > 1 ? argv[1] : "";
+    Tracer::startFromEnvironment();
     try
     {
-        Database db(host, user, pass, dbname);
+        if (mode == "--audit")
+        {
+            // Offline inspection: MySQLXTest --audit [journal] [subject]
+            std::string subject = argc > 3 ? argv[3] : "";
+            size_t read = AuditJournal::replay(argc > 2 ? argv[2] : "audit.journal", [&](const AuditEvent& e) {
+                if (subject.empty() || e.subject == subject || e.object.find(subject) != std::string::npos)
+                    std::cout << AuditJournal::format(e) << "\n";
+            });
+            std::cout << read << " record(s) read.\n";
+            return 0;
+        }
+        if (mode == "--kiosk")
+        {
+            // Read-only, no database: MySQLXTest --kiosk [snapshot]
+            runKiosk(Snapshot(argc > 2 ? argv[2] : SNAPSHOT_PATH));
+            return 0;
+        }
+        if (mode == "--bench-rowmap")
+        {
+            // Row decoding micro-benchmark, no database: MySQLXTest --bench-rowmap [rows]
+            benchRowMap(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100000, std::cout);
+            return 0;
+        }
+        if (mode == "--simulate")
+        {
+            // Load test: MySQLXTest --simulate students [threads] [minutes] [speedup] [fast]
+            RegistrationSimulator::Config config;
+            if (argc > 2) config.students = std::strtoul(argv[2], nullptr, 10);
+            if (argc > 3) config.threads = std::strtoul(argv[3], nullptr, 10);
+            if (argc > 4) config.minutes = std::max(1.0, std::atof(argv[4]));
+            if (argc > 5) config.speedup = std::max(1.0, std::atof(argv[5]));
+            bool fast = argc > 6 && std::string(argv[6]) == "fast";
+            std::vector<std::string> replicas = readEndpoints("Config/replicas.conf");
+            RegistrationSimulator sim(config, [&] {
+                std::unique_ptr<Database> worker(new Database(host, user, pass, dbname, replicas));
+                if (fast)
+                    worker->enableFastRegistration(SEAT_JOURNAL_PATH);
+                return worker;
+            });
+            sim.run(std::cout);
+            return 0;
+        }
+        // With shards configured, the default shard stands in for the single
+        // database in the modes below, and logins go to the user's home shard.
+        std::unique_ptr<ShardRouter> shards;
+        std::unique_ptr<Database> single;
+        ShardRouter::Layout layout = ShardRouter::readLayout("Config/shards.conf");
+        if (!layout.shards.empty())
+            shards.reset(new ShardRouter(layout, user, pass));
+        else
+            single.reset(new Database(host, user, pass, dbname, readEndpoints("Config/replicas.conf")));
+        Database& db = shards ? shards->defaultShard() : *single;
+        if (mode == "--snapshot")
+        {
+            // For cron: MySQLXTest --snapshot [path]
+            db.writeSnapshot(argc > 2 ? argv[2] : SNAPSHOT_PATH);
+            return 0;
+        }
+        bool snapshotFresh = false;
+        try {
+            Snapshot snapshot(SNAPSHOT_PATH);
+            snapshotFresh = std::time(nullptr) - snapshot.created() < SNAPSHOT_MAX_AGE;
+            if (snapshotFresh)
+                db.warmFrom(snapshot);
+        }
+        catch (const std::runtime_error&) {
+            // Missing or unreadable snapshot: caches fill from the database as before.
+        }
+        size_t shardCount = shards ? shards->size() : 1;
+        if (mode == "--fast-registration")
+        {
+            // Registration day: MySQLXTest --fast-registration, then the usual menus.
+            for (size_t i = 0; i < shardCount; ++i)
+                (shards ? shards->shard(i) : db).enableFastRegistration(
+                    shards ? SEAT_JOURNAL_PATH + std::string(".") + shards->name(i) : SEAT_JOURNAL_PATH);
+            std::cout << GREEN << "Fast registration enabled." << RESET << std::endl;
+        }
+        if (mode == "--migrate")
+        {
+            for (size_t i = 0; i < shardCount; ++i)
+            {
+                if (shards)
+                    std::cout << CYAN << "Shard " << shards->name(i) << RESET << "\n";
+                for (const auto& m : (shards ? shards->shard(i) : db).migrate(argc > 2 ? argv[2] : "Schema"))
+                    std::cout << (m.applied ? GREEN "applied  " RESET : "present  ") << "V" << m.version << " " << m.name << "\n";
+            }
+            return 0;
+        }
+        if (mode == "--check-plans")
+        {
+            bool clean = true;
+            for (size_t i = 0; i < shardCount; ++i)
+            {
+                auto problems = (shards ? shards->shard(i) : db).checkQueryPlans();
+                for (const auto& p : problems)
+                    std::cout << RED << "Full scan: " << RESET << (shards ? "[" + shards->name(i) + "] " : "")
+                              << p.query << " reads " << p.table << " (" << p.access << ")\n";
+                clean = clean && problems.empty();
+            }
+            std::cout << (clean ? "All query plans use indexes.\n" : "");
+            return clean ? 0 : 1;
+        }
         int choice;
         do
         {
@@ -1764,11 +9429,13 @@ int main()
                 std::cin >> studentId;
                 std::cout << "Enter Password: ";
                 std::cin >> password;
-                if (db.studentExists(studentId) && db.validateStudentPassword(studentId, password))
+                Database& home = shards ? shards->forStudent(studentId) : db;
+                if (home.studentExists(studentId) && home.validateStudentPassword(studentId, password))
                 {
                     // Get student name from database (you'll need to implement this in Database class)
                     std::string studentName = "Student"; // Replace with actual name from DB
-                    Student stu(db, studentId, studentName, studentId + "@bnu.edu.pk");
+                    Student stu(home, studentId, studentName, studentId + "@bnu.edu.pk");
+                    home.setActor("student:" + studentId);
                     stu.menu();
                 }
                 else
@@ -1783,7 +9450,19 @@ int main()
                 std::cin >> password;
                 if (db.isAdminPasswordCorrect(password))
                 {
-                    Admin admin(db, "admin", "Admin", "admin@email.com");
+                    size_t pick = 1;
+                    if (shards)
+                    {
+                        for (size_t i = 0; i < shards->size(); ++i)
+                            std::cout << i + 1 << ". " << shards->name(i) << "\n";
+                        std::cout << "Shard to administer: ";
+                        std::cin >> pick;
+                        if (pick < 1 || pick > shards->size())
+                            pick = 1;
+                    }
+                    Database& home = shards ? shards->shard(pick - 1) : db;
+                    Admin admin(home, "admin", "Admin", "admin@email.com", shards.get());
+                    home.setActor("admin");
                     admin.menu();
                 }
                 else
@@ -1799,11 +9478,13 @@ int main()
                 email += "@bnu.edu.pk"; // Append the domain automatically
                 std::cout << "Enter Password: ";
                 std::cin >> password;
-                if (db.facultyExists(email) && db.validateFacultyPassword(email, password))
+                Database& home = shards ? shards->forFaculty(email) : db;
+                if (home.facultyExists(email) && home.validateFacultyPassword(email, password))
                 {
-                    int facultyId = std::stoi(db.getFacultyId(email));
-                    std::string facultyName = db.getFacultyName(email);
-                    Faculty faculty(db, std::to_string(facultyId), facultyName, email);
+                    int facultyId = std::stoi(home.getFacultyId(email));
+                    std::string facultyName = home.getFacultyName(email);
+                    Faculty faculty(home, std::to_string(facultyId), facultyName, email);
+                    home.setActor("faculty:" + email);
                     faculty.menu();
                 }
                 else
@@ -1814,6 +9495,8 @@ int main()
             else if (choice == 0)
             {
                 std::cout << "Exiting...\n";
+                if (!snapshotFresh)
+                    db.writeSnapshot(SNAPSHOT_PATH);
             }
             else
             {